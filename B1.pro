@@ -4,7 +4,6 @@ CONFIG -= app_bundle
 CONFIG -= qt
 
 unix {
-    QMAKE_CXXFLAGS += -std=c++11
     LIBS += -lSDL2
 }
 
@@ -23,20 +22,14 @@ win32 {
     QMAKE_CXXFLAGS_RELEASE -= -MD
 }
 
+include(core.pri)
+
 SOURCES += main.cpp \
-    cpu.cpp \
-    mcc.cpp \
-    vpu.cpp \
-    keyboard.cpp \
-    spu.cpp \
-    device.cpp
+    sdlhost.cpp \
+    terminal.cpp \
+    gdbstub.cpp
 
 HEADERS += \
-    cpu.h \
-    common.h \
-    mcc.h \
-    vpu.h \
-    keyboard.h \
-    spu.h \
-    device.h
-
+    sdlhost.h \
+    terminal.h \
+    gdbstub.h
@@ -0,0 +1,14 @@
+TEMPLATE = lib
+CONFIG += staticlib
+CONFIG -= qt
+TARGET = b1core
+
+include(core.pri)
+
+SOURCES += b1api.cpp
+HEADERS += b1.h
+
+win32 {
+    QMAKE_CXXFLAGS_RELEASE += /MT
+    QMAKE_CXXFLAGS_RELEASE -= -MD
+}
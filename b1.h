@@ -0,0 +1,89 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef B1_H
+#define B1_H
+
+/* C interface of B1 emulator core library.
+ * Every machine is independent, functions may be called concurrently
+ * for different machines but not for the same one.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct b1_machine b1_machine;
+
+typedef struct b1_options {
+    int cmos;           /* emulate 65C02 instruction set */
+    int exact_timing;   /* charge exact instruction cycle counts */
+    int dma;            /* attach DMA controller */
+    int timer;          /* attach interval timer */
+    int hle;            /* execute BIOS text output routines natively */
+    int hle_basic;      /* execute Tiny BASIC hot paths natively */
+    int realtime;       /* pace b1_run to real time instead of running flat out */
+    const char* storage_dir; /* host directory backing storage device, or NULL */
+} b1_options;
+
+/* CPU-only snapshot: registers and memory. Device state (video, sound, timer,
+ * DMA, keyboard, serial port, expansion banks) is not saved nor restored. */
+typedef struct b1_cpu_state {
+    uint8_t  a, x, y, sp, p;
+    uint16_t pc;
+    uint64_t cycles;
+    uint8_t  memory[65536];
+} b1_cpu_state;
+
+/* Key modifiers for b1_key */
+enum {
+    B1_MOD_SHIFT = 0x01,
+    B1_MOD_CAPS  = 0x02,
+    B1_MOD_ALT   = 0x04,
+    B1_MOD_CTRL  = 0x08,
+};
+
+void b1_default_options(b1_options* options);
+
+/* Returns NULL on failure, options may be NULL for defaults */
+b1_machine* b1_create(const b1_options* options);
+void        b1_destroy(b1_machine* machine);
+
+/* Copies ROM image into memory at given address and resets CPU */
+int  b1_load_rom(b1_machine* machine, const void* data, size_t size, uint16_t address);
+
+/* Runs for at least given number of cycles, returns cycles actually run */
+uint64_t b1_run(b1_machine* machine, uint64_t cycles);
+uint64_t b1_cycles(const b1_machine* machine);
+uint32_t b1_frequency(const b1_machine* machine);
+
+/* Direct memory access, bypassing memory mapped registers but following expansion banks */
+uint8_t b1_peek(const b1_machine* machine, uint16_t address);
+void    b1_poke(b1_machine* machine, uint16_t address, uint8_t value);
+
+/* Text mode screen contents as UTF-8, 25 lines of 40 characters.
+ * Returns length of the text, writes at most size-1 bytes and terminating zero. */
+size_t b1_read_screen(const b1_machine* machine, char* text, size_t size);
+/* Last complete frame as 352x232 RGBA pixels (4 bytes each), returns
+ * number of frames completed since creation */
+uint32_t b1_read_frame(const b1_machine* machine, uint8_t* pixels);
+
+/* Key press or release: unshifted ASCII code or keyboard controller code */
+void b1_key(b1_machine* machine, uint8_t code, int pressed, uint8_t modifiers);
+/* Queues text to be typed as fast as the guest reads it */
+void b1_inject_text(b1_machine* machine, const char* text);
+
+/* Restoring drops any pending interrupt, devices keep their current state */
+void b1_save_cpu_state(const b1_machine* machine, b1_cpu_state* state);
+void b1_load_cpu_state(b1_machine* machine, const b1_cpu_state* state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* B1_H */
@@ -0,0 +1,191 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cstring>
+#include <vector>
+#include "cpu.h"
+#include "b1.h"
+
+namespace {
+    // Keeps a copy of last complete frame for b1_read_frame
+    class FrameCapture : public VideoOutput
+    {
+    public:
+        FrameCapture()
+            : Pixels(VPU::ScreenWidth * VPU::ScreenHeight * 4)
+        {}
+
+        void Present(const U8* InPixels, const U16 Width, const U16 Height, const int Pitch) override
+        {
+            for(U16 Row=0; Row<Height; Row++) {
+                std::memcpy(&Pixels[Row * Width*4], InPixels + Row*Pitch, Width*4);
+            }
+        }
+
+        std::vector<U8> Pixels;
+    };
+}
+
+struct b1_machine
+{
+    FrameCapture Frame;
+    CPU*         TheCPU;
+
+    b1_machine() : TheCPU(nullptr) {}
+    ~b1_machine() { delete TheCPU; }
+};
+
+void b1_default_options(b1_options* options)
+{
+    const Config Defaults;
+
+    options->cmos         = Defaults.CMOS;
+    options->exact_timing = Defaults.ExactTiming;
+    options->dma          = Defaults.DMA;
+    options->timer        = Defaults.Timer;
+    options->hle          = Defaults.HLE;
+    options->hle_basic    = Defaults.HLEBasic;
+    options->realtime     = 0;
+    options->storage_dir  = nullptr;
+}
+
+b1_machine* b1_create(const b1_options* options)
+{
+    b1_options Options;
+    if(options)
+        Options = *options;
+    else
+        b1_default_options(&Options);
+
+    Config Settings;
+    Settings.Turbo       = !Options.realtime;
+    Settings.CMOS        = Options.cmos != 0;
+    Settings.ExactTiming = Options.exact_timing != 0;
+    Settings.DMA         = Options.dma != 0;
+    Settings.Timer       = Options.timer != 0;
+    Settings.HLE         = Options.hle != 0;
+    Settings.HLEBasic    = Options.hle_basic != 0;
+    if(Options.storage_dir) {
+        Settings.StorageDir = Options.storage_dir;
+    }
+
+    b1_machine* Machine = new b1_machine;
+    try {
+        Host Backends;
+        Backends.Video  = &Machine->Frame;
+        Machine->TheCPU = new CPU(CPUFREQ, VIDEOHZ, Settings, Backends, nullptr, 0, 0);
+    }
+    catch(const std::exception& Error) {
+        std::fprintf(stderr, "Error: %s\n", Error.what());
+        delete Machine;
+        return nullptr;
+    }
+    return Machine;
+}
+
+void b1_destroy(b1_machine* machine)
+{
+    delete machine;
+}
+
+int b1_load_rom(b1_machine* machine, const void* data, size_t size, uint16_t address)
+{
+    if(size == 0 || size > MEMSIZE - address)
+        return 0;
+
+    machine->TheCPU->Load(static_cast<const char*>(data), address, size);
+    return 1;
+}
+
+uint64_t b1_run(b1_machine* machine, uint64_t cycles)
+{
+    CPU& TheCPU = *machine->TheCPU;
+
+    const U64 Start = TheCPU.TotalCycles;
+    while(TheCPU.TotalCycles - Start < cycles) {
+        TheCPU.Tick();
+    }
+    return TheCPU.TotalCycles - Start;
+}
+
+uint64_t b1_cycles(const b1_machine* machine)
+{
+    return machine->TheCPU->TotalCycles;
+}
+
+uint32_t b1_frequency(const b1_machine* machine)
+{
+    return machine->TheCPU->Frequency;
+}
+
+uint8_t b1_peek(const b1_machine* machine, uint16_t address)
+{
+    return machine->TheCPU->RAM.Peek(address);
+}
+
+void b1_poke(b1_machine* machine, uint16_t address, uint8_t value)
+{
+    machine->TheCPU->RAM.Poke(address, value);
+}
+
+size_t b1_read_screen(const b1_machine* machine, char* text, size_t size)
+{
+    const std::string Screen = machine->TheCPU->Video.ReadScreenText();
+    if(size > 0) {
+        const size_t Length = std::min(Screen.size(), size-1);
+        std::memcpy(text, Screen.data(), Length);
+        text[Length] = 0;
+    }
+    return Screen.size();
+}
+
+uint32_t b1_read_frame(const b1_machine* machine, uint8_t* pixels)
+{
+    const std::vector<U8>& Pixels = machine->Frame.Pixels;
+    std::memcpy(pixels, Pixels.data(), Pixels.size());
+    return machine->TheCPU->Video.Frame;
+}
+
+void b1_key(b1_machine* machine, uint8_t code, int pressed, uint8_t modifiers)
+{
+    machine->TheCPU->Kbd.KeyEvent(code, pressed != 0, modifiers);
+}
+
+void b1_inject_text(b1_machine* machine, const char* text)
+{
+    machine->TheCPU->Kbd.InjectText(text);
+}
+
+void b1_save_cpu_state(const b1_machine* machine, b1_cpu_state* state)
+{
+    CPU& TheCPU = *machine->TheCPU;
+
+    state->a      = TheCPU.A;
+    state->x      = TheCPU.X;
+    state->y      = TheCPU.Y;
+    state->sp     = TheCPU.SP;
+    state->p      = *reinterpret_cast<const U8*>(&TheCPU.Flags);
+    state->pc     = TheCPU.PC;
+    state->cycles = TheCPU.TotalCycles;
+    std::memcpy(state->memory, TheCPU.RAM.Memory, MEMSIZE);
+}
+
+void b1_load_cpu_state(b1_machine* machine, const b1_cpu_state* state)
+{
+    CPU& TheCPU = *machine->TheCPU;
+
+    TheCPU.A           = state->a;
+    TheCPU.X           = state->x;
+    TheCPU.Y           = state->y;
+    TheCPU.SP          = state->sp;
+    TheCPU.PC          = state->pc;
+    TheCPU.TotalCycles = state->cycles;
+    *reinterpret_cast<U8*>(&TheCPU.Flags) = state->p;
+    std::memcpy(TheCPU.RAM.Memory, state->memory, MEMSIZE);
+
+    TheCPU.Waiting   = false;
+    TheCPU.Stopped   = false;
+    TheCPU.Interrupt = CPU::INT_None;
+}
@@ -0,0 +1,1110 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <algorithm>
+#include "cpu.h"
+#include "basic.h"
+
+namespace {
+    // Tiny BASIC load address (see JMON)
+    const U16 BasicBase = 0xBA00;
+
+    // Zero-page locations used by IL interpreter
+    const U8 PRGBEG = 0x20; // Start of program
+    const U8 PRGEND = 0x24; // End of program (limit of IL call stack)
+    const U8 LINENO = 0x28; // Current line number
+    const U8 ILPC   = 0x2A; // IL program counter
+    const U8 BASPC  = 0x2C; // BASIC text pointer
+    const U8 BASSAV = 0xB8; // BASIC text pointer saved by string match
+    const U8 SIGN   = 0xBB; // Sign of quotient
+    const U8 TEMPLO = 0xBC; // Scratch word
+    const U8 TEMPHI = 0xBD;
+    const U8 EXPLIM = 0xC0; // Expression stack limit
+    const U8 EXPSP  = 0xC1; // Expression stack pointer
+    const U8 ILSP   = 0xC6; // IL call stack pointer
+
+    // IL opcodes executed natively
+    enum {
+        OP_JS = 0x30,
+        OP_J  = 0x38,
+        OP_BR = 0x40,
+        OP_LB = 0x09,
+        OP_LN = 0x0A,
+        OP_SP = 0x0C,
+        OP_FV = 0x12,
+        OP_SV = 0x13,
+        OP_GO = 0x16,
+        OP_NE = 0x17,
+        OP_AD = 0x18,
+        OP_SU = 0x19,
+        OP_MP = 0x1A,
+        OP_DV = 0x1B,
+    };
+
+    // Interpreter code expected in Tiny BASIC image (-1 matches any byte)
+    const int WarmStart[] = {
+        0xA5, 0x22, 0x85, 0xC6, 0x85, 0x26, 0xA5, 0x23, 0x85, 0xC7, 0x85, 0x27,
+        0x20, -1, -1, 0xAD, -1, -1, 0x85, ILPC, 0xAD, -1, -1, 0x85, ILPC+1,
+        0xA9, 0x80, 0x85, EXPSP, 0xA9, 0x30, 0x85, EXPLIM, 0xA2, 0x00, 0x86, 0xBE, 0x86, 0xC2, 0xCA, 0x9A,
+        0xD8, 0x20, -1, -1, 0x20, -1, -1, 0x4C, -1, -1,
+    };
+    const int DispatchCode[] = {
+        0xC9, 0x30, 0xB0, -1, 0xC9, 0x08, 0x90, -1, 0x0A, 0xAA, 0xBD, -1, -1, 0x48, 0xBD, -1, -1, 0x48, 0x08, 0x40,
+    };
+    const int LBL004Code[] = {
+        0xA0, 0x00, 0xB1, ILPC, 0xE6, ILPC, 0xD0, 0x02, 0xE6, ILPC+1, 0x09, 0x00, 0x60,
+    };
+    const int LBL011Code[] = {
+        0xC9, 0x40, 0xB0, -1, 0x48, 0x20, -1, -1, 0x6D, -1, -1, 0x85, TEMPLO,
+        0x68, 0x48, 0x29, 0x07, 0x6D, -1, -1, 0x85, TEMPHI, 0x68, 0x29, 0x08, 0xD0, -1,
+        0xA5, TEMPLO, 0xA6, ILPC, 0x85, ILPC, 0x86, TEMPLO, 0xA5, TEMPHI, 0xA6, ILPC+1, 0x85, ILPC+1, 0x86, TEMPHI,
+        0xA5, ILSP, 0xE9, 0x01, 0x85, ILSP, 0xB0, 0x02, 0xC6, ILSP+1,
+        0xC5, PRGEND, 0xA5, ILSP+1, 0xE5, PRGEND+1, 0x90, -1,
+        0xA5, TEMPLO, 0x91, ILSP, 0xC8, 0xA5, TEMPHI, 0x91, ILSP, 0x60,
+    };
+    const int LBL016Code[] = {
+        0x48, 0x4A, 0x4A, 0x4A, 0x4A, 0x29, 0x0E, 0xAA, 0x68, 0xC9, 0x60, 0x29, 0x1F, 0xB0, 0x02, 0x09, 0xE0,
+        0x18, 0xF0, 0x07, 0x65, ILPC, 0x85, TEMPLO, 0x98, 0x65, ILPC+1, 0x85, TEMPHI, 0x4C, -1, -1,
+    };
+    const int BBRCode[] = {
+        0xC6, TEMPHI, 0xA5, TEMPHI, 0xF0, -1, 0xA5, TEMPLO, 0x85, ILPC, 0xA5, TEMPHI, 0x85, ILPC+1, 0x60,
+    };
+    const int BCCode[] = {
+        0xA5, BASPC, 0x85, BASSAV, 0xA5, BASPC+1, 0x85, BASSAV+1, 0x20, -1, -1, 0x20, -1, -1,
+        0x51, ILPC, 0xAA, 0x20, -1, -1, 0x8A, 0xF0, 0xF1, 0x0A, 0xF0, 0x12,
+        0xA5, BASSAV, 0x85, BASPC, 0xA5, BASSAV+1, 0x85, BASPC+1, 0x4C, -1, -1,
+        0x20, -1, -1, 0xC9, 0x0D, 0xD0, 0xF6, 0x60,
+    };
+    const int BVCode[] = {
+        0x20, -1, -1, 0xC9, 0x5B, 0xB0, -1, 0xC9, 0x41, 0x90, -1, 0x0A, 0x20, -1, -1,
+    };
+    const int LBL023Code[] = {
+        0x20, -1, -1, 0xB1, BASPC, 0xC9, 0x20, 0xF0, 0xF7, 0xC9, 0x3A, 0x18, 0x10, 0x02, 0xC9, 0x30, 0x60,
+    };
+    const int LBL024Code[] = {
+        0xA0, 0x00, 0xB1, BASPC, 0xE6, BASPC, 0xD0, 0x02, 0xE6, BASPC+1, 0xC9, 0x0D, 0x18, 0x60,
+    };
+    const int LBL029Code[] = {
+        0xA6, EXPSP, 0xCA, 0x95, 0x00, 0x86, EXPSP, 0xE4, EXPLIM, 0xD0, -1, 0x4C, -1, -1,
+    };
+    const int LBL037Code[] = {
+        0x20, -1, -1, 0x85, LINENO, 0x20, -1, -1, 0x85, LINENO+1, 0x05, LINENO, 0x60,
+    };
+    const int LBL097Code[] = {
+        0xA6, EXPSP, 0xE0, 0x80, 0x10, -1, 0xB5, 0x00, 0xE6, EXPSP, 0x60,
+    };
+    const int LBL115Code[] = {
+        0xA2, 0x7C, 0xE4, EXPSP, 0x90, -1, 0xA6, EXPSP, 0xE6, EXPSP, 0xE6, EXPSP, 0x18, 0x60,
+    };
+    const int NECode[] = {
+        0xA6, EXPSP, 0x38, 0x98, 0xF5, 0x00, 0x95, 0x00, 0x98, 0xF5, 0x01, 0x95, 0x01, 0x60,
+    };
+    const int ADCode[] = {
+        0x20, -1, -1, 0xB5, 0x00, 0x75, 0x02, 0x95, 0x02, 0xB5, 0x01, 0x75, 0x03, 0x95, 0x03, 0x60,
+    };
+    const int MPCode[] = {
+        0x20, -1, -1, 0xA0, 0x10, 0xB5, 0x02, 0x85, TEMPLO, 0xB5, 0x03, 0x85, TEMPHI,
+        0x16, 0x02, 0x36, 0x03, 0x26, TEMPLO, 0x26, TEMPHI, 0x90, 0x0D,
+        0x18, 0xB5, 0x02, 0x75, 0x00, 0x95, 0x02, 0xB5, 0x03, 0x75, 0x01, 0x95, 0x03,
+        0x88, 0xD0, -1, 0x60,
+    };
+    const int DVCode[] = {
+        0x20, -1, -1, 0xB5, 0x03, 0x29, 0x80, 0xF0, 0x02, 0xA9, 0xFF,
+        0x85, TEMPLO, 0x85, TEMPHI, 0x48, 0x75, 0x02, 0x95, 0x02, 0x68, 0x48, 0x75, 0x03, 0x95, 0x03, 0x68,
+        0x55, 0x01, 0x85, SIGN, 0x10, 0x03, 0x20, -1, -1,
+        0xA0, 0x11, 0xB5, 0x00, 0x15, 0x01, 0xD0, 0x03, 0x4C, -1, -1,
+        0x38, 0xA5, TEMPLO, 0xF5, 0x00, 0x48, 0xA5, TEMPHI, 0xF5, 0x01, 0x48, 0x45, TEMPHI, 0x30, 0x0A,
+        0x68, 0x85, TEMPHI, 0x68, 0x85, TEMPLO, 0x38, 0x4C, -1, -1,
+        0x68, 0x68, 0x18,
+        0x36, 0x02, 0x36, 0x03, 0x26, TEMPLO, 0x26, TEMPHI, 0x88, 0xD0, -1, 0xA5, SIGN, 0x10, -1,
+    };
+    const int FVCode[] = {
+        0x20, -1, -1, 0xAA, 0xB5, 0x00, 0xB4, 0x01, 0xC6, EXPSP, 0xA6, EXPSP, 0x94, 0x00, 0x4C, -1, -1,
+    };
+    const int SVCode[] = {
+        0xA2, 0x7D, 0x20, -1, -1, 0xB5, 0x01, 0x48, 0xB5, 0x00, 0x48, 0x20, -1, -1,
+        0xAA, 0x68, 0x95, 0x00, 0x68, 0x95, 0x01, 0x60,
+    };
+    const int LBCode[] = {
+        0x20, -1, -1, 0x4C, -1, -1,
+    };
+    const int SPCode[] = {
+        0x20, -1, -1, 0x85, TEMPLO, 0x20, -1, -1, 0x85, TEMPHI, 0x60,
+    };
+    const int FindLineCode[] = {
+        0x20, -1, -1, 0xA5, TEMPLO, 0x05, TEMPHI, 0xF0, -1,
+        0xA5, PRGBEG, 0x85, BASPC, 0xA5, PRGBEG+1, 0x85, BASPC+1,
+        0x20, -1, -1, 0xF0, -1, 0xA5, LINENO, 0xC5, TEMPLO, 0xA5, LINENO+1, 0xE5, TEMPHI, 0xB0, -1,
+        0x20, -1, -1, 0xD0, -1, 0x4C, -1, -1,
+        0xA5, LINENO, 0x45, TEMPLO, 0xD0, 0x04, 0xA5, LINENO+1, 0x45, TEMPHI, 0x60,
+    };
+
+    // Offsets of JSR instructions within interpreter routines
+    const U16 BCReadNonBlank    = 8;
+    const U16 BCReadBasicByte   = 11;
+    const U16 BCReadILByte      = 17;
+    const U16 BCBranch          = 34;
+    const U16 BCEnd             = 37;
+    const U16 BVPushByte        = 12;
+    const U16 BVEnd             = 15;
+    const U16 JumpReadILByte    = 5;
+    const U16 FindLineFromStart = 9;
+    const U16 FindLineReadLineNo = 17;
+    const U16 FindLineSkipText  = 32;
+    const U16 DVNegate          = 33;
+
+    // Limit of program bytes scanned natively by line lookup
+    const U32 MaxScanLength = 0x10000;
+    // Limit of characters scanned natively by string match & blank skipping
+    const U32 MaxMatchLength = 0x100;
+
+    // Cycles taken by IL byte fetch (LBL004) including JSR & RTS
+    const U32 ReadILCycles = 29;
+
+    #define MATCH(Addr, Code) Match(Addr, Code, sizeof(Code)/sizeof(Code[0]))
+}
+
+BasicHLE::BasicHLE(CPU* InCPU)
+    : HLE(InCPU, "BASIC")
+    , Dispatch(0)
+    , FindLineAddr(0)
+    , SRVT(0)
+    , OpCode(0)
+{}
+
+void BasicHLE::Attach()
+{
+    Enabled = false;
+    if(!TheCPU.Settings.HLEBasic)
+        return;
+
+    if(!Locate()) {
+        std::fprintf(stderr, "BASIC HLE: Tiny BASIC interpreter not recognized, disabled\n");
+        return;
+    }
+
+    Enabled = true;
+    EnableVerify(TheCPU.Settings.HLEVerify);
+    std::printf("BASIC HLE enabled%s, IL dispatch at $%04x\n", TheCPU.Settings.HLEVerify ? " (verification mode)" : "", Dispatch);
+}
+
+bool BasicHLE::Locate()
+{
+    // Tiny BASIC begins with a table of six jumps
+    for(U16 Addr=BasicBase; Addr<BasicBase+18; Addr+=3) {
+        if(RAM.Memory[Addr] != 0x4C)
+            return false;
+    }
+
+    const U16 WarmStartAddr = Operand(BasicBase+7);
+    if(!MATCH(WarmStartAddr, WarmStart))
+        return false;
+
+    // IL execution loop: JSR LBL004, JSR LBL005, JMP
+    AddrLBL004 = Operand(WarmStartAddr+43);
+    Dispatch   = Operand(WarmStartAddr+46);
+    if(!MATCH(AddrLBL004, LBL004Code) || !MATCH(Dispatch, DispatchCode))
+        return false;
+
+    SRVT = Operand(Dispatch+11) + 3;
+    if(Operand(Dispatch+15) != SRVT-4)
+        return false;
+
+    AddrNE = Handler(OP_NE);
+    AddrAD = Handler(OP_AD);
+    AddrSU = Handler(OP_SU);
+    AddrMP = Handler(OP_MP);
+    AddrDV = Handler(OP_DV);
+    AddrFV = Handler(OP_FV);
+    AddrSV = Handler(OP_SV);
+    AddrLB = Handler(OP_LB);
+    AddrLN = Handler(OP_LN);
+    AddrSP = Handler(OP_SP);
+
+    if(!MATCH(AddrNE, NECode) || !MATCH(AddrAD, ADCode) || !MATCH(AddrMP, MPCode) || !MATCH(AddrDV, DVCode))
+        return false;
+    if(!MATCH(AddrFV, FVCode) || !MATCH(AddrSV, SVCode) || !MATCH(AddrLB, LBCode) || !MATCH(AddrSP, SPCode))
+        return false;
+
+    AddrLBL115 = Operand(AddrAD+1);
+    AddrLBL097 = Operand(AddrFV+1);
+    AddrLBL029 = Operand(AddrFV+15);
+    if(!MATCH(AddrLBL115, LBL115Code) || !MATCH(AddrLBL097, LBL097Code) || !MATCH(AddrLBL029, LBL029Code))
+        return false;
+
+    // SU negates and falls through to AD, DV ends with NE, LN calls and falls through to LB
+    if(RAM.Memory[AddrSU] != 0x20 || Operand(AddrSU+1) != AddrNE || AddrSU+3 != AddrAD)
+        return false;
+    if(Operand(AddrMP+1) != AddrLBL115 || Operand(AddrDV+1) != AddrLBL115 || Operand(AddrDV+DVNegate+1) != AddrNE+2)
+        return false;
+    if(Operand(AddrDV+70) != AddrDV+75 || AddrDV+sizeof(DVCode)/sizeof(DVCode[0]) != AddrNE)
+        return false;
+    if(Operand(AddrSV+3) != AddrLBL115+2 || Operand(AddrSV+12) != AddrLBL097)
+        return false;
+    if(Operand(AddrLB+1) != AddrLBL004 || Operand(AddrLB+4) != AddrLBL029)
+        return false;
+    if(RAM.Memory[AddrLN] != 0x20 || Operand(AddrLN+1) != AddrLB || AddrLN+3 != AddrLB)
+        return false;
+    if(Operand(AddrSP+1) != AddrLBL097 || Operand(AddrSP+6) != AddrLBL097)
+        return false;
+
+    // PushByte exits through RTS of PopByte
+    const U16 ExitAddr = AddrLBL029 + 11 + S8(RAM.Memory[AddrLBL029+10]);
+    if(ExitAddr != AddrLBL097+10)
+        return false;
+
+    // Line lookup used by GOTO, GOSUB, RETURN, LIST and line editing
+    const U16 GotoAddr = Handler(OP_GO);
+    if(RAM.Memory[GotoAddr] != 0x20)
+        return false;
+    FindLineAddr = Operand(GotoAddr+1);
+    if(!MATCH(FindLineAddr, FindLineCode))
+        return false;
+
+    AddrLBL037 = Operand(FindLineAddr+FindLineReadLineNo+1);
+    AddrLBL024 = Operand(FindLineAddr+FindLineSkipText+1);
+    if(Operand(FindLineAddr+1) != AddrSP || Operand(FindLineAddr+38) != FindLineAddr+FindLineReadLineNo)
+        return false;
+    if(!MATCH(AddrLBL037, LBL037Code) || !MATCH(AddrLBL024, LBL024Code))
+        return false;
+    if(Operand(AddrLBL037+1) != AddrLBL024 || Operand(AddrLBL037+6) != AddrLBL024)
+        return false;
+
+    // IL jumps & calls, branch decoding
+    AddrLBL011 = Dispatch + 4 + S8(RAM.Memory[Dispatch+3]);
+    if(!MATCH(AddrLBL011, LBL011Code) || Operand(AddrLBL011+JumpReadILByte+1) != AddrLBL004)
+        return false;
+    AddrLBL002 = Operand(AddrLBL011+9);
+    AddrLBL016 = AddrLBL011 + 4 + S8(RAM.Memory[AddrLBL011+3]);
+    if(Operand(AddrLBL011+18) != AddrLBL002+1 || !MATCH(AddrLBL016, LBL016Code) || Operand(AddrLBL016+30) != Dispatch+10)
+        return false;
+
+    // Branch handlers: BBR falls through to FBR, BE follows BC and BV falls through to LBL024
+    AddrBBR = Handler(2);
+    AddrFBR = Handler(3);
+    AddrBC  = Handler(4);
+    AddrBV  = Handler(5);
+    AddrBE  = Handler(7);
+    if(!MATCH(AddrBBR, BBRCode) || AddrFBR != AddrBBR+2 || AddrLBL011+27+S8(RAM.Memory[AddrLBL011+26]) != AddrFBR+4)
+        return false;
+    if(!MATCH(AddrBC, BCCode) || !MATCH(AddrBV, BVCode) || AddrBE != AddrBC+BCEnd || AddrBV+BVEnd != AddrLBL024)
+        return false;
+
+    AddrLBL023 = Operand(AddrBC+BCReadNonBlank+1);
+    if(!MATCH(AddrLBL023-3, LBL023Code) || Operand(AddrLBL023-2) != AddrLBL024)
+        return false;
+    if(Operand(AddrBC+BCReadBasicByte+1) != AddrLBL024 || Operand(AddrBC+BCReadILByte+1) != AddrLBL004)
+        return false;
+    if(Operand(AddrBC+BCBranch+1) != AddrFBR || Operand(AddrBE+1) != AddrLBL023 || Operand(AddrBV+1) != AddrLBL023)
+        return false;
+    if(AddrBV+7+S8(RAM.Memory[AddrBV+6]) != AddrBC+BCBranch || AddrBV+11+S8(RAM.Memory[AddrBV+10]) != AddrBC+BCBranch)
+        return false;
+    if(Operand(AddrBV+BVPushByte+1) != AddrLBL029)
+        return false;
+
+    return true;
+}
+
+U8& BasicHLE::Stack(const U8 Offset)
+{
+    return RAM.Memory[U8(TheCPU.X + Offset)];
+}
+
+bool BasicHLE::Match(const U16 Addr, const int* Pattern, const size_t Length) const
+{
+    for(size_t i=0; i<Length; i++) {
+        if(Pattern[i] >= 0 && RAM.Memory[U16(Addr+i)] != Pattern[i])
+            return false;
+    }
+    return true;
+}
+
+U16 BasicHLE::Operand(const U16 Addr) const
+{
+    return RAM.Peek(Addr) | RAM.Peek(U16(Addr+1)) << 8;
+}
+
+U16 BasicHLE::Handler(const U8 Code) const
+{
+    return Operand(SRVT - 4 + Code*2);
+}
+
+bool BasicHLE::Call(const U16 Addr)
+{
+    if(Addr == AddrLBL004)
+        return Run(R_ReadIL, false);
+    if(Addr == Dispatch)
+        return Run(R_Dispatch, false);
+    if(Addr == FindLineAddr)
+        return Run(R_FindLine, false);
+    if(Addr == FindLineAddr+FindLineFromStart)
+        return Run(R_FindLineFromStart, false);
+    return false;
+}
+
+bool BasicHLE::Prepare(const int Which)
+{
+    // Error paths (stack overflow, division by zero, missing line) are left to guest code
+    const U8 SP    = ZeroPage(EXPSP);
+    const U8 Limit = ZeroPage(EXPLIM);
+
+    if(TheCPU.Flags.D)
+        return false;
+
+    switch(Which) {
+    case R_ReadIL:
+        return ZeroPage(ILPC+1) != 0xFD;
+    case R_Dispatch:
+        OpCode = TheCPU.A;
+        if(ZeroPage(ILPC+1) == 0xFD)
+            return false;
+        if(OpCode >= OP_BR)
+            return PrepareBranch();
+        if(OpCode >= OP_JS)
+            return PrepareJump();
+        switch(OpCode) {
+        case OP_NE:
+            return true;
+        case OP_AD:
+        case OP_SU:
+        case OP_MP:
+            return SP <= 0x7C;
+        case OP_DV:
+            return SP <= 0x7C && (ZeroPage(SP) | ZeroPage(U8(SP+1))) != 0;
+        case OP_FV:
+            return SP < 0x80 && U8(SP-1) != Limit;
+        case OP_SV:
+            return SP <= 0x7D && U8(SP+2) < 0x80;
+        case OP_LB:
+            return U8(SP-1) != Limit;
+        case OP_LN:
+            return U8(SP-1) != Limit && U8(SP-2) != Limit;
+        }
+        return false;
+    case R_FindLine:
+        if(SP >= 0x80 || U8(SP+1) >= 0x80)
+            return false;
+        if((ZeroPage(SP) | ZeroPage(U8(SP+1))) == 0)
+            return false;
+        return ScanTerminates(ZeroPage(SP) | ZeroPage(U8(SP+1)) << 8);
+    case R_FindLineFromStart:
+        return ScanTerminates(ReadPointer(TEMPLO));
+    }
+    return false;
+}
+
+bool BasicHLE::ScanTerminates(const U16 LineNumber) const
+{
+    U16 Addr   = RAM.Peek(PRGBEG) | RAM.Peek(PRGBEG+1) << 8;
+    U32 Length = 0;
+
+    while(Length < MaxScanLength) {
+        if((Addr >> 8) == 0xFD || (U16(Addr+1) >> 8) == 0xFD)
+            return false;
+
+        const U16 Current = RAM.Peek(Addr) | RAM.Peek(U16(Addr+1)) << 8;
+        if(Current == 0 || Current >= LineNumber)
+            return true;
+
+        Addr += 2;
+        U8 Char;
+        do {
+            if((Addr >> 8) == 0xFD)
+                return false;
+            Char = RAM.Peek(Addr++);
+            Length++;
+        } while(Char != 0x0D && Length < MaxScanLength);
+    }
+    return false;
+}
+
+bool BasicHLE::PrepareJump() const
+{
+    if(OpCode >= OP_J)
+        return true;
+
+    // JS pushes return address on IL call stack, overflow is reported by guest code
+    const U16 Lo = RAM.Peek(ReadPointer(ILPC)) + RAM.Peek(AddrLBL002);
+    const U16 Hi = (OpCode & 0x07) + RAM.Peek(AddrLBL002+1) + (Lo >> 8);
+    const int NewSP = int(ReadPointer(ILSP)) - 2 + (Hi >> 8);
+    if(NewSP < ReadPointer(PRGEND))
+        return false;
+    return (NewSP >> 8) != 0xFD && ((NewSP+1) >> 8) != 0xFD;
+}
+
+bool BasicHLE::PrepareBranch() const
+{
+    // Branch with zero offset (or to page zero) reports an error
+    const U8 Offset = OpCode & 0x1F;
+    if(Offset == 0 || TheCPU.Y != 0)
+        return false;
+    const U16 Target = ReadPointer(ILPC) + Offset - (OpCode < 0x60 ? 0x20 : 0);
+    if((Target >> 8) == 0)
+        return false;
+
+    U16 Addr = ReadPointer(BASPC);
+    switch(OpCode & 0xE0) {
+    case 0x40:
+    case 0x60:
+        return true;
+    case 0x80:
+        return MatchTerminates();
+    case 0xA0:
+        if(!SkipBlanks(Addr))
+            return false;
+        if(RAM.Peek(Addr) >= 'A' && RAM.Peek(Addr) <= 'Z')
+            return U8(ZeroPage(EXPSP)-1) != ZeroPage(EXPLIM);
+        return true;
+    case 0xE0:
+        return SkipBlanks(Addr);
+    }
+    return false;
+}
+
+bool BasicHLE::SkipBlanks(U16& Addr) const
+{
+    for(U32 Length=0; Length < MaxMatchLength; Length++) {
+        if((Addr >> 8) == 0xFD)
+            return false;
+        if(RAM.Peek(Addr) != ' ')
+            return true;
+        Addr++;
+    }
+    return false;
+}
+
+bool BasicHLE::MatchTerminates() const
+{
+    U16 Text = ReadPointer(BASPC);
+    U16 IL   = ReadPointer(ILPC);
+
+    // String match ends on first differing character (IL string ends with bit 7 set)
+    for(U32 Length=0; Length < MaxMatchLength; Length++) {
+        if(!SkipBlanks(Text) || (IL >> 8) == 0xFD)
+            return false;
+        if(RAM.Peek(Text++) != RAM.Peek(IL++))
+            return true;
+    }
+    return false;
+}
+
+void BasicHLE::Execute(const int Which)
+{
+    U8& A = TheCPU.A;
+    U8& X = TheCPU.X;
+
+    switch(Which) {
+    case R_ReadIL:
+        NextILByte();
+        break;
+    case R_Dispatch:
+        // LBL005: jumps & branches are decoded separately, other opcodes index handler table
+        CMP(A, 0x30);
+        if(OpCode >= OP_JS) {
+            CMP(A, 0x40);
+            if(OpCode >= OP_BR)
+                IL_BR();
+            else
+                IL_J();
+            break;
+        }
+        CMP(A, 0x08);
+        A = ASL(A);
+        X = A;
+        SetNZ(X);
+        HandlerJump();
+
+        switch(OpCode) {
+        case OP_NE: IL_NE(); break;
+        case OP_AD: IL_AD(); break;
+        case OP_SU: IL_SU(); break;
+        case OP_MP: IL_MP(); break;
+        case OP_DV: IL_DV(); break;
+        case OP_FV: IL_FV(); break;
+        case OP_SV: IL_SV(); break;
+        case OP_LB: IL_LB(); break;
+        case OP_LN: IL_LN(); break;
+        }
+        break;
+    case R_FindLine:
+        FindLine(false);
+        break;
+    case R_FindLineFromStart:
+        FindLine(true);
+        break;
+    }
+}
+
+const char* BasicHLE::RoutineName(const int Which) const
+{
+    static const char* OpNames[] = {
+        "IL 08", "IL LB", "IL LN", "IL DS", "IL SP", "IL 0D", "IL 0E", "IL 0F",
+        "IL SB", "IL RB", "IL FV", "IL SV", "IL GS", "IL RS", "IL GO", "IL NE",
+        "IL AD", "IL SU", "IL MP", "IL DV",
+    };
+
+    static const char* BranchNames[] = {
+        "IL BR", "IL BR", "IL BC", "IL BV", "IL BN", "IL BE",
+    };
+
+    switch(Which) {
+    case R_ReadIL:
+        return "IL fetch";
+    case R_Dispatch:
+        if(OpCode >= OP_BR)
+            return BranchNames[(OpCode >> 5) - 2];
+        if(OpCode >= OP_JS)
+            return OpCode >= OP_J ? "IL J" : "IL JS";
+        return (OpCode >= 0x08 && OpCode <= OP_DV) ? OpNames[OpCode-0x08] : "IL";
+    case R_FindLine:
+        return "line lookup";
+    case R_FindLineFromStart:
+        return "line lookup from start";
+    }
+    return "";
+}
+
+U32 BasicHLE::Cost(const int Which) const
+{
+    // IL fetch is cheaper than average native routine
+    if(Which == R_ReadIL)
+        return std::min(TheCPU.Settings.HLECycles, ReadILCycles);
+    return TheCPU.Settings.HLECycles;
+}
+
+void BasicHLE::HandlerJump()
+{
+    // LBL022: push handler address & flags, then RTI to it
+    U8& A = TheCPU.A;
+
+    A = RAM.Read(SRVT-3 + TheCPU.X);
+    SetNZ(A);
+    Push(A);
+    A = RAM.Read(SRVT-4 + TheCPU.X);
+    SetNZ(A);
+    Push(A);
+    Push(PackFlags() | 0x30);
+    UnpackFlags(Pop() | 0x30);
+    Pop();
+    Pop();
+}
+
+void BasicHLE::IL_J()
+{
+    // LBL011: J & JS with 11-bit target relative to IL table origin
+    U8& A = TheCPU.A;
+    U8& X = TheCPU.X;
+    U8& Y = TheCPU.Y;
+
+    Push(A);
+    ReadILByte(AddrLBL011 + JumpReadILByte);
+    A = ADC(A, RAM.Read(AddrLBL002));
+    ZeroPage(TEMPLO) = A;
+    A = Pop();
+    SetNZ(A);
+    Push(A);
+    A &= 0x07;
+    SetNZ(A);
+    A = ADC(A, RAM.Read(AddrLBL002+1));
+    ZeroPage(TEMPHI) = A;
+    A = Pop();
+    SetNZ(A);
+    A &= 0x08;
+    SetNZ(A);
+    if(!TheCPU.Flags.Z) {
+        TakeBranch();
+        return;
+    }
+
+    // JS: exchange target with return address & push it on IL call stack
+    A = ZeroPage(TEMPLO);
+    X = ZeroPage(ILPC);
+    ZeroPage(ILPC)   = A;
+    ZeroPage(TEMPLO) = X;
+    A = ZeroPage(TEMPHI);
+    X = ZeroPage(ILPC+1);
+    SetNZ(X);
+    ZeroPage(ILPC+1) = A;
+    ZeroPage(TEMPHI) = X;
+
+    A = SBC(ZeroPage(ILSP), 0x01);
+    ZeroPage(ILSP) = A;
+    if(!TheCPU.Flags.C) {
+        SetNZ(--ZeroPage(ILSP+1));
+    }
+    CMP(A, ZeroPage(PRGEND));
+    SBC(ZeroPage(ILSP+1), ZeroPage(PRGEND+1));
+
+    A = ZeroPage(TEMPLO);
+    RAM.Write(U16(ReadPointer(ILSP) + Y), A);
+    SetNZ(++Y);
+    A = ZeroPage(TEMPHI);
+    SetNZ(A);
+    RAM.Write(U16(ReadPointer(ILSP) + Y), A);
+}
+
+void BasicHLE::IL_BR()
+{
+    // LBL016: branch type selects handler, 5-bit offset is relative to IL PC
+    U8& A = TheCPU.A;
+
+    Push(A);
+    A = LSR(LSR(LSR(LSR(A))));
+    A &= 0x0E;
+    TheCPU.X = A;
+    A = Pop();
+    CMP(A, 0x60);
+    A &= 0x1F;
+    SetNZ(A);
+    if(!TheCPU.Flags.C) {
+        A |= 0xE0;
+        SetNZ(A);
+    }
+    TheCPU.Flags.C = 0;
+    if(!TheCPU.Flags.Z) {
+        A = ADC(A, ZeroPage(ILPC));
+        ZeroPage(TEMPLO) = A;
+        A = ADC(TheCPU.Y, ZeroPage(ILPC+1));
+    }
+    ZeroPage(TEMPHI) = A;
+    HandlerJump();
+
+    switch(TheCPU.X) {
+    case 0x04: IL_BBR(); break;
+    case 0x06: IL_FBR(); break;
+    case 0x08: IL_BC();  break;
+    case 0x0A: IL_BV();  break;
+    case 0x0E: IL_BE();  break;
+    }
+}
+
+void BasicHLE::IL_BBR()
+{
+    SetNZ(--ZeroPage(TEMPHI));
+    IL_FBR();
+}
+
+void BasicHLE::IL_FBR()
+{
+    SetNZ(ZeroPage(TEMPHI));
+    TakeBranch();
+}
+
+void BasicHLE::TakeBranch()
+{
+    // LBL017
+    TheCPU.A = ZeroPage(TEMPLO);
+    ZeroPage(ILPC) = TheCPU.A;
+    TheCPU.A = ZeroPage(TEMPHI);
+    SetNZ(TheCPU.A);
+    ZeroPage(ILPC+1) = TheCPU.A;
+}
+
+void BasicHLE::IL_BC()
+{
+    U8& A = TheCPU.A;
+
+    A = ZeroPage(BASPC);
+    ZeroPage(BASSAV) = A;
+    A = ZeroPage(BASPC+1);
+    SetNZ(A);
+    ZeroPage(BASSAV+1) = A;
+
+    do {
+        ReadNonBlank(AddrBC + BCReadNonBlank);
+        ReadBasicByte(AddrBC + BCReadBasicByte);
+        A ^= RAM.Read(U16(ReadPointer(ILPC) + TheCPU.Y));
+        TheCPU.X = A;
+        ReadILByte(AddrBC + BCReadILByte);
+        A = TheCPU.X;
+        SetNZ(A);
+    } while(A == 0);
+
+    // Last character of IL string has bit 7 set
+    A = ASL(A);
+    if(A == 0)
+        return;
+
+    A = ZeroPage(BASSAV);
+    ZeroPage(BASPC) = A;
+    A = ZeroPage(BASSAV+1);
+    ZeroPage(BASPC+1) = A;
+    IL_FBR();
+}
+
+void BasicHLE::IL_BV()
+{
+    U8& A = TheCPU.A;
+
+    ReadNonBlank(AddrBV);
+    CMP(A, 0x5B);
+    if(TheCPU.Flags.C) {
+        IL_FBR();
+        return;
+    }
+    CMP(A, 0x41);
+    if(!TheCPU.Flags.C) {
+        IL_FBR();
+        return;
+    }
+    A = ASL(A);
+    Jsr(AddrBV + BVPushByte);
+    PushByte();
+    Rts();
+    NextBasicByte();
+}
+
+void BasicHLE::IL_BE()
+{
+    ReadNonBlank(AddrBE);
+    CMP(TheCPU.A, 0x0D);
+    if(!TheCPU.Flags.Z) {
+        IL_FBR();
+    }
+}
+
+void BasicHLE::IL_NE()
+{
+    TheCPU.X = ZeroPage(EXPSP);
+    SetNZ(TheCPU.X);
+    Negate();
+}
+
+void BasicHLE::IL_AD()
+{
+    U8& A = TheCPU.A;
+
+    PopOperands(AddrAD, false);
+    A = Stack(0);
+    A = ADC(A, Stack(2));
+    Stack(2) = A;
+    A = Stack(1);
+    A = ADC(A, Stack(3));
+    Stack(3) = A;
+}
+
+void BasicHLE::IL_SU()
+{
+    Jsr(AddrSU);
+    IL_NE();
+    Rts();
+    IL_AD();
+}
+
+void BasicHLE::IL_MP()
+{
+    U8& A = TheCPU.A;
+    U8& Y = TheCPU.Y;
+
+    PopOperands(AddrMP, false);
+    Y = 0x10;
+    A = Stack(2);
+    ZeroPage(TEMPLO) = A;
+    A = Stack(3);
+    SetNZ(A);
+    ZeroPage(TEMPHI) = A;
+
+    // Shift-and-add over 16 bits, high word of product ends up in TEMPLO/TEMPHI
+    do {
+        Stack(2) = ASL(Stack(2));
+        Stack(3) = ROL(Stack(3));
+        ZeroPage(TEMPLO) = ROL(ZeroPage(TEMPLO));
+        ZeroPage(TEMPHI) = ROL(ZeroPage(TEMPHI));
+        if(TheCPU.Flags.C) {
+            TheCPU.Flags.C = 0;
+            A = Stack(2);
+            A = ADC(A, Stack(0));
+            Stack(2) = A;
+            A = Stack(3);
+            A = ADC(A, Stack(1));
+            Stack(3) = A;
+        }
+        SetNZ(--Y);
+    } while(Y != 0);
+}
+
+void BasicHLE::IL_DV()
+{
+    U8& A = TheCPU.A;
+    U8& Y = TheCPU.Y;
+
+    PopOperands(AddrDV, false);
+
+    // Sign extend dividend into TEMPLO/TEMPHI and make it positive
+    A = Stack(3) & 0x80;
+    if(A != 0)
+        A = 0xFF;
+    SetNZ(A);
+    ZeroPage(TEMPLO) = A;
+    ZeroPage(TEMPHI) = A;
+    Push(A);
+    A = ADC(A, Stack(2));
+    Stack(2) = A;
+    A = Pop();
+    Push(A);
+    A = ADC(A, Stack(3));
+    Stack(3) = A;
+    A = Pop();
+    A ^= Stack(1);
+    SetNZ(A);
+    ZeroPage(SIGN) = A;
+    if(TheCPU.Flags.S) {
+        Jsr(AddrDV + DVNegate);
+        Negate();
+        Rts();
+    }
+
+    Y = 0x11;
+    A = Stack(0) | Stack(1);
+    SetNZ(A);
+
+    // Restoring division over 17 steps
+    do {
+        TheCPU.Flags.C = 1;
+        A = SBC(ZeroPage(TEMPLO), Stack(0));
+        Push(A);
+        A = SBC(ZeroPage(TEMPHI), Stack(1));
+        Push(A);
+        A ^= ZeroPage(TEMPHI);
+        SetNZ(A);
+        if(!TheCPU.Flags.S) {
+            A = Pop();
+            ZeroPage(TEMPHI) = A;
+            A = Pop();
+            SetNZ(A);
+            ZeroPage(TEMPLO) = A;
+            TheCPU.Flags.C = 1;
+        }
+        else {
+            Pop();
+            A = Pop();
+            SetNZ(A);
+            TheCPU.Flags.C = 0;
+        }
+        Stack(2) = ROL(Stack(2));
+        Stack(3) = ROL(Stack(3));
+        ZeroPage(TEMPLO) = ROL(ZeroPage(TEMPLO));
+        ZeroPage(TEMPHI) = ROL(ZeroPage(TEMPHI));
+        SetNZ(--Y);
+    } while(Y != 0);
+
+    A = ZeroPage(SIGN);
+    SetNZ(A);
+    if(TheCPU.Flags.S) {
+        IL_NE();
+    }
+}
+
+void BasicHLE::IL_FV()
+{
+    U8& A = TheCPU.A;
+    U8& X = TheCPU.X;
+    U8& Y = TheCPU.Y;
+
+    PopByte(AddrFV);
+    X = A;
+    A = Stack(0);
+    Y = Stack(1);
+    SetNZ(--ZeroPage(EXPSP));
+    X = ZeroPage(EXPSP);
+    SetNZ(X);
+    Stack(0) = Y;
+    PushByte();
+}
+
+void BasicHLE::IL_SV()
+{
+    U8& A = TheCPU.A;
+    U8& X = TheCPU.X;
+
+    X = 0x7D;
+    PopOperands(AddrSV+2, true);
+    Push(Stack(1));
+    A = Stack(0);
+    Push(A);
+    PopByte(AddrSV+11);
+    X = A;
+    A = Pop();
+    Stack(0) = A;
+    A = Pop();
+    SetNZ(A);
+    Stack(1) = A;
+}
+
+void BasicHLE::IL_LB()
+{
+    ReadILByte(AddrLB);
+    PushByte();
+}
+
+void BasicHLE::IL_LN()
+{
+    Jsr(AddrLN);
+    IL_LB();
+    Rts();
+    IL_LB();
+}
+
+void BasicHLE::IL_SP(const U16 Site)
+{
+    Jsr(Site);
+    PopByte(AddrSP);
+    ZeroPage(TEMPLO) = TheCPU.A;
+    PopByte(AddrSP+5);
+    ZeroPage(TEMPHI) = TheCPU.A;
+    Rts();
+}
+
+void BasicHLE::PopOperands(const U16 Site, const bool KeepX)
+{
+    // LBL115 (LBL048 if X already holds the limit)
+    Jsr(Site);
+    if(!KeepX) {
+        TheCPU.X = 0x7C;
+    }
+    CMP(TheCPU.X, ZeroPage(EXPSP));
+    TheCPU.X = ZeroPage(EXPSP);
+    ZeroPage(EXPSP) += 2;
+    SetNZ(ZeroPage(EXPSP));
+    TheCPU.Flags.C = 0;
+    Rts();
+}
+
+void BasicHLE::ReadILByte(const U16 Site)
+{
+    Jsr(Site);
+    NextILByte();
+    Rts();
+}
+
+void BasicHLE::NextILByte()
+{
+    // LBL004
+    TheCPU.Y = 0;
+    TheCPU.A = RAM.Read(ReadPointer(ILPC));
+    if(++ZeroPage(ILPC) == 0)
+        ++ZeroPage(ILPC+1);
+    SetNZ(TheCPU.A);
+}
+
+void BasicHLE::ReadBasicByte(const U16 Site)
+{
+    Jsr(Site);
+    NextBasicByte();
+    Rts();
+}
+
+void BasicHLE::NextBasicByte()
+{
+    // LBL024
+    TheCPU.Y = 0;
+    TheCPU.A = RAM.Read(ReadPointer(BASPC));
+    if(++ZeroPage(BASPC) == 0)
+        ++ZeroPage(BASPC+1);
+    CMP(TheCPU.A, 0x0D);
+    TheCPU.Flags.C = 0;
+}
+
+void BasicHLE::ReadNonBlank(const U16 Site)
+{
+    // LBL023, skips blanks through LBL031
+    U8& A = TheCPU.A;
+
+    Jsr(Site);
+    for(;;) {
+        A = RAM.Read(U16(ReadPointer(BASPC) + TheCPU.Y));
+        CMP(A, ' ');
+        if(!TheCPU.Flags.Z)
+            break;
+        ReadBasicByte(AddrLBL023 - 3);
+    }
+    CMP(A, 0x3A);
+    TheCPU.Flags.C = 0;
+    if(TheCPU.Flags.S) {
+        CMP(A, 0x30);
+    }
+    Rts();
+}
+
+void BasicHLE::ReadLineNumber(const U16 Site)
+{
+    // LBL037
+    Jsr(Site);
+    ReadBasicByte(AddrLBL037);
+    ZeroPage(LINENO) = TheCPU.A;
+    ReadBasicByte(AddrLBL037+5);
+    ZeroPage(LINENO+1) = TheCPU.A;
+    TheCPU.A |= ZeroPage(LINENO);
+    SetNZ(TheCPU.A);
+    Rts();
+}
+
+void BasicHLE::PopByte(const U16 Site)
+{
+    // LBL097
+    Jsr(Site);
+    TheCPU.X = ZeroPage(EXPSP);
+    CMP(TheCPU.X, 0x80);
+    TheCPU.A = Stack(0);
+    SetNZ(++ZeroPage(EXPSP));
+    Rts();
+}
+
+void BasicHLE::PushByte()
+{
+    // LBL029, entered with JMP
+    TheCPU.X = ZeroPage(EXPSP) - 1;
+    Stack(0) = TheCPU.A;
+    ZeroPage(EXPSP) = TheCPU.X;
+    CMP(TheCPU.X, ZeroPage(EXPLIM));
+}
+
+void BasicHLE::Negate()
+{
+    // LBL118
+    U8& A = TheCPU.A;
+
+    TheCPU.Flags.C = 1;
+    A = SBC(TheCPU.Y, Stack(0));
+    Stack(0) = A;
+    A = SBC(TheCPU.Y, Stack(1));
+    Stack(1) = A;
+}
+
+void BasicHLE::FindLine(const bool FromStart)
+{
+    U8& A = TheCPU.A;
+
+    if(!FromStart) {
+        IL_SP(FindLineAddr);
+        A = ZeroPage(TEMPLO) | ZeroPage(TEMPHI);
+        SetNZ(A);
+    }
+
+    A = ZeroPage(PRGBEG+1);
+    SetNZ(A);
+    ZeroPage(BASPC)   = ZeroPage(PRGBEG);
+    ZeroPage(BASPC+1) = A;
+
+    for(;;) {
+        ReadLineNumber(FindLineAddr + FindLineReadLineNo);
+        if(TheCPU.Flags.Z)
+            break;
+
+        CMP(ZeroPage(LINENO), ZeroPage(TEMPLO));
+        A = SBC(ZeroPage(LINENO+1), ZeroPage(TEMPHI));
+        if(TheCPU.Flags.C)
+            break;
+
+        do {
+            ReadBasicByte(FindLineAddr + FindLineSkipText);
+        } while(!TheCPU.Flags.Z);
+    }
+
+    A = ZeroPage(LINENO) ^ ZeroPage(TEMPLO);
+    if(A == 0)
+        A = ZeroPage(LINENO+1) ^ ZeroPage(TEMPHI);
+    SetNZ(A);
+}
@@ -0,0 +1,101 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef BASIC_H
+#define BASIC_H
+
+#include "common.h"
+#include "hle.h"
+
+// High-level emulation of Tiny BASIC IL interpreter hot paths
+class BasicHLE : public HLE
+{
+public:
+    BasicHLE(CPU* InCPU);
+
+    // Locates Tiny BASIC interpreter in memory, must be called after ROM is loaded
+    void Attach();
+
+    // Called on JSR, returns false to execute the real routine
+    bool Call(const U16 Addr);
+
+    // Finds interpreter routines in memory, returns false if not recognized
+    bool Locate();
+    U16  DispatchAddr() const { return Dispatch; }
+
+private:
+    enum Routine {
+        R_Dispatch = 0,
+        R_ReadIL,
+        R_FindLine,
+        R_FindLineFromStart,
+    };
+
+    bool Prepare(const int Routine) override;
+    void Execute(const int Routine) override;
+    const char* RoutineName(const int Routine) const override;
+    U32 Cost(const int Routine) const override;
+
+    bool Match(const U16 Addr, const int* Pattern, const size_t Length) const;
+    U16  Operand(const U16 Addr) const;
+    U16  Handler(const U8 OpCode) const;
+    bool ScanTerminates(const U16 LineNumber) const;
+    bool PrepareJump() const;
+    bool PrepareBranch() const;
+    bool SkipBlanks(U16& Addr) const;
+    bool MatchTerminates() const;
+
+    // IL control flow
+    void HandlerJump();
+    void TakeBranch();
+    void IL_J();
+    void IL_BR();
+    void IL_BBR();
+    void IL_FBR();
+    void IL_BC();
+    void IL_BV();
+    void IL_BE();
+
+    // IL operations
+    void IL_NE();
+    void IL_AD();
+    void IL_SU();
+    void IL_MP();
+    void IL_DV();
+    void IL_FV();
+    void IL_SV();
+    void IL_LB();
+    void IL_LN();
+    void IL_SP(const U16 Site);
+
+    // Interpreter subroutines
+    void PopOperands(const U16 Site, const bool KeepX);
+    void ReadILByte(const U16 Site);
+    void NextILByte();
+    void ReadBasicByte(const U16 Site);
+    void NextBasicByte();
+    void ReadNonBlank(const U16 Site);
+    void ReadLineNumber(const U16 Site);
+    void PopByte(const U16 Site);
+    void PushByte();
+    void Negate();
+    void FindLine(const bool FromStart);
+
+    // Zero-page location indexed by X, as in LDA $00,X
+    inline U8& Stack(const U8 Offset);
+
+    U16 Dispatch;
+    U16 FindLineAddr;
+    U16 SRVT;
+
+    U16 AddrLBL002, AddrLBL011, AddrLBL016, AddrLBL023;
+    U16 AddrBBR, AddrFBR, AddrBC, AddrBV, AddrBE;
+    U16 AddrLBL004, AddrLBL024, AddrLBL029, AddrLBL037, AddrLBL097, AddrLBL115;
+    U16 AddrNE, AddrAD, AddrSU, AddrMP, AddrDV, AddrFV, AddrSV, AddrLB, AddrLN, AddrSP;
+
+    U8 OpCode;
+};
+
+#endif // BASIC_H
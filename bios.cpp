@@ -0,0 +1,319 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cstring>
+#include "cpu.h"
+#include "bios.h"
+
+namespace {
+    const U8 MaxCol = 40;
+    const U8 MaxRow = 25;
+
+    const U8 CR = 0x0D;
+    const U8 BS = 0x08;
+
+    const U16 VRAM = 0xF000;
+
+    // DMA controller registers & commands
+    const U16 DMASRCL = 0xFD10;
+    const U16 DMASRCH = 0xFD11;
+    const U16 DMADSTL = 0xFD12;
+    const U16 DMADSTH = 0xFD13;
+    const U16 DMALENL = 0xFD14;
+    const U16 DMALENH = 0xFD15;
+    const U16 DMAFIL  = 0xFD16;
+    const U16 DMACTL  = 0xFD17;
+    const U8  DMACOPY = 0x80;
+    const U8  DMAFILL = 0x81;
+
+    // Zero-page locations used by BIOS
+    const U8 TEMP     = 0xFA;
+    const U8 VRAMOFF0 = 0xFC;
+    const U8 VRAMOFF1 = 0xFE;
+
+    // Jump table entries handled natively
+    const U16 EntryPoints[] = {
+        0xFF06, // PUTCHR
+        0xFF09, // SCROLL
+        0xFF0C, // SETCOL
+        0xFF0F, // SETROW
+        0xFF15, // CLRSCR
+    };
+    const char* RoutineNames[] = {
+        "PUTCHR", "SCROLL", "SETCOL", "SETROW", "CLRSCR",
+    };
+
+    // Routine prologues expected in the BIOS image (-1 matches any byte)
+    const int Prologues[][12] = {
+        { 0x08, 0x48, 0x85, TEMP, 0x98, 0x48, 0xAC, -1, -1, 0xAD, -1, -1 },
+        { 0x08, 0x48, 0x98, 0x48, 0x8A, 0x48, 0xAD, -1, -1, 0xD0, -1, -1 },
+        { 0x08, 0xC0, MaxCol, 0x10, -1, 0x48, 0x98, 0x48, 0xAC, -1, -1, -1 },
+        { 0x08, 0xE0, MaxRow, 0x10, -1, 0x48, 0x8A, 0x48, 0x98, 0x48, -1, -1 },
+        { 0x08, 0x48, 0x8A, 0x48, 0x98, 0x48, 0xA9, VRAM & 0xFF, -1, -1, -1, -1 },
+    };
+}
+
+BiosHLE::BiosHLE(CPU* InCPU)
+    : HLE(InCPU, "BIOS")
+    , TTYCOL(0), TTYROW(0), CURSOR(0), DMAOK(0)
+{}
+
+void BiosHLE::Attach()
+{
+    Enabled = false;
+    if(!TheCPU.Settings.HLE)
+        return;
+
+    for(int i=0; i<R_Count; i++) {
+        const U16 Entry = EntryPoints[i];
+        if(RAM.Memory[Entry] != 0x4C) {
+            std::fprintf(stderr, "BIOS HLE: no jump at $%04x, disabled\n", Entry);
+            return;
+        }
+        Target[i] = RAM.Memory[Entry+1] | RAM.Memory[U16(Entry+2)] << 8;
+
+        for(int j=0; j<12; j++) {
+            if(Prologues[i][j] >= 0 && RAM.Memory[U16(Target[i]+j)] != Prologues[i][j]) {
+                std::fprintf(stderr, "BIOS HLE: unrecognized %s routine at $%04x, disabled\n", RoutineNames[i], Target[i]);
+                return;
+            }
+        }
+    }
+
+    // PUTCHR begins with LDY TTYCOL followed by LDA CURSOR
+    TTYCOL = RAM.Memory[U16(Target[R_PUTCHR]+7)] | RAM.Memory[U16(Target[R_PUTCHR]+8)] << 8;
+    TTYROW = TTYCOL + 1;
+    CURSOR = RAM.Memory[U16(Target[R_PUTCHR]+10)] | RAM.Memory[U16(Target[R_PUTCHR]+11)] << 8;
+    // SCROLL checks for DMA controller with LDA DMAOK
+    DMAOK  = RAM.Memory[U16(Target[R_SCROLL]+7)] | RAM.Memory[U16(Target[R_SCROLL]+8)] << 8;
+    if(CURSOR != TTYCOL + 2 || DMAOK != TTYCOL + 4) {
+        std::fprintf(stderr, "BIOS HLE: unexpected TTY variables layout, disabled\n");
+        return;
+    }
+
+    Enabled = true;
+    EnableVerify(TheCPU.Settings.HLEVerify);
+    std::printf("BIOS HLE enabled%s, TTY variables at $%04x\n", TheCPU.Settings.HLEVerify ? " (verification mode)" : "", TTYCOL);
+}
+
+bool BiosHLE::Call(const U16 Addr, const bool Jump)
+{
+    int Which = 0;
+    while(Which < R_Count && EntryPoints[Which] != Addr)
+        Which++;
+    if(Which == R_Count)
+        return false;
+
+    return Run(Which, Jump);
+}
+
+bool BiosHLE::Prepare(const int Which)
+{
+    // Jump table might have been patched by software
+    const U16 Addr = EntryPoints[Which];
+    return RAM.Memory[Addr] == 0x4C && (RAM.Memory[Addr+1] | RAM.Memory[Addr+2] << 8) == Target[Which];
+}
+
+void BiosHLE::Execute(const int Which)
+{
+    switch(Which) {
+    case R_PUTCHR: PUTCHR(); break;
+    case R_SCROLL: SCROLL(); break;
+    case R_SETCOL: SETCOL(); break;
+    case R_SETROW: SETROW(); break;
+    case R_CLRSCR: CLRSCR(); break;
+    }
+}
+
+const char* BiosHLE::RoutineName(const int Which) const
+{
+    return RoutineNames[Which];
+}
+
+void BiosHLE::PUTCHR()
+{
+    Push(PackFlags() | 0x30);
+    Push(TheCPU.A);
+    ZeroPage(TEMP) = TheCPU.A;
+    Push(TheCPU.Y);
+
+    U8 Col = RAM[TTYCOL];
+    if(RAM[CURSOR])
+        RAM.Write(ReadPointer(VRAMOFF0) + Col, 0);
+
+    const U8 Char = ZeroPage(TEMP);
+    bool NextLine = false;
+
+    if(Char == CR) {
+        NextLine = true;
+    }
+    else if(Char == BS) {
+        if(Col != 0) {
+            RAM.Write(TTYCOL, --Col);
+            if(const U8 Cursor = RAM[CURSOR])
+                RAM.Write(ReadPointer(VRAMOFF0) + Col, Cursor);
+        }
+    }
+    else {
+        RAM.Write(ReadPointer(VRAMOFF0) + Col, Char);
+        if(++Col == MaxCol) {
+            NextLine = true;
+        }
+        else {
+            RAM.Write(TTYCOL, Col);
+            if(const U8 Cursor = RAM[CURSOR])
+                RAM.Write(ReadPointer(VRAMOFF0) + Col, Cursor);
+        }
+    }
+
+    if(NextLine) {
+        RAM.Write(TTYCOL, 0);
+        const U8 Row = RAM[TTYROW] + 1;
+        if(Row == MaxRow) {
+            // Falls through to SCROLL which restores registers on its own
+            Push(TheCPU.X);
+            SCROLLRows();
+            TheCPU.X = Pop();
+        }
+        else {
+            RAM.Write(TTYROW, Row);
+            WritePointer(VRAMOFF0, ReadPointer(VRAMOFF0) + MaxCol);
+        }
+    }
+
+    TheCPU.Y = Pop();
+    TheCPU.A = Pop();
+    UnpackFlags(Pop() | 0x30);
+}
+
+void BiosHLE::SCROLL()
+{
+    Push(PackFlags() | 0x30);
+    Push(TheCPU.A);
+    Push(TheCPU.Y);
+    Push(TheCPU.X);
+
+    SCROLLRows();
+
+    TheCPU.X = Pop();
+    TheCPU.Y = Pop();
+    TheCPU.A = Pop();
+    UnpackFlags(Pop() | 0x30);
+}
+
+void BiosHLE::SCROLLRows()
+{
+    // BIOS always scrolls at fixed VRAM address, which never overlaps MMIO page
+    const U16 LastRow = VRAM + (MaxRow-1)*MaxCol;
+    if(RAM[DMAOK]) {
+        // Same register writes as BIOS, leaving DMA controller in the same state
+        RAM.Write(DMASRCL, (VRAM + MaxCol) & 0xFF);
+        RAM.Write(DMASRCH, (VRAM + MaxCol) >> 8);
+        RAM.Write(DMADSTL, VRAM & 0xFF);
+        RAM.Write(DMADSTH, VRAM >> 8);
+        RAM.Write(DMALENL, ((MaxRow-1)*MaxCol) & 0xFF);
+        RAM.Write(DMALENH, ((MaxRow-1)*MaxCol) >> 8);
+        RAM.Write(DMACTL,  DMACOPY);
+        RAM.Write(DMALENL, MaxCol);
+        RAM.Write(DMALENH, 0);
+        RAM.Write(DMAFIL,  0);
+        RAM.Write(DMACTL,  DMAFILL);
+    }
+    else {
+        std::memmove(&RAM.Memory[VRAM], &RAM.Memory[VRAM + MaxCol], (MaxRow-1)*MaxCol);
+        std::memset(&RAM.Memory[LastRow], 0, MaxCol);
+    }
+
+    WritePointer(VRAMOFF0, LastRow);
+    WritePointer(VRAMOFF1, LastRow);
+}
+
+void BiosHLE::SETCOL()
+{
+    Push(PackFlags() | 0x30);
+    if(!(U8(TheCPU.Y - MaxCol) & 0x80)) {
+        UnpackFlags(Pop() | 0x30);
+        TheCPU.Flags.C = 1;
+        return;
+    }
+    Push(TheCPU.A);
+    Push(TheCPU.Y);
+
+    const U8 Col = RAM[TTYCOL];
+    if(Col != MaxCol && RAM[CURSOR])
+        RAM.Write(ReadPointer(VRAMOFF0) + Col, 0);
+
+    TheCPU.Y = Pop();
+    RAM.Write(ReadPointer(VRAMOFF0) + TheCPU.Y, RAM[CURSOR]);
+    RAM.Write(TTYCOL, TheCPU.Y);
+
+    TheCPU.A = Pop();
+    UnpackFlags(Pop() | 0x30);
+    TheCPU.Flags.C = 0;
+}
+
+void BiosHLE::SETROW()
+{
+    Push(PackFlags() | 0x30);
+    if(!(U8(TheCPU.X - MaxRow) & 0x80)) {
+        UnpackFlags(Pop() | 0x30);
+        TheCPU.Flags.C = 1;
+        return;
+    }
+    Push(TheCPU.A);
+    Push(TheCPU.X);
+    Push(TheCPU.Y);
+
+    const U8 Col = RAM[TTYCOL];
+    if(Col != MaxCol && RAM[CURSOR])
+        RAM.Write(ReadPointer(VRAMOFF0) + Col, 0);
+
+    RAM.Write(TTYROW, TheCPU.X);
+    WritePointer(VRAMOFF0, VRAM + TheCPU.X * MaxCol);
+
+    if(Col != MaxCol) {
+        if(const U8 Cursor = RAM[CURSOR])
+            RAM.Write(ReadPointer(VRAMOFF0) + Col, Cursor);
+    }
+
+    TheCPU.Y = Pop();
+    TheCPU.X = Pop();
+    TheCPU.A = Pop();
+    UnpackFlags(Pop() | 0x30);
+    TheCPU.Flags.C = 0;
+}
+
+void BiosHLE::CLRSCR()
+{
+    Push(PackFlags() | 0x30);
+    Push(TheCPU.A);
+    Push(TheCPU.X);
+    Push(TheCPU.Y);
+
+    WritePointer(VRAMOFF0, VRAM);
+    RAM.Write(TTYROW, 0);
+    RAM.Write(TTYCOL, 0);
+
+    // Clears four full pages, including unused bytes past the last row
+    if(RAM[DMAOK]) {
+        RAM.Write(DMAFIL,  0);
+        RAM.Write(DMADSTL, VRAM & 0xFF);
+        RAM.Write(DMADSTH, VRAM >> 8);
+        RAM.Write(DMALENL, 0);
+        RAM.Write(DMALENH, 4);
+        RAM.Write(DMACTL,  DMAFILL);
+    }
+    else {
+        std::memset(&RAM.Memory[VRAM], 0, 4*256);
+    }
+    WritePointer(VRAMOFF1, VRAM + 4*256);
+
+    RAM.Write(ReadPointer(VRAMOFF0), RAM[CURSOR]);
+
+    TheCPU.Y = Pop();
+    TheCPU.X = Pop();
+    TheCPU.A = Pop();
+    UnpackFlags(Pop() | 0x30);
+}
@@ -0,0 +1,49 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef BIOS_H
+#define BIOS_H
+
+#include "common.h"
+#include "hle.h"
+
+// High-level emulation of BIOS text output routines
+class BiosHLE : public HLE
+{
+public:
+    BiosHLE(CPU* InCPU);
+
+    // Locates BIOS routines in memory, must be called after ROM is loaded
+    void Attach();
+
+    // Called on JSR or JMP to BIOS jump table, returns false to execute the real routine
+    bool Call(const U16 Addr, const bool Jump);
+
+private:
+    enum Routine {
+        R_PUTCHR = 0,
+        R_SCROLL,
+        R_SETCOL,
+        R_SETROW,
+        R_CLRSCR,
+        R_Count,
+    };
+
+    bool Prepare(const int Routine) override;
+    void Execute(const int Routine) override;
+    const char* RoutineName(const int Routine) const override;
+
+    void PUTCHR();
+    void SCROLL();
+    void SCROLLRows();
+    void SETCOL();
+    void SETROW();
+    void CLRSCR();
+
+    U16 Target[R_Count];
+    U16 TTYCOL, TTYROW, CURSOR, DMAOK;
+};
+
+#endif // BIOS_H
@@ -8,7 +8,6 @@
 
 #include <cstdio>
 #include <cstdint>
-#include <SDL2/SDL.h>
 
 #ifndef UNUSED
 #define UNUSED(x) (void)(x)
@@ -26,6 +25,7 @@ typedef int16_t  S16;
 typedef uint16_t U16;
 typedef int32_t  S32;
 typedef uint32_t U32;
+typedef uint64_t U64;
 
 namespace {
     const U32 CPUFREQ = 1000;
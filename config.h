@@ -0,0 +1,91 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include "common.h"
+
+// Host audio sample format
+enum class SampleFormat
+{
+    U8,
+    S16,
+    F32,
+};
+
+// Emulator configuration (set from command line)
+struct Config
+{
+    Config()
+        : Turbo(false)
+        , Threads(false)
+        , AudioRate(44100)
+        , CMOS(false)
+        , ExactTiming(false)
+        , DMA(true)
+        , Timer(true)
+        , DebugPort(true)
+        , HLE(false)
+        , HLEBasic(false)
+        , HLEVerify(false)
+        , HLECycles(40)
+        , ProfileBasic(false)
+        , Coverage(false)
+        , TraceSize(0)
+        , Timeline(false)
+    {}
+
+    // Run as fast as possible instead of real time
+    bool Turbo;
+    // Render video & synthesize audio on separate threads
+    bool Threads;
+
+    // Audio output sample rate
+    U32  AudioRate;
+
+    // Emulate 65C02 instruction set instead of NMOS 6502
+    bool CMOS;
+    // Charge documented per-instruction cycle counts instead of approximate ones
+    bool ExactTiming;
+
+    // Attach DMA controller
+    bool DMA;
+    // Attach interval timer
+    bool Timer;
+    // Attach single-step port used by System Monitor trace
+    bool DebugPort;
+    // Host directory backing storage device, not attached if empty
+    std::string StorageDir;
+    // Host file backing bank-switched memory expansion, not attached if empty
+    std::string ExpansionFile;
+
+    // Execute BIOS text output routines natively
+    bool HLE;
+    // Execute Tiny BASIC interpreter hot paths natively
+    bool HLEBasic;
+    // Compare native routines against ROM code instead of replacing them
+    bool HLEVerify;
+    // Cycles charged for each natively executed routine
+    U32  HLECycles;
+
+    // Report cycles spent in Tiny BASIC program lines at exit
+    bool ProfileBasic;
+    // Record executed instructions & branch directions
+    bool Coverage;
+
+    // Instructions kept in trace ring buffer, no tracing if zero
+    U32  TraceSize;
+    // File trace ring buffer is dumped to
+    std::string TraceFile;
+    // File every traced instruction is streamed to
+    std::string TraceStream;
+
+    // Record interrupts, frames, audio blocks & sleeps on host and emulated time
+    bool Timeline;
+};
+
+#endif // CONFIG_H
@@ -0,0 +1,68 @@
+# Emulator core, independent of SDL
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/cpu.cpp \
+    $$PWD/mcc.cpp \
+    $$PWD/vpu.cpp \
+    $$PWD/keyboard.cpp \
+    $$PWD/dma.cpp \
+    $$PWD/pit.cpp \
+    $$PWD/storage.cpp \
+    $$PWD/uart.cpp \
+    $$PWD/loader.cpp \
+    $$PWD/debugport.cpp \
+    $$PWD/expansion.cpp \
+    $$PWD/spu.cpp \
+    $$PWD/device.cpp \
+    $$PWD/host.cpp \
+    $$PWD/synth.cpp \
+    $$PWD/wavefile.cpp \
+    $$PWD/hle.cpp \
+    $$PWD/bios.cpp \
+    $$PWD/basic.cpp \
+    $$PWD/profiler.cpp \
+    $$PWD/debugger.cpp \
+    $$PWD/coverage.cpp \
+    $$PWD/tracer.cpp \
+    $$PWD/opcodes.cpp \
+    $$PWD/timeline.cpp \
+    $$PWD/timing.cpp
+
+HEADERS += \
+    $$PWD/cpu.h \
+    $$PWD/common.h \
+    $$PWD/mcc.h \
+    $$PWD/vpu.h \
+    $$PWD/keyboard.h \
+    $$PWD/dma.h \
+    $$PWD/pit.h \
+    $$PWD/storage.h \
+    $$PWD/uart.h \
+    $$PWD/loader.h \
+    $$PWD/debugport.h \
+    $$PWD/expansion.h \
+    $$PWD/spu.h \
+    $$PWD/device.h \
+    $$PWD/config.h \
+    $$PWD/host.h \
+    $$PWD/ringbuffer.h \
+    $$PWD/worker.h \
+    $$PWD/synth.h \
+    $$PWD/wavefile.h \
+    $$PWD/hle.h \
+    $$PWD/bios.h \
+    $$PWD/basic.h \
+    $$PWD/profiler.h \
+    $$PWD/debugger.h \
+    $$PWD/coverage.h \
+    $$PWD/tracer.h \
+    $$PWD/opcodes.h \
+    $$PWD/timeline.h \
+    $$PWD/timing.h
+
+unix {
+    QMAKE_CXXFLAGS += -std=c++11 -pthread
+    LIBS += -pthread
+}
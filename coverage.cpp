@@ -0,0 +1,233 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "coverage.h"
+#include "loader.h"
+
+namespace {
+    const char FileMagic[8] = { 'B', '1', 'C', 'O', 'V', 'E', 'R', '1' };
+
+    const char* Mnemonics[] = {
+        "adc", "and", "asl", "bcc", "bcs", "beq", "bit", "bmi", "bne", "bpl", "bra", "brk", "bvc", "bvs",
+        "clc", "cld", "cli", "clv", "cmp", "cpx", "cpy", "dec", "dex", "dey", "eor", "inc", "inx", "iny",
+        "jmp", "jsr", "lda", "ldx", "ldy", "lsr", "nop", "ora", "pha", "php", "phx", "phy", "pla", "plp",
+        "plx", "ply", "rol", "ror", "rti", "rts", "sbc", "sec", "sed", "sei", "sta", "stp", "stx", "sty",
+        "stz", "tax", "tay", "trb", "tsb", "tsx", "txa", "txs", "tya", "wai",
+    };
+
+    const char* Branches[] = { "bpl", "bmi", "bvc", "bvs", "bcc", "bcs", "bne", "beq" };
+
+    enum LineKind {
+        LineData = 0,
+        LineCode,
+        LineBranch,
+    };
+
+    // Classifies source line by its mnemonic, labels & comments are skipped
+    LineKind Classify(const std::string& Text)
+    {
+        std::string Line = Text.substr(0, Text.find(';'));
+        const size_t Colon = Line.find(':');
+        if(Colon != std::string::npos)
+            Line = Line.substr(Colon + 1);
+
+        // Operation is first word of a line starting with whitespace or a label,
+        // try both since Tiny BASIC source has labels without colons
+        std::vector<std::string> Words;
+        size_t Pos = 0;
+        while(Words.size() < 2) {
+            const size_t Start = Line.find_first_not_of(" \t", Pos);
+            if(Start == std::string::npos)
+                break;
+            Pos = Line.find_first_of(" \t", Start);
+            Words.push_back(Line.substr(Start, Pos - Start));
+        }
+
+        for(std::string Word : Words) {
+            if(Word[0] == '.')
+                break;
+            if(Word.size() != 3)
+                continue;
+            for(char& Char : Word)
+                Char = char(std::tolower(Char));
+            for(const char* Branch : Branches) {
+                if(Word == Branch)
+                    return LineBranch;
+            }
+            for(const char* Mnemonic : Mnemonics) {
+                if(Word == Mnemonic)
+                    return LineCode;
+            }
+        }
+        return LineData;
+    }
+}
+
+Coverage::Coverage()
+    : Enabled(false)
+{
+    Executed.fill(0);
+    Taken.fill(0);
+    NotTaken.fill(0);
+}
+
+bool Coverage::Load(const char* FileName)
+{
+    std::ifstream File(FileName, std::ios::binary);
+    if(!File)
+        return false;
+
+    char Magic[sizeof(FileMagic)];
+    Bitmap Bits[3];
+    File.read(Magic, sizeof(Magic));
+    for(Bitmap& Map : Bits) {
+        File.read(reinterpret_cast<char*>(Map.data()), Map.size());
+    }
+    if(!File || std::memcmp(Magic, FileMagic, sizeof(FileMagic)) != 0)
+        return false;
+
+    for(size_t i=0; i<Executed.size(); i++) {
+        Executed[i] |= Bits[0][i];
+        Taken[i]    |= Bits[1][i];
+        NotTaken[i] |= Bits[2][i];
+    }
+    return true;
+}
+
+bool Coverage::Save(const char* FileName) const
+{
+    std::ofstream File(FileName, std::ios::binary);
+    if(!File)
+        return false;
+
+    File.write(FileMagic, sizeof(FileMagic));
+    File.write(reinterpret_cast<const char*>(Executed.data()), Executed.size());
+    File.write(reinterpret_cast<const char*>(Taken.data()), Taken.size());
+    File.write(reinterpret_cast<const char*>(NotTaken.data()), NotTaken.size());
+    return bool(File);
+}
+
+bool Coverage::WriteLcov(const char* DebugFileName, const char* OutFileName) const
+{
+    std::ifstream DebugFile(DebugFileName);
+    if(!DebugFile) {
+        std::fprintf(stderr, "Could not open debug file: %s\n", DebugFileName);
+        return false;
+    }
+
+    struct Span {
+        long Segment;
+        long Start;
+        long Size;
+    };
+
+    std::map<long, std::string> Files;
+    std::map<long, long>        Segments;
+    std::map<long, Span>        Spans;
+    std::vector<DebugRecord>    Lines;
+
+    std::string Line, Type;
+    DebugRecord Attributes;
+    while(std::getline(DebugFile, Line)) {
+        if(!ParseDebugRecord(Line, Type, Attributes))
+            continue;
+
+        const long Id = DebugAttribute(Attributes, "id");
+        if(Type == "file")
+            Files[Id] = Attributes["name"];
+        else if(Type == "seg")
+            Segments[Id] = DebugAttribute(Attributes, "start", 0);
+        else if(Type == "span")
+            Spans[Id] = Span{ DebugAttribute(Attributes, "seg"), DebugAttribute(Attributes, "start", 0), DebugAttribute(Attributes, "size", 0) };
+        else if(Type == "line" && Attributes.count("span"))
+            Lines.push_back(Attributes);
+    }
+    if(Files.empty()) {
+        std::fprintf(stderr, "No source files in debug file: %s\n", DebugFileName);
+        return false;
+    }
+
+    // Source paths are relative to directory ld65 was run from
+    const std::string BaseDir = DirectoryOf(DebugFileName);
+
+    // Start address of first span of every source line generating code or data
+    std::map<long, std::map<long, long>> Addresses;
+    for(const DebugRecord& Attributes : Lines) {
+        const long FileId = DebugAttribute(Attributes, "file");
+        const long LineNo = DebugAttribute(Attributes, "line");
+        const long SpanId = std::strtol(Attributes.at("span").c_str(), nullptr, 10);
+
+        auto SpanIt = Spans.find(SpanId);
+        if(SpanIt == Spans.end() || SpanIt->second.Size == 0)
+            continue;
+
+        const long Addr = Segments[SpanIt->second.Segment] + SpanIt->second.Start;
+        Addresses[FileId].insert(std::make_pair(LineNo, Addr));
+    }
+
+    std::ofstream Out(OutFileName);
+    if(!Out) {
+        std::fprintf(stderr, "Could not open output file: %s\n", OutFileName);
+        return false;
+    }
+
+    for(const auto& File : Addresses) {
+        std::string Path = Files[File.first];
+        if(Path.empty())
+            continue;
+        if(Path[0] != '/' && Path.find(':') == std::string::npos)
+            Path = BaseDir + Path;
+
+        std::vector<std::string> Source;
+        std::ifstream SourceFile(Path);
+        while(std::getline(SourceFile, Line)) {
+            Source.push_back(Line);
+        }
+
+        U32 LinesFound = 0, LinesHit = 0, BranchesFound = 0, BranchesHit = 0;
+        std::string Branches;
+
+        Out << "TN:\nSF:" << Path << "\n";
+        for(const auto& Entry : File.second) {
+            const long LineNo = Entry.first;
+            const U16  Addr   = U16(Entry.second);
+
+            LineKind Kind = LineCode;
+            if(LineNo > 0 && size_t(LineNo) <= Source.size())
+                Kind = Classify(Source[LineNo - 1]);
+            if(Kind == LineData)
+                continue;
+
+            const bool Hit = IsExecuted(Addr);
+            LinesFound++;
+            LinesHit += Hit;
+            Out << "DA:" << LineNo << "," << Hit << "\n";
+
+            if(Kind == LineBranch) {
+                const char* TakenCount    = !Hit ? "-" : IsTaken(Addr) ? "1" : "0";
+                const char* NotTakenCount = !Hit ? "-" : IsNotTaken(Addr) ? "1" : "0";
+                Branches += "BRDA:" + std::to_string(LineNo) + ",0,0," + TakenCount + "\n";
+                Branches += "BRDA:" + std::to_string(LineNo) + ",0,1," + NotTakenCount + "\n";
+                BranchesFound += 2;
+                BranchesHit   += IsTaken(Addr) + IsNotTaken(Addr);
+            }
+        }
+        Out << Branches;
+        Out << "BRF:" << BranchesFound << "\nBRH:" << BranchesHit << "\n";
+        Out << "LF:" << LinesFound << "\nLH:" << LinesHit << "\n";
+        Out << "end_of_record\n";
+
+        std::printf("%-24s %5u of %5u lines, %5u of %5u branch edges\n",
+                    Path.c_str(), LinesHit, LinesFound, BranchesHit, BranchesFound);
+    }
+    return bool(Out);
+}
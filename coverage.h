@@ -0,0 +1,68 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <array>
+#include "common.h"
+
+// Execution coverage of the whole address space.
+// One bit per address for executed opcodes and for taken and not taken
+// conditional branches. Coverage files are the three bitmaps and merge by OR.
+class Coverage
+{
+public:
+    Coverage();
+
+    // Called after every executed instruction while enabled
+    inline void Record(const U8 OpCode, const U16 OpAddr, const U16 NextAddr)
+    {
+        const U16 Index = OpAddr >> 3;
+        const U8  Bit   = 1 << (OpAddr & 7);
+
+        Executed[Index] |= Bit;
+        // Bxx opcodes are $10, $30, ... $F0, 65C02 BBR & BBS are $0F, $1F, ... $FF
+        if((OpCode & 0x1F) == 0x10) {
+            if(NextAddr == U16(OpAddr + 2))
+                NotTaken[Index] |= Bit;
+            else
+                Taken[Index] |= Bit;
+        }
+        else if((OpCode & 0x0F) == 0x0F) {
+            if(NextAddr == U16(OpAddr + 3))
+                NotTaken[Index] |= Bit;
+            else
+                Taken[Index] |= Bit;
+        }
+    }
+
+    // Merges coverage file into current coverage
+    bool Load(const char* FileName);
+    bool Save(const char* FileName) const;
+
+    // Writes lcov tracefile mapping coverage to source lines described by ld65 debug file
+    bool WriteLcov(const char* DebugFileName, const char* OutFileName) const;
+
+    bool IsExecuted(const U16 Addr) const { return Test(Executed, Addr); }
+    bool IsTaken(const U16 Addr) const    { return Test(Taken, Addr); }
+    bool IsNotTaken(const U16 Addr) const { return Test(NotTaken, Addr); }
+
+    bool Enabled;
+
+private:
+    typedef std::array<U8, MEMSIZE / 8> Bitmap;
+
+    static bool Test(const Bitmap& Bits, const U16 Addr)
+    {
+        return (Bits[Addr >> 3] >> (Addr & 7)) & 1;
+    }
+
+    Bitmap Executed;
+    Bitmap Taken;
+    Bitmap NotTaken;
+};
+
+#endif // COVERAGE_H
@@ -4,53 +4,139 @@
  */
 
 #include <cstring>
+#include <algorithm>
 #include "common.h"
 #include "cpu.h"
 
-CPU::CPU(const U32 InFreq, const U16 InHz, const char* Program, U16 Offset, size_t Size)
+CPU::CPU(const U32 InFreq, const U16 InHz, const Config& InConfig, const Host& InHost, const char* Program, U16 Offset, size_t Size)
     : A(0), X(0), Y(0), SP(0xFF), PC(0)
     , Cycles(0)
+    , TotalCycles(0)
+    , TotalInstructions(0)
+    , IdleCycles(0)
+    , Waiting(false)
+    , IRQLines(0)
+    , Stopped(false)
+    , StallCycles(0)
     , Frequency(InFreq*1000)
     , VideoHz(InHz)
+    , Settings(InConfig)
+    , Backends(InHost)
     , RAM()
     , Video(this)
     , Sound(this)
     , Kbd(this)
+    , Dma(this)
+    , Timer(this)
+    , Disk(this)
+    , Uart(this)
+    , Port(this)
+    , Xmem(this)
+    , Bios(this)
+    , Basic(this)
+    , Profiler(this)
+    , Debug(this)
+    , Cover()
+    , Trace(this)
+    , Events()
     , Interrupt(INT_Reset)
 {
-    if(SDL_InitSubSystem(SDL_INIT_TIMER) < 0) {
-        throw Device::Error(SDL_GetError());
+    if(!Backends.Wallclock) {
+        Backends.Wallclock = &DefaultClock;
     }
 
+    // Approximate timing only models the 6502, 65C02 always charges documented cycles
+    if(Settings.CMOS)
+        Settings.ExactTiming = true;
+
     FlagRegister() = 0;
-    std::memcpy(&RAM.Memory[Offset], Program, Size);
+    Cover.Enabled  = Settings.Coverage;
+    Events.Enabled = Settings.Timeline;
 
+    InterruptCycles  = Settings.ExactTiming ? U32(ExactTiming::InterruptCycles) : U32(FastTiming::InterruptCycles);
     CyclesPerJiffy   = (1000/VideoHz * Frequency) / 1000;
     CyclesSinceSleep = 0;
-    LastTimestamp    = SDL_GetTicks();
+    LastTimestamp    = Backends.Wallclock->Milliseconds();
+
+    // Memory may also be filled later, followed by Reset()
+    if(Program)
+        Load(Program, Offset, Size);
+}
+
+void CPU::Load(const char* Program, U16 Offset, size_t Size)
+{
+    Size = std::min<size_t>(Size, MEMSIZE - Offset);
+    if(Size > 0)
+        std::memcpy(&RAM.Memory[Offset], Program, Size);
+    Reset();
+}
 
-    std::printf("CPU is 6502 compatible running at %d cycles per second\n", Frequency);
-    std::printf("Target video refresh rate is %dHz, jiffy is %d cycles\n", VideoHz, CyclesPerJiffy);
-    std::printf("Loaded ROM file at address $%04x (%lu bytes)\n", Offset, Size);
+void CPU::Reset()
+{
+    // Native routines are located in newly loaded code
+    Bios.Attach();
+    Basic.Attach();
+    Profiler.Attach();
+
+    Waiting   = false;
+    Stopped   = false;
+    Interrupt = INT_Reset;
 }
 
 void CPU::Tick()
 {
     Cycles = 0;
-    ServiceInterrupt();
-    Step();
+    if(Port.Active)
+        Port.Check();
+    // Asserted IRQ lines are sampled before every instruction, so masked
+    // requests are serviced as soon as interrupts are enabled again
+    if(IRQLines && !Flags.I && Interrupt == INT_None)
+        Interrupt = INT_IRQ;
+    // Stopped CPU only leaves STP by reset
+    if(!Stopped || Interrupt == INT_Reset)
+        ServiceInterrupt();
+    if(Debug.Active && Debug.Check()) {
+        // Stopped by debugger, real time pacing starts over when it resumes
+        CyclesSinceSleep = 0;
+        LastTimestamp    = Backends.Wallclock->Milliseconds();
+    }
+    else if(Waiting || Stopped) {
+        // Nothing to execute, skip ahead to next scanline or timer expiry
+        Cycles = std::max(std::min(Video.CyclesToTick(), Timer.CyclesToEvent()), 1u);
+        IdleCycles += Cycles;
+        Kbd.FeedInjected();
+    }
+    else {
+        if(Settings.ExactTiming)
+            Step<ExactTiming>();
+        else
+            Step<FastTiming>();
+        TotalInstructions++;
+    }
+    Cycles += StallCycles;
+    StallCycles = 0;
 
     Video.Tick(Cycles);
     Sound.Tick(Cycles);
+    Timer.Tick(Cycles);
+    Uart.Tick(Cycles);
+
+    TotalCycles += Cycles;
+
+    if(Settings.Turbo)
+        return;
 
     CyclesSinceSleep += Cycles;
     if(CyclesSinceSleep >= CyclesPerJiffy) {
-        const S32 TimeToSleep = 1000/VideoHz - (SDL_GetTicks() - LastTimestamp);
+        const S32 TimeToSleep = 1000/VideoHz - (Backends.Wallclock->Milliseconds() - LastTimestamp);
         if(TimeToSleep > 0) {
-            SDL_Delay(TimeToSleep);
+            const U64 SleepStart = Events.Enabled ? Events.Now() : 0;
+            Backends.Wallclock->Sleep(TimeToSleep);
+            if(Events.Enabled)
+                Events.Complete(Timeline::EventSleep, Timeline::ThreadCPU, SleepStart, TotalCycles, TotalCycles, TimeToSleep);
         }
 
-        const U32 TimeNow       = SDL_GetTicks();
+        const U32 TimeNow       = Backends.Wallclock->Milliseconds();
         const U32 TimeElapsed   = TimeNow - LastTimestamp;
         const U32 CyclesElapsed = TimeElapsed/1000.0 * Frequency;
 
@@ -59,8 +145,12 @@ void CPU::Tick()
     }
 }
 
+template<class Timing>
 void CPU::Step()
 {
+    const U32 StartCycles = Cycles;
+    const U16 OpAddr      = PC;
+
     Cycles += 2;
     const U8 OpCode = RAM[PC++];
 
@@ -185,11 +275,25 @@ void CPU::Step()
     case 0xFE: { Ref Mem = RefAbsolute(X); Write(Mem = Op(Mem+1, SF_S|SF_Z)); } break;
 
     // JMP
-    case 0x4C: PC = ReadImmediate16(); break;
+    case 0x4C: {
+        const U16 Addr = ReadImmediate16();
+        if(Bios.Enabled && (Addr >> 8) == 0xFF && Bios.Call(Addr, true))
+            break;
+        PC = Addr;
+    } break;
     case 0x6C: PC = ReadAbsolute16();  break;
 
     // JSR
-    case 0x20: { const U16 Addr = ReadImmediate16(); StackPush16(PC-1); PC = Addr; } break;
+    case 0x20: {
+        const U16 Addr = ReadImmediate16();
+        if(Bios.Enabled && (Addr >> 8) == 0xFF && Bios.Call(Addr, false))
+            break;
+        if(Profiler.Enabled && Addr == Profiler.Dispatch)
+            Profiler.Sample();
+        if(Basic.Enabled && Basic.Call(Addr))
+            break;
+        StackPush16(PC-1); PC = Addr;
+    } break;
 
     // LDA
     case 0xA9: A = Op(ReadImmediate(), SF_S|SF_Z); break;
@@ -225,6 +329,9 @@ void CPU::Step()
     // NOP
     case 0xEA: break;
 
+    // WAI (65C02): halt until interrupt request, unless an IRQ is still pending
+    case 0xCB: Waiting = !IRQLines; Cycles += 1; break;
+
     // ORA
     case 0x09: A = Op(A | ReadImmediate(), SF_S|SF_Z); break;
     case 0x05: A = Op(A | RefZeroPage(),   SF_S|SF_Z); break;
@@ -270,7 +377,7 @@ void CPU::Step()
     case 0x40: FlagRegister() = StackPop() | 0x30; PC = StackPop16(); break;
 
     // RTS
-    case 0x60: PC = StackPop16()+1; break;
+    case 0x60: PC = StackPop16()+1; if(Bios.Pending) Bios.Return(); if(Basic.Pending) Basic.Return(); break;
 
     // SBC
     case 0xE9: A = OpSBC(A, ReadImmediate()); break;
@@ -315,9 +422,120 @@ void CPU::Step()
     case 0x28: FlagRegister() = StackPop() | 0x30; break;
 
     default:
+        if(Settings.CMOS && StepCMOS(OpCode))
+            break;
         std::fprintf(stderr, "Illegal opcode: %02x @ PC=%04x!\n", OpCode, PC-1);
+        if(Trace.Enabled)
+            Trace.DumpAfter(Tracer::TriggerIllegal);
         break;
     }
+
+    if(Cover.Enabled)
+        Cover.Record(OpCode, OpAddr, PC);
+
+    Timing::Account(*this, OpCode, OpAddr, StartCycles);
+
+    if(Trace.Enabled)
+        Trace.Record(OpCode, OpAddr, Cycles - StartCycles);
+}
+
+template void CPU::Step<FastTiming>();
+template void CPU::Step<ExactTiming>();
+
+bool CPU::StepCMOS(const U8 OpCode)
+{
+    switch(OpCode) {
+
+    // BRA
+    case 0x80: Branch(true); break;
+
+    // STZ
+    case 0x64: Write(RefZeroPage()  = 0); break;
+    case 0x74: Write(RefZeroPage(X) = 0); break;
+    case 0x9C: Write(RefAbsolute()  = 0); break;
+    case 0x9E: Write(RefAbsolute(X) = 0); break;
+
+    // PHX
+    case 0xDA: StackPush(X); break;
+    // PHY
+    case 0x5A: StackPush(Y); break;
+    // PLX
+    case 0xFA: X = Op(StackPop(), SF_S|SF_Z); break;
+    // PLY
+    case 0x7A: Y = Op(StackPop(), SF_S|SF_Z); break;
+
+    // INC A
+    case 0x1A: A = Op(A+1, SF_S|SF_Z); break;
+    // DEC A
+    case 0x3A: A = Op(A-1, SF_S|SF_Z); break;
+
+    // TSB
+    case 0x04: { Ref Mem = RefZeroPage(); Flags.Z = ((A & Mem) == 0); Write(Mem = Mem | A); } break;
+    case 0x0C: { Ref Mem = RefAbsolute(); Flags.Z = ((A & Mem) == 0); Write(Mem = Mem | A); } break;
+    // TRB
+    case 0x14: { Ref Mem = RefZeroPage(); Flags.Z = ((A & Mem) == 0); Write(Mem = Mem & ~A); } break;
+    case 0x1C: { Ref Mem = RefAbsolute(); Flags.Z = ((A & Mem) == 0); Write(Mem = Mem & ~A); } break;
+
+    // BIT (immediate mode affects only Z flag)
+    case 0x89: Flags.Z = ((A & ReadImmediate()) == 0); break;
+    case 0x34: {
+        const U8 Mem = RefZeroPage(X);
+        Flags.Z = ((A & Mem) == 0);
+        Flags.S = Flag(Mem & 0x80);
+        Flags.V = Flag(Mem & 0x40);
+    } break;
+    case 0x3C: {
+        const U8 Mem = RefAbsolute(X);
+        Flags.Z = ((A & Mem) == 0);
+        Flags.S = Flag(Mem & 0x80);
+        Flags.V = Flag(Mem & 0x40);
+    } break;
+
+    // (zp) addressing
+    case 0x12: A = Op(A | RefIndirect(), SF_S|SF_Z);  break;
+    case 0x32: A = Op(A & RefIndirect(), SF_S|SF_Z);  break;
+    case 0x52: A = Op(A ^ RefIndirect(), SF_S|SF_Z);  break;
+    case 0x72: A = OpADC(A, RefIndirect());           break;
+    case 0x92: Write(RefIndirect() = A);              break;
+    case 0xB2: A = Op(RefIndirect(), SF_S|SF_Z);      break;
+    case 0xD2: Op(A - RefIndirect(), SF_S|SF_Z|SF_NC); break;
+    case 0xF2: A = OpSBC(A, RefIndirect());           break;
+
+    // JMP (abs,X)
+    case 0x7C: PC = ReadAbsolute16(X); break;
+
+    // STP
+    case 0xDB: Stopped = true; Cycles += 1; break;
+
+    // RMB & SMB: clear or set bit of zero page location
+    case 0x07: case 0x17: case 0x27: case 0x37: case 0x47: case 0x57: case 0x67: case 0x77: {
+        Ref Mem = RefZeroPage(); Write(Mem = U8(Mem & ~(1 << (OpCode >> 4))));
+    } break;
+    case 0x87: case 0x97: case 0xA7: case 0xB7: case 0xC7: case 0xD7: case 0xE7: case 0xF7: {
+        Ref Mem = RefZeroPage(); Write(Mem = U8(Mem | (1 << ((OpCode >> 4) & 7))));
+    } break;
+
+    // BBR & BBS: branch if bit of zero page location is reset or set
+    case 0x0F: case 0x1F: case 0x2F: case 0x3F: case 0x4F: case 0x5F: case 0x6F: case 0x7F:
+    case 0x8F: case 0x9F: case 0xAF: case 0xBF: case 0xCF: case 0xDF: case 0xEF: case 0xFF: {
+        const U8 Mem = RefZeroPage();
+        Branch(Flag(Mem & (1 << ((OpCode >> 4) & 7))) == Flag(OpCode & 0x80));
+    } break;
+
+    // Undefined opcodes are NOPs, reading operands like the instructions they decode as
+    case 0x02: case 0x22: case 0x42: case 0x62: case 0x82: case 0xC2: case 0xE2: ReadImmediate(); break;
+    case 0x44: RefZeroPage(); break;
+    case 0x54: case 0xD4: case 0xF4: RefZeroPage(X); break;
+    case 0xDC: case 0xFC: RefAbsolute(); break;
+    case 0x5C: ReadImmediate16(); break;
+
+    default:
+        // Remaining undefined opcodes ($x3 & $xB) are single byte NOPs
+        if((OpCode & 0x07) == 0x03)
+            break;
+        return false;
+    }
+    return true;
 }
 
 void CPU::ServiceInterrupt()
@@ -330,6 +548,7 @@ void CPU::ServiceInterrupt()
         0xFFFE,
     };
 
+    const U32 StartCycles = Cycles;
     switch(Interrupt) {
     case INT_Reset:
         Flags.I = 1;
@@ -343,24 +562,50 @@ void CPU::ServiceInterrupt()
         StackPush(FlagRegister() | 0x30);
         Flags.I = 1;
         Flags.B = (Interrupt == INT_BRK);
+        // 65C02 enters interrupt handlers in binary mode
+        if(Settings.CMOS)
+            Flags.D = 0;
         break;
     default:
         return;
     }
 
-    Cycles += 2 + 1;
+    // Exact timing charges documented total including stack pushes
+    if(Settings.ExactTiming)
+        Cycles = StartCycles + InterruptCycles;
+    else
+        Cycles += InterruptCycles;
+    const U16 ReturnAddr = PC;
     const U16 VectorAddr = InterruptVectors[Interrupt];
     PC = RAM[VectorAddr] | RAM[VectorAddr+1] << 8;
+    if(Trace.Enabled)
+        Trace.RecordInterrupt(U8(Interrupt), ReturnAddr);
+    if(Events.Enabled)
+        Events.Instant(Timeline::EventInterrupt, Timeline::ThreadCPU, TotalCycles, Interrupt, ReturnAddr);
     Interrupt = INT_None;
 }
 
 void CPU::SignalInterrupt(InterruptType IntType)
 {
+    // Any interrupt request resumes execution after WAI, even if masked
+    Waiting = false;
     if(!(IntType == CPU::INT_IRQ && Flags.I)) {
         Interrupt = IntType;
     }
 }
 
+void CPU::AssertIRQ(const IRQLine Line)
+{
+    // Asserted line resumes execution after WAI, even if masked
+    IRQLines |= Line;
+    Waiting = false;
+}
+
+void CPU::ReleaseIRQ(const IRQLine Line)
+{
+    IRQLines &= ~Line;
+}
+
 U8 CPU::ReadImmediate()
 {
     Cycles += 1;
@@ -419,6 +664,13 @@ Ref CPU::RefIndexedY()
     return Ref{Addr, RAM[Addr]};
 }
 
+Ref CPU::RefIndirect()
+{
+    Cycles += 1;
+    const U16 Addr = ReadZeroPage16(0);
+    return Ref{Addr, RAM[Addr]};
+}
+
 void CPU::Write(const Ref &Mem)
 {
     Cycles += 1;
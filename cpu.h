@@ -7,10 +7,26 @@
 #define CPU_H
 
 #include "common.h"
+#include "config.h"
+#include "host.h"
 #include "mcc.h"
+#include "timing.h"
 #include "vpu.h"
 #include "spu.h"
 #include "keyboard.h"
+#include "dma.h"
+#include "pit.h"
+#include "storage.h"
+#include "uart.h"
+#include "debugport.h"
+#include "expansion.h"
+#include "bios.h"
+#include "basic.h"
+#include "profiler.h"
+#include "debugger.h"
+#include "coverage.h"
+#include "tracer.h"
+#include "timeline.h"
 
 // Memory reference
 struct Ref
@@ -32,10 +48,28 @@ public:
     U16 PC;
     // Cycle counter
     U32 Cycles;
+    // Cycles elapsed since power on
+    U64 TotalCycles;
+    // Instructions executed since power on
+    U64 TotalInstructions;
+    // Cycles spent halted by WAI since power on
+    U64 IdleCycles;
+    // Halted by WAI until next interrupt request
+    bool Waiting;
+    // Level-triggered IRQ lines currently asserted by devices
+    U8 IRQLines;
+    // Halted by STP until reset
+    bool Stopped;
+    // Cycles CPU was stalled by DMA or native routines during current instruction
+    U32 StallCycles;
     // Approximate clock freq in kHz
     U32 Frequency;
     // Video signal refresh rate in Hz
     U16 VideoHz;
+    // Emulator configuration
+    Config Settings;
+    // Host backends
+    Host Backends;
 
     // Memory control chip
     MCC RAM;
@@ -45,6 +79,32 @@ public:
     SPU Sound;
     // Keyboard controller;
     Keyboard Kbd;
+    // DMA controller
+    DMA Dma;
+    // Programmable interval timer
+    PIT Timer;
+    // Host directory storage
+    Storage Disk;
+    // Serial port
+    UART Uart;
+    // Single-step port for guest monitors
+    DebugPort Port;
+    // File-backed memory expansion
+    Expansion Xmem;
+    // BIOS high-level emulation
+    BiosHLE Bios;
+    // Tiny BASIC high-level emulation
+    BasicHLE Basic;
+    // Tiny BASIC line profiler
+    BasicProfiler Profiler;
+    // Host debugger
+    Debugger Debug;
+    // Execution coverage
+    Coverage Cover;
+    // Instruction trace
+    Tracer Trace;
+    // Timeline of interrupts, frames, audio & real time pacing
+    Timeline Events;
 
     struct {
         U8 C:1; // Carry
@@ -65,6 +125,13 @@ public:
         INT_BRK,
     } Interrupt;
 
+    // Level-triggered IRQ sources
+    enum IRQLine {
+        IRQ_Keyboard = 0x01,
+        IRQ_Timer    = 0x02,
+        IRQ_Serial   = 0x04,
+    };
+
     enum {
         SF_None = 0x00,
         SF_C    = 0x01,
@@ -73,17 +140,35 @@ public:
         SF_S    = 0x08,
     };
 
-    CPU(const U32 InFreq, const U16 InHz, const char* Program, U16 Offset, size_t Size);
+    CPU(const U32 InFreq, const U16 InHz, const Config& InConfig, const Host& InHost, const char* Program, U16 Offset, size_t Size);
+
+    // Copies program into memory and resets CPU
+    void Load(const char* Program, U16 Offset, size_t Size);
+    // Attaches native routines to code in memory and resets CPU
+    void Reset();
 
     void Tick();
-    void Step();
+    template<class Timing> void Step();
+    bool StepCMOS(const U8 OpCode);
     void ServiceInterrupt();
     void SignalInterrupt(InterruptType IntType);
+    // IRQ is requested whenever any line is asserted and interrupts are enabled
+    void AssertIRQ(const IRQLine Line);
+    void ReleaseIRQ(const IRQLine Line);
+
+    // CPU cycles per video frame, real time pacing sleeps once per jiffy
+    S32 JiffyCycles() const { return CyclesPerJiffy; }
 
 private:
+    friend class HLE;
+    friend class Debugger;
+    friend class Tracer;
+
+    U32 InterruptCycles;
     S32 CyclesPerJiffy;
     S32 CyclesSinceSleep;
     U32 LastTimestamp;
+    SystemClock DefaultClock;
 
 private:
     inline U8 ReadImmediate();
@@ -95,6 +180,7 @@ private:
     inline Ref RefAbsolute(U8 Index=0);
     inline Ref RefIndexedX();
     inline Ref RefIndexedY();
+    inline Ref RefIndirect();
 
     inline void Write(const Ref& Mem);
 
@@ -0,0 +1,262 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <functional>
+#include "cpu.h"
+#include "debugger.h"
+
+namespace {
+    // Store instructions, their dummy read of the target is not a watched read
+    bool IsStore(const U8 OpCode)
+    {
+        switch(OpCode) {
+        case 0x81: case 0x85: case 0x8D: case 0x91: case 0x92: case 0x95: case 0x99: case 0x9D: // STA
+        case 0x86: case 0x8E: case 0x96: // STX
+        case 0x84: case 0x8C: case 0x94: // STY
+        case 0x64: case 0x74: case 0x9C: case 0x9E: // STZ
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+Debugger::Debugger(CPU* InCPU)
+    : Device(InCPU)
+    , Active(false)
+    , Suspended(false)
+    , Stepping(false)
+    , Resuming(false)
+    , ResumeAddr(0)
+    , InstructionAddr(0)
+    , LastReason(StopNone)
+    , HitPending(false)
+    , HitAddr(0)
+    , HitKind(0)
+{
+    using namespace std::placeholders;
+
+    Breakpoints.fill(0);
+    WatchedPerPage.fill(0);
+    RAM.WatchCallback = std::bind(&Debugger::OnAccess, this, _1, _2);
+}
+
+void Debugger::SetBreakpoint(const U16 Addr, const Condition& Cond)
+{
+    Breakpoints[Addr >> 3] |= 1 << (Addr & 7);
+    Conditions[Addr].push_back(Cond);
+    UpdateActive();
+}
+
+void Debugger::ClearBreakpoint(const U16 Addr)
+{
+    Breakpoints[Addr >> 3] &= ~(1 << (Addr & 7));
+    Conditions.erase(Addr);
+    UpdateActive();
+}
+
+void Debugger::SetWatchpoint(const U16 Addr, const U16 Length, const U8 Kind)
+{
+    for(U32 i=0; i<Length; i++) {
+        const U16 WatchAddr = U16(Addr + i);
+        U8& WatchKind = Watchpoints[WatchAddr];
+        if(WatchKind == 0 && WatchedPerPage[WatchAddr >> 8]++ == 0) {
+            RAM.WatchPage(WatchAddr >> 8, true);
+        }
+        WatchKind |= Kind;
+    }
+    UpdateActive();
+}
+
+void Debugger::ClearWatchpoint(const U16 Addr, const U16 Length, const U8 Kind)
+{
+    for(U32 i=0; i<Length; i++) {
+        const U16 WatchAddr = U16(Addr + i);
+        auto It = Watchpoints.find(WatchAddr);
+        if(It == Watchpoints.end())
+            continue;
+
+        It->second &= ~Kind;
+        if(It->second == 0) {
+            Watchpoints.erase(It);
+            if(--WatchedPerPage[WatchAddr >> 8] == 0)
+                RAM.WatchPage(WatchAddr >> 8, false);
+        }
+    }
+    UpdateActive();
+}
+
+void Debugger::ClearAll()
+{
+    Breakpoints.fill(0);
+    Conditions.clear();
+
+    for(U32 Page=0; Page<256; Page++) {
+        if(WatchedPerPage[Page] > 0)
+            RAM.WatchPage(U8(Page), false);
+    }
+    WatchedPerPage.fill(0);
+    Watchpoints.clear();
+    UpdateActive();
+}
+
+void Debugger::Halt()
+{
+    Stop(StopHalt);
+}
+
+void Debugger::Resume()
+{
+    Suspended  = false;
+    Stepping   = false;
+    Resuming   = true;
+    ResumeAddr = TheCPU.PC;
+    HitPending = false;
+    UpdateActive();
+}
+
+void Debugger::Step()
+{
+    Resume();
+    Stepping = true;
+}
+
+void Debugger::Reset()
+{
+    TheCPU.Waiting   = false;
+    TheCPU.Stopped   = false;
+    TheCPU.Interrupt = CPU::INT_Reset;
+    // Reset is serviced right away so that stopped CPU shows its new state
+    TheCPU.ServiceInterrupt();
+    TheCPU.Cycles = 0;
+}
+
+U16 Debugger::GetRegister(const Register Reg) const
+{
+    switch(Reg) {
+    case RegA:  return TheCPU.A;
+    case RegX:  return TheCPU.X;
+    case RegY:  return TheCPU.Y;
+    case RegP:  return TheCPU.FlagRegister() | 0x20;
+    case RegSP: return TheCPU.SP;
+    case RegPC: return TheCPU.PC;
+    default:    return 0;
+    }
+}
+
+void Debugger::SetRegister(const Register Reg, const U16 Value)
+{
+    switch(Reg) {
+    case RegA:  TheCPU.A  = U8(Value); break;
+    case RegX:  TheCPU.X  = U8(Value); break;
+    case RegY:  TheCPU.Y  = U8(Value); break;
+    case RegP:  TheCPU.FlagRegister() = U8(Value); break;
+    case RegSP: TheCPU.SP = U8(Value); break;
+    case RegPC: TheCPU.PC = Value; break;
+    default:    break;
+    }
+}
+
+U8 Debugger::Peek(const U16 Addr) const
+{
+    return RAM.Peek(Addr);
+}
+
+void Debugger::Poke(const U16 Addr, const U8 Value)
+{
+    RAM.Poke(Addr, Value);
+}
+
+bool Debugger::Check()
+{
+    if(Suspended)
+        return true;
+
+    // Watchpoints stop after the instruction that hit them
+    if(HitPending) {
+        HitPending = false;
+        Stop(StopWatchpoint);
+        if(TheCPU.Trace.Enabled)
+            TheCPU.Trace.Dump(Tracer::TriggerWatch);
+        return true;
+    }
+
+    // Nothing to execute while CPU is halted by WAI or STP
+    if(TheCPU.Waiting || TheCPU.Stopped)
+        return false;
+
+    const U16 Addr = TheCPU.PC;
+    if(Resuming) {
+        Resuming = false;
+        UpdateActive();
+        if(Addr == ResumeAddr) {
+            InstructionAddr = Addr;
+            return false;
+        }
+    }
+    if(Stepping) {
+        Stop(StopStep);
+        return true;
+    }
+
+    if(IsBreakpoint(Addr)) {
+        for(const Condition& Cond : Conditions[Addr]) {
+            const U16 Value = GetRegister(Cond.Reg);
+            bool Hit;
+            switch(Cond.Op) {
+            case Equal:        Hit = Value == Cond.Value; break;
+            case NotEqual:     Hit = Value != Cond.Value; break;
+            case Less:         Hit = Value <  Cond.Value; break;
+            case LessEqual:    Hit = Value <= Cond.Value; break;
+            case Greater:      Hit = Value >  Cond.Value; break;
+            case GreaterEqual: Hit = Value >= Cond.Value; break;
+            default:           Hit = true; break;
+            }
+            if(Hit) {
+                Stop(StopBreakpoint);
+                return true;
+            }
+        }
+    }
+
+    InstructionAddr = Addr;
+    return false;
+}
+
+void Debugger::OnAccess(const U16 Addr, const bool Write)
+{
+    if(Suspended || HitPending)
+        return;
+
+    auto It = Watchpoints.find(Addr);
+    if(It == Watchpoints.end())
+        return;
+
+    const U8 Kind = Write ? WatchWrite : WatchRead;
+    if(!(It->second & Kind))
+        return;
+    if(!Write && IsStore(RAM.Peek(InstructionAddr)))
+        return;
+
+    HitPending = true;
+    HitAddr    = Addr;
+    HitKind    = (It->second == WatchAccess) ? U8(WatchAccess) : Kind;
+    Active     = true;
+}
+
+void Debugger::Stop(const StopReason Reason)
+{
+    Suspended  = true;
+    Stepping   = false;
+    Resuming   = false;
+    LastReason = Reason;
+    UpdateActive();
+}
+
+void Debugger::UpdateActive()
+{
+    Active = Suspended || Stepping || Resuming || HitPending
+          || !Conditions.empty() || !Watchpoints.empty();
+}
@@ -0,0 +1,131 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <array>
+#include <map>
+#include <vector>
+#include "common.h"
+#include "device.h"
+
+// Host debugger, invisible to the guest.
+// Execute breakpoints are kept in a bitmap checked before every instruction,
+// watchpoints mark pages in memory controller so that only accesses to watched
+// pages leave the fast path. Nothing is checked while there are no breakpoints
+// or watchpoints and execution is not stopped.
+class Debugger : public Device
+{
+public:
+    Debugger(CPU* InCPU);
+
+    enum Register {
+        RegA = 0,
+        RegX,
+        RegY,
+        RegP,
+        RegSP,
+        RegPC,
+        NumRegisters,
+    };
+
+    enum Operator {
+        Always = 0,
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+    };
+
+    // Breakpoint triggers if condition holds before instruction is executed
+    struct Condition {
+        Condition() : Reg(RegA), Op(Always), Value(0) {}
+        Condition(Register InReg, Operator InOp, U16 InValue) : Reg(InReg), Op(InOp), Value(InValue) {}
+
+        Register Reg;
+        Operator Op;
+        U16      Value;
+    };
+
+    enum WatchKind {
+        WatchRead   = 0x01,
+        WatchWrite  = 0x02,
+        WatchAccess = WatchRead | WatchWrite,
+    };
+
+    enum StopReason {
+        StopNone = 0,
+        StopHalt,
+        StopStep,
+        StopBreakpoint,
+        StopWatchpoint,
+    };
+
+    void SetBreakpoint(const U16 Addr, const Condition& Cond=Condition());
+    void ClearBreakpoint(const U16 Addr);
+    void SetWatchpoint(const U16 Addr, const U16 Length, const U8 Kind);
+    void ClearWatchpoint(const U16 Addr, const U16 Length, const U8 Kind);
+    void ClearAll();
+
+    // Stops before next instruction
+    void Halt();
+    // Continues execution, breakpoint at current instruction is not hit again
+    void Resume();
+    // Executes single instruction and stops
+    void Step();
+    // Resets CPU, stays stopped if it was stopped
+    void Reset();
+
+    bool       Halted() const { return Suspended; }
+    StopReason Reason() const { return LastReason; }
+
+    // Watched address and access kind of last watchpoint hit
+    U16 WatchAddr() const { return HitAddr; }
+    U8  WatchHit()  const { return HitKind; }
+
+    U16  GetRegister(const Register Reg) const;
+    void SetRegister(const Register Reg, const U16 Value);
+
+    // Memory access without side effects, I/O page accesses reach underlying memory
+    U8   Peek(const U16 Addr) const;
+    void Poke(const U16 Addr, const U8 Value);
+
+    // Called before every instruction while active, returns true if CPU should not execute
+    bool Check();
+
+    bool Active;
+
+private:
+    void OnAccess(const U16 Addr, const bool Write);
+    void Stop(const StopReason Reason);
+    void UpdateActive();
+
+    bool IsBreakpoint(const U16 Addr) const
+    {
+        return (Breakpoints[Addr >> 3] >> (Addr & 7)) & 1;
+    }
+
+    std::array<U8, 8192> Breakpoints;
+    std::map<U16, std::vector<Condition>> Conditions;
+
+    std::map<U16, U8>     Watchpoints;
+    std::array<U16, 256>  WatchedPerPage;
+
+    bool Suspended;
+    bool Stepping;
+    bool Resuming;
+    U16  ResumeAddr;
+    U16  InstructionAddr;
+
+    StopReason LastReason;
+    bool HitPending;
+    U16  HitAddr;
+    U8   HitKind;
+};
+
+#endif // DEBUGGER_H
@@ -0,0 +1,171 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include "cpu.h"
+#include "debugport.h"
+
+namespace {
+    enum Registers {
+        RegA        = 0x30,
+        RegX        = 0x31,
+        RegY        = 0x32,
+        RegSP       = 0x33,
+        RegP        = 0x34,
+        RegPCLo     = 0x35,
+        RegPCHi     = 0x36,
+        RegControl  = 0x37,
+        RegTargetLo = 0x38,
+        RegTargetHi = 0x39,
+        RegID       = 0x3F,
+    };
+
+    const U8 OpBRK = 0x00;
+}
+
+DebugPort::DebugPort(CPU* InCPU)
+    : Device(InCPU)
+    , Active(false)
+    , Program({0, 0, 0, 0xFF, 0x30, 0})
+    , Monitor({0, 0, 0, 0xFF, 0x30, 0})
+    , Pending(CmdNone)
+    , Running(CmdNone)
+    , Reason(StopNone)
+    , TargetAddr(0)
+    , StartInstructions(0)
+    , HeldInterrupt(CPU::INT_None)
+{
+    // Without debug port registers are plain memory, which monitor detects
+    if(!TheCPU.Settings.DebugPort)
+        return;
+
+    for(int Reg=RegA; Reg<=RegID; Reg++) {
+        RAM.AllocRegister<DebugPort>(Reg, this, &DebugPort::ReadRegister, &DebugPort::WriteRegister);
+    }
+}
+
+U8 DebugPort::ReadRegister(U8 Reg)
+{
+    switch(Reg) {
+    case RegA:        return Program.A;
+    case RegX:        return Program.X;
+    case RegY:        return Program.Y;
+    case RegSP:       return Program.SP;
+    case RegP:        return Program.P;
+    case RegPCLo:     return Program.PC & 0xFF;
+    case RegPCHi:     return Program.PC >> 8;
+    case RegControl:  return Reason;
+    case RegTargetLo: return TargetAddr & 0xFF;
+    case RegTargetHi: return TargetAddr >> 8;
+    case RegID:       return Signature;
+    default:          return 0;
+    }
+}
+
+void DebugPort::WriteRegister(U8 Reg, U8 Data)
+{
+    switch(Reg) {
+    case RegA:        Program.A  = Data; break;
+    case RegX:        Program.X  = Data; break;
+    case RegY:        Program.Y  = Data; break;
+    case RegSP:       Program.SP = Data; break;
+    case RegP:        Program.P  = Data; break;
+    case RegPCLo:     Program.PC = (Program.PC & 0xFF00) | Data; break;
+    case RegPCHi:     Program.PC = (Program.PC & 0x00FF) | (Data << 8); break;
+    case RegTargetLo: TargetAddr = (TargetAddr & 0xFF00) | Data; break;
+    case RegTargetHi: TargetAddr = (TargetAddr & 0x00FF) | (Data << 8); break;
+    case RegControl:
+        // Command starts once the instruction writing it is complete
+        if(Data == CmdStep || Data == CmdRun) {
+            Pending = Command(Data);
+            Active  = true;
+        }
+        break;
+    }
+}
+
+void DebugPort::Check()
+{
+    if(TheCPU.Interrupt == CPU::INT_Reset) {
+        // Reset abandons both the command and the monitor waiting for it
+        Pending = Running = CmdNone;
+        Active  = false;
+        return;
+    }
+
+    if(Pending != CmdNone) {
+        Enter();
+        return;
+    }
+
+    const bool Executed = TheCPU.TotalInstructions != StartInstructions;
+    if(Running == CmdStep) {
+        if(!Executed)
+            return;
+        // BRK enters its handler as part of the instruction
+        if(TheCPU.Interrupt == CPU::INT_BRK)
+            TheCPU.ServiceInterrupt();
+        Leave(TheCPU.Stopped ? StopHalt : StopStep);
+    }
+    else {
+        if(TheCPU.Stopped)
+            Leave(StopHalt);
+        else if(Executed && TheCPU.PC == TargetAddr)
+            Leave(StopTarget);
+        else if(TheCPU.Interrupt == CPU::INT_None && !TheCPU.Waiting && RAM.Peek(TheCPU.PC) == OpBRK)
+            Leave(StopBRK);
+    }
+}
+
+void DebugPort::Enter()
+{
+    SaveContext(Monitor);
+    LoadContext(Program);
+
+    // Interrupts requested while monitor was running are its own
+    HeldInterrupt = CPU::INT_None;
+    if(Pending == CmdStep) {
+        HeldInterrupt = TheCPU.Interrupt;
+        TheCPU.Interrupt = CPU::INT_None;
+    }
+
+    Running = Pending;
+    Pending = CmdNone;
+    StartInstructions = TheCPU.TotalInstructions;
+}
+
+void DebugPort::Leave(const StopReason InReason)
+{
+    SaveContext(Program);
+    LoadContext(Monitor);
+
+    if(HeldInterrupt != CPU::INT_None && TheCPU.Interrupt == CPU::INT_None)
+        TheCPU.Interrupt = CPU::InterruptType(HeldInterrupt);
+    TheCPU.Waiting = false;
+    TheCPU.Stopped = false;
+
+    Reason  = InReason;
+    Running = CmdNone;
+    Active  = false;
+}
+
+void DebugPort::SaveContext(Context& C) const
+{
+    C.A  = TheCPU.A;
+    C.X  = TheCPU.X;
+    C.Y  = TheCPU.Y;
+    C.SP = TheCPU.SP;
+    C.P  = *reinterpret_cast<const U8*>(&TheCPU.Flags) | 0x30;
+    C.PC = TheCPU.PC;
+}
+
+void DebugPort::LoadContext(const Context& C)
+{
+    TheCPU.A  = C.A;
+    TheCPU.X  = C.X;
+    TheCPU.Y  = C.Y;
+    TheCPU.SP = C.SP;
+    TheCPU.PC = C.PC;
+    *reinterpret_cast<U8*>(&TheCPU.Flags) = C.P | 0x30;
+}
@@ -0,0 +1,71 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef DEBUGPORT_H
+#define DEBUGPORT_H
+
+#include "common.h"
+#include "device.h"
+
+// Single-step port for guest monitors.
+// The monitor writes registers of the program being debugged and a command.
+// Before the next instruction the emulator sets the monitor's own registers
+// aside, executes the program until the command is done, stores its registers
+// back into the port and resumes the monitor after the command write, so
+// commands appear to complete instantly.
+class DebugPort : public Device
+{
+public:
+    DebugPort(class CPU* InCPU);
+
+    enum Command {
+        CmdNone = 0,
+        CmdStep = 1,
+        CmdRun  = 2,
+    };
+
+    enum StopReason {
+        StopNone   = 0,
+        StopStep   = 1,
+        StopTarget = 2,
+        StopBRK    = 3,
+        StopHalt   = 4,
+    };
+
+    // Called before every instruction while active, switches between monitor and program
+    void Check();
+
+    bool Active;
+
+    // Value of identification register
+    static const U8 Signature = 0xB1;
+
+private:
+    U8   ReadRegister(U8 Reg);
+    void WriteRegister(U8 Reg, U8 Data);
+
+    struct Context {
+        U8  A, X, Y, SP, P;
+        U16 PC;
+    };
+
+    void Enter();
+    void Leave(const StopReason InReason);
+    void SaveContext(Context& C) const;
+    void LoadContext(const Context& C);
+
+    Context Program;
+    Context Monitor;
+
+    Command    Pending;
+    Command    Running;
+    StopReason Reason;
+    U16        TargetAddr;
+    U64        StartInstructions;
+    // Interrupt requested before single-stepped instruction, serviced by monitor
+    U8         HeldInterrupt;
+};
+
+#endif // DEBUGPORT_H
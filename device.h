@@ -17,6 +17,9 @@ class Device
 public:
     virtual void Tick(const U32 DeltaCycles) { UNUSED(DeltaCycles); }
 
+    // Cycles left until next tick of periodic device
+    U32 CyclesToTick() const { return CyclesPerTick - Cycles; }
+
     struct Error : public std::runtime_error {
         explicit Error(const char* what) : std::runtime_error(what) {}
     };
@@ -0,0 +1,132 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cstring>
+#include <vector>
+#include "cpu.h"
+#include "dma.h"
+
+namespace {
+    enum Registers {
+        RegSourceLo = 0x10,
+        RegSourceHi = 0x11,
+        RegDestLo   = 0x12,
+        RegDestHi   = 0x13,
+        RegLengthLo = 0x14,
+        RegLengthHi = 0x15,
+        RegFill     = 0x16,
+        RegControl  = 0x17,
+    };
+
+    enum ControlBits {
+        CtlFill  = 0x01,
+        CtlDone  = 0x20,
+        CtlIRQ   = 0x40,
+        CtlStart = 0x80,
+    };
+}
+
+DMA::DMA(CPU* InCPU)
+    : Device(InCPU)
+    , Source(0)
+    , Dest(0)
+    , Length(0)
+    , Fill(0)
+    , Control(0)
+    , Busy(false)
+{
+    // Without controller registers are plain memory, which BIOS detects
+    if(!TheCPU.Settings.DMA)
+        return;
+
+    for(int Reg=RegSourceLo; Reg<=RegControl; Reg++) {
+        RAM.AllocRegister<DMA>(Reg, this, &DMA::ReadRegister, &DMA::WriteRegister);
+    }
+}
+
+U8 DMA::ReadRegister(U8 Reg)
+{
+    switch(Reg) {
+    case RegSourceLo: return Source & 0xFF;
+    case RegSourceHi: return Source >> 8;
+    case RegDestLo:   return Dest & 0xFF;
+    case RegDestHi:   return Dest >> 8;
+    case RegLengthLo: return Length & 0xFF;
+    case RegLengthHi: return Length >> 8;
+    case RegFill:     return Fill;
+    case RegControl: {
+        // Completion flag is cleared on read
+        const U8 Value = Control;
+        Control &= ~CtlDone;
+        return Value;
+    }
+    }
+    return 0;
+}
+
+void DMA::WriteRegister(U8 Reg, U8 Data)
+{
+    switch(Reg) {
+    case RegSourceLo: Source = (Source & 0xFF00) | Data;      break;
+    case RegSourceHi: Source = (Source & 0x00FF) | Data << 8; break;
+    case RegDestLo:   Dest   = (Dest & 0xFF00) | Data;        break;
+    case RegDestHi:   Dest   = (Dest & 0x00FF) | Data << 8;   break;
+    case RegLengthLo: Length = (Length & 0xFF00) | Data;      break;
+    case RegLengthHi: Length = (Length & 0x00FF) | Data << 8; break;
+    case RegFill:     Fill   = Data; break;
+    case RegControl:
+        Control = (Control & CtlDone) | (Data & (CtlFill | CtlIRQ));
+        if((Data & CtlStart) && !Busy) {
+            Transfer();
+        }
+        break;
+    }
+}
+
+void DMA::Transfer()
+{
+    // Transfer may write its own registers, these must not affect it
+    const U16 From  = Source;
+    const U16 To    = Dest;
+    const U32 Count = Length;
+    Busy = true;
+
+    if(Control & CtlFill) {
+        if(RAM.IsPlainMemory(To, Count)) {
+            std::memset(&RAM.Memory[To], Fill, Count);
+        }
+        else {
+            const U8 Value = Fill;
+            for(U32 i=0; i<Count; i++)
+                RAM.Write(U16(To+i), Value);
+        }
+        Source = From;
+        TheCPU.StallCycles += Count * FillCycles;
+    }
+    else {
+        // Overlapping copies behave as if source was read before writing destination
+        if(RAM.IsPlainMemory(From, Count) && RAM.IsPlainMemory(To, Count)) {
+            std::memmove(&RAM.Memory[To], &RAM.Memory[From], Count);
+        }
+        else {
+            std::vector<U8> Buffer(Count);
+            for(U32 i=0; i<Count; i++)
+                Buffer[i] = RAM.Read(U16(From+i));
+            for(U32 i=0; i<Count; i++)
+                RAM.Write(U16(To+i), Buffer[i]);
+        }
+        Source = U16(From + Count);
+        TheCPU.StallCycles += Count * CopyCycles;
+    }
+
+    Dest   = U16(To + Count);
+    Length = 0;
+    Busy   = false;
+
+    Control |= CtlDone;
+    if(Control & CtlIRQ) {
+        TheCPU.SignalInterrupt(CPU::INT_IRQ);
+    }
+}
@@ -0,0 +1,41 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef DMA_H
+#define DMA_H
+
+#include "common.h"
+#include "device.h"
+
+// DMA controller for bulk memory copy & fill.
+// CPU is halted while a transfer is in progress, which takes a fixed
+// number of cycles per byte, so a transfer is complete by the time the
+// next instruction executes.
+class DMA : public Device
+{
+public:
+    DMA(class CPU* InCPU);
+
+    U16 Source;
+    U16 Dest;
+    U16 Length;
+    U8  Fill;
+    U8  Control;
+
+    // Transfer cost in CPU cycles per byte
+    static const U32 CopyCycles = 2;
+    static const U32 FillCycles = 1;
+
+private:
+    U8   ReadRegister(U8 Reg);
+    void WriteRegister(U8 Reg, U8 Data);
+
+    void Transfer();
+
+    // Set while a transfer is in progress, transfers can't start themselves
+    bool Busy;
+};
+
+#endif // DMA_H
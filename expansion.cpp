@@ -0,0 +1,124 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <algorithm>
+#include "cpu.h"
+#include "expansion.h"
+
+namespace {
+    enum Registers {
+        RegBankLo  = 0x40,
+        RegBankMid = 0x41,
+        RegBankHi  = 0x42,
+        RegWindow  = 0x43,
+        RegLength  = 0x44,
+        RegStatus  = 0x45,
+        RegSizeLo  = 0x46,
+        RegSizeMid = 0x47,
+        RegSizeHi  = 0x48,
+    };
+
+    enum StatusBits {
+        StatusWritable = 0x01,
+    };
+
+    const U32 MaxPages = 0xFFFFFF;
+
+    // Window is limited to free memory: native routines access zero page,
+    // stack, BASIC, BIOS & video memory directly and would bypass it
+    const U32 FirstPage = 0x02;
+    const U32 LastPage  = 0xB9;
+}
+
+Expansion::Expansion(CPU* InCPU)
+    : Device(InCPU)
+    , Bank(0)
+    , WindowStart(0)
+    , WindowLength(0)
+    , FileData(nullptr)
+    , Size(0)
+{
+    // Without expansion registers are plain memory, which programs detect
+    const std::string& FileName = InCPU->Settings.ExpansionFile;
+    if(FileName.empty())
+        return;
+
+    if(File.Open(FileName.c_str(), true))
+        FileData = File.WritableData();
+    else if(File.Open(FileName.c_str()))
+        FileData = const_cast<U8*>(File.Data());
+    else
+        throw Device::Error("Could not open expansion file");
+
+    // Trailing partial page is not addressable
+    Size = U32(std::min<size_t>(File.Size() >> 8, MaxPages));
+    if(Size == 0)
+        throw Device::Error("Expansion file is smaller than one page");
+
+    for(int Reg=RegBankLo; Reg<=RegSizeHi; Reg++) {
+        RAM.AllocRegister<Expansion>(Reg, this, &Expansion::ReadRegister, &Expansion::WriteRegister);
+    }
+}
+
+U8 Expansion::ReadRegister(U8 Reg)
+{
+    switch(Reg) {
+    case RegBankLo:  return Bank & 0xFF;
+    case RegBankMid: return (Bank >> 8) & 0xFF;
+    case RegBankHi:  return Bank >> 16;
+    case RegWindow:  return WindowStart;
+    case RegLength:  return WindowLength;
+    case RegStatus:  return File.WritableData() ? StatusWritable : 0;
+    case RegSizeLo:  return Size & 0xFF;
+    case RegSizeMid: return (Size >> 8) & 0xFF;
+    case RegSizeHi:  return Size >> 16;
+    default:         return 0;
+    }
+}
+
+void Expansion::WriteRegister(U8 Reg, U8 Data)
+{
+    switch(Reg) {
+    case RegBankLo:  Bank = (Bank & 0xFFFF00) | Data; break;
+    case RegBankMid: Bank = (Bank & 0xFF00FF) | (Data << 8); break;
+    case RegBankHi:  Bank = (Bank & 0x00FFFF) | (Data << 16); break;
+    case RegWindow:  break;
+    case RegLength:  Data = Data > MaxWindow ? U8(MaxWindow) : Data; break;
+    default:         return;
+    }
+
+    Unmap();
+    if(Reg == RegWindow)
+        WindowStart = Data;
+    else if(Reg == RegLength)
+        WindowLength = Data;
+    Map();
+}
+
+void Expansion::Unmap()
+{
+    if(WindowStart == 0)
+        return;
+
+    const U32 End = std::min(U32(WindowStart) + WindowLength - 1, LastPage);
+    for(U32 Page=std::max(U32(WindowStart), FirstPage); Page<=End; Page++) {
+        RAM.UnmapBank(U8(Page));
+    }
+}
+
+void Expansion::Map()
+{
+    if(WindowStart == 0)
+        return;
+
+    // Window pages past end of file read $FF & ignore writes
+    const bool Writable = File.WritableData() != nullptr;
+    const U32  End = std::min(U32(WindowStart) + WindowLength - 1, LastPage);
+    for(U32 Page=std::max(U32(WindowStart), FirstPage); Page<=End; Page++) {
+        const U32 FilePage = Bank + (Page - WindowStart);
+        U8* Base = FilePage < Size ? FileData + (size_t(FilePage) << 8) : nullptr;
+        RAM.MapBank(U8(Page), Base, Writable);
+    }
+}
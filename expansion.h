@@ -0,0 +1,42 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef EXPANSION_H
+#define EXPANSION_H
+
+#include "common.h"
+#include "device.h"
+#include "loader.h"
+
+// Memory expansion backed by a host file.
+// A window of CPU pages shows consecutive 256 byte pages of the file, which
+// is mapped into host memory so the window accesses it directly. Switching
+// banks only repoints the window's pages, modified pages reach the file
+// whenever the host writes them back.
+class Expansion : public Device
+{
+public:
+    Expansion(class CPU* InCPU);
+
+    // Largest window in pages
+    static const U8 MaxWindow = 64;
+
+    U32 Bank;
+    U8  WindowStart;
+    U8  WindowLength;
+
+private:
+    U8   ReadRegister(U8 Reg);
+    void WriteRegister(U8 Reg, U8 Data);
+
+    void Unmap();
+    void Map();
+
+    MappedFile File;
+    U8*        FileData;
+    U32        Size;
+};
+
+#endif // EXPANSION_H
@@ -0,0 +1,526 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+#include "device.h"
+#include "debugger.h"
+#include "gdbstub.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+
+namespace {
+    const char HexDigits[] = "0123456789abcdef";
+
+    // Register sizes in g packet
+    const size_t RegisterSizes[] = { 1, 1, 1, 1, 1, 2 };
+
+    const char* RegisterNames[] = { "a", "x", "y", "p", "sp", "pc" };
+
+    std::string ToHex(const U32 Value, const size_t Bytes)
+    {
+        std::string Hex;
+        for(size_t i=0; i<Bytes; i++) {
+            const U8 Byte = U8(Value >> (i*8));
+            Hex += HexDigits[Byte >> 4];
+            Hex += HexDigits[Byte & 15];
+        }
+        return Hex;
+    }
+
+    std::string ToHex(const std::string& Text)
+    {
+        std::string Hex;
+        for(char Char : Text) {
+            Hex += ToHex(U8(Char), 1);
+        }
+        return Hex;
+    }
+
+    int HexValue(const char Char)
+    {
+        if(Char >= '0' && Char <= '9') return Char - '0';
+        if(Char >= 'a' && Char <= 'f') return Char - 'a' + 10;
+        if(Char >= 'A' && Char <= 'F') return Char - 'A' + 10;
+        return -1;
+    }
+
+    // Parses little endian hex bytes
+    U32 FromHex(const std::string& Hex, size_t Pos, const size_t Bytes)
+    {
+        U32 Value = 0;
+        for(size_t i=0; i<Bytes && Pos+1 < Hex.size(); i++, Pos+=2) {
+            Value |= U32(HexValue(Hex[Pos]) << 4 | HexValue(Hex[Pos+1])) << (i*8);
+        }
+        return Value;
+    }
+
+    // Parses big endian hex number, advances position past it
+    bool ParseNumber(const std::string& Text, size_t& Pos, U32& Value)
+    {
+        const size_t Start = Pos;
+        Value = 0;
+        while(Pos < Text.size() && HexValue(Text[Pos]) >= 0) {
+            Value = Value << 4 | HexValue(Text[Pos++]);
+        }
+        return Pos > Start;
+    }
+
+    // Parses monitor command number: hex with optional $ or 0x prefix
+    bool ParseArgument(const std::string& Text, U32& Value)
+    {
+        size_t Pos = 0;
+        if(Text.compare(0, 1, "$") == 0)
+            Pos = 1;
+        else if(Text.compare(0, 2, "0x") == 0 || Text.compare(0, 2, "0X") == 0)
+            Pos = 2;
+        return ParseNumber(Text, Pos, Value) && Pos == Text.size() && Value <= 0xFFFF;
+    }
+}
+
+#ifdef _WIN32
+
+GdbStub::GdbStub(Debugger& InDebug, const char* Address)
+    : Debug(InDebug)
+    , Listener(-1)
+    , Client(-1)
+    , NoAck(false)
+    , Running(false)
+    , Killed(false)
+{
+    UNUSED(Address);
+    throw Device::Error("Remote debugging is not supported on this platform");
+}
+
+GdbStub::~GdbStub() {}
+
+bool GdbStub::Update(const U32 Timeout)
+{
+    UNUSED(Timeout);
+    return true;
+}
+
+#else
+
+GdbStub::GdbStub(Debugger& InDebug, const char* Address)
+    : Debug(InDebug)
+    , Listener(-1)
+    , Client(-1)
+    , NoAck(false)
+    , Running(false)
+    , Killed(false)
+{
+    char* End;
+    const long Port = std::strtol(Address, &End, 10);
+
+    if(*End == '\0') {
+        if(Port <= 0 || Port > 65535)
+            throw Device::Error("Invalid debugger port number");
+
+        Listener = socket(AF_INET, SOCK_STREAM, 0);
+        if(Listener < 0)
+            throw Device::Error("Could not create debugger socket");
+
+        const int Reuse = 1;
+        setsockopt(Listener, SOL_SOCKET, SO_REUSEADDR, &Reuse, sizeof(Reuse));
+
+        struct sockaddr_in SocketAddr;
+        std::memset(&SocketAddr, 0, sizeof(SocketAddr));
+        SocketAddr.sin_family      = AF_INET;
+        SocketAddr.sin_port        = htons(U16(Port));
+        SocketAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if(bind(Listener, (struct sockaddr*)&SocketAddr, sizeof(SocketAddr)) < 0) {
+            close(Listener);
+            throw Device::Error("Could not bind debugger port");
+        }
+    }
+    else {
+        struct sockaddr_un SocketAddr;
+        std::memset(&SocketAddr, 0, sizeof(SocketAddr));
+        if(std::strlen(Address) >= sizeof(SocketAddr.sun_path))
+            throw Device::Error("Debugger socket path is too long");
+
+        Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(Listener < 0)
+            throw Device::Error("Could not create debugger socket");
+
+        SocketAddr.sun_family = AF_UNIX;
+        std::strcpy(SocketAddr.sun_path, Address);
+        unlink(Address);
+        if(bind(Listener, (struct sockaddr*)&SocketAddr, sizeof(SocketAddr)) < 0) {
+            close(Listener);
+            throw Device::Error("Could not bind debugger socket");
+        }
+        SocketPath = Address;
+    }
+
+    // Client going away must not terminate the emulator
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if(listen(Listener, 1) < 0) {
+        close(Listener);
+        throw Device::Error("Could not listen on debugger socket");
+    }
+    std::printf("Waiting for debugger connection on %s\n", Address);
+}
+
+GdbStub::~GdbStub()
+{
+    Disconnect();
+    close(Listener);
+    if(!SocketPath.empty()) {
+        unlink(SocketPath.c_str());
+    }
+}
+
+bool GdbStub::Update(const U32 Timeout)
+{
+    if(Client >= 0 && Running && Debug.Halted()) {
+        Running = false;
+        SendPacket(StopReply());
+    }
+
+    struct pollfd Poll;
+    Poll.fd      = (Client >= 0) ? Client : Listener;
+    Poll.events  = POLLIN;
+    Poll.revents = 0;
+
+    if(poll(&Poll, 1, int(Timeout)) > 0) {
+        if(Client < 0)
+            Accept();
+        else if(!Receive())
+            Disconnect();
+    }
+    return !Killed;
+}
+
+void GdbStub::Accept()
+{
+    Client = accept(Listener, nullptr, nullptr);
+    if(Client < 0)
+        return;
+
+    const int NoDelay = 1;
+    setsockopt(Client, IPPROTO_TCP, TCP_NODELAY, &NoDelay, sizeof(NoDelay));
+
+    NoAck   = false;
+    Running = false;
+    Input.clear();
+    Debug.Halt();
+    std::printf("Debugger connected\n");
+}
+
+void GdbStub::Disconnect()
+{
+    if(Client < 0)
+        return;
+
+    close(Client);
+    Client = -1;
+
+    // Machine keeps running without debugger
+    Debug.ClearAll();
+    if(Debug.Halted())
+        Debug.Resume();
+    std::printf("Debugger disconnected\n");
+}
+
+bool GdbStub::Receive()
+{
+    char Buffer[1024];
+    const ssize_t Length = recv(Client, Buffer, sizeof(Buffer), 0);
+    if(Length <= 0)
+        return false;
+    Input.append(Buffer, size_t(Length));
+
+    while(!Input.empty()) {
+        switch(Input[0]) {
+        case '\x03':
+            // Interrupt request
+            Input.erase(0, 1);
+            if(!Debug.Halted())
+                Debug.Halt();
+            continue;
+        case '-':
+            Input.erase(0, 1);
+            if(!LastPacket.empty())
+                send(Client, LastPacket.data(), LastPacket.size(), 0);
+            continue;
+        case '$':
+            break;
+        default:
+            // Acknowledgements & line noise
+            Input.erase(0, 1);
+            continue;
+        }
+
+        const size_t End = Input.find('#');
+        if(End == std::string::npos || End + 2 >= Input.size())
+            break;
+
+        const std::string Packet = Input.substr(1, End - 1);
+        Input.erase(0, End + 3);
+        if(!NoAck)
+            send(Client, "+", 1, 0);
+        if(!HandlePacket(Packet))
+            return false;
+    }
+    return true;
+}
+
+bool GdbStub::HandlePacket(const std::string& Packet)
+{
+    const char Command = Packet.empty() ? '\0' : Packet[0];
+    size_t Pos = 1;
+    U32 Addr, Length, Value;
+
+    switch(Command) {
+    case '?':
+        SendPacket(StopReply());
+        break;
+    case 'g': {
+        std::string Reply;
+        for(int Reg=0; Reg<Debugger::NumRegisters; Reg++) {
+            Reply += ToHex(Debug.GetRegister(Debugger::Register(Reg)), RegisterSizes[Reg]);
+        }
+        SendPacket(Reply);
+        break;
+    }
+    case 'G':
+        for(int Reg=0; Reg<Debugger::NumRegisters; Reg++) {
+            Debug.SetRegister(Debugger::Register(Reg), U16(FromHex(Packet, Pos, RegisterSizes[Reg])));
+            Pos += RegisterSizes[Reg] * 2;
+        }
+        SendPacket("OK");
+        break;
+    case 'p':
+        if(ParseNumber(Packet, Pos, Value) && Value < Debugger::NumRegisters)
+            SendPacket(ToHex(Debug.GetRegister(Debugger::Register(Value)), RegisterSizes[Value]));
+        else
+            SendPacket("E01");
+        break;
+    case 'P':
+        if(ParseNumber(Packet, Pos, Value) && Value < Debugger::NumRegisters && Packet[Pos] == '=') {
+            Debug.SetRegister(Debugger::Register(Value), U16(FromHex(Packet, Pos+1, RegisterSizes[Value])));
+            SendPacket("OK");
+        }
+        else {
+            SendPacket("E01");
+        }
+        break;
+    case 'm':
+        if(ParseNumber(Packet, Pos, Addr) && Packet[Pos++] == ',' && ParseNumber(Packet, Pos, Length)) {
+            std::string Reply;
+            for(U32 i=0; i<Length && i<0x10000; i++) {
+                Reply += ToHex(Debug.Peek(U16(Addr + i)), 1);
+            }
+            SendPacket(Reply);
+        }
+        else {
+            SendPacket("E01");
+        }
+        break;
+    case 'M':
+        if(ParseNumber(Packet, Pos, Addr) && Packet[Pos++] == ',' && ParseNumber(Packet, Pos, Length) && Packet[Pos++] == ':') {
+            for(U32 i=0; i<Length && Pos+1 < Packet.size(); i++, Pos+=2) {
+                Debug.Poke(U16(Addr + i), U8(FromHex(Packet, Pos, 1)));
+            }
+            SendPacket("OK");
+        }
+        else {
+            SendPacket("E01");
+        }
+        break;
+    case 'c':
+        if(ParseNumber(Packet, Pos, Addr))
+            Debug.SetRegister(Debugger::RegPC, U16(Addr));
+        Debug.Resume();
+        Running = true;
+        break;
+    case 's':
+        if(ParseNumber(Packet, Pos, Addr))
+            Debug.SetRegister(Debugger::RegPC, U16(Addr));
+        Debug.Step();
+        Running = true;
+        break;
+    case 'Z':
+    case 'z':
+        HandleBreakpoint(Packet, Command == 'Z');
+        break;
+    case 'q':
+    case 'Q':
+        HandleQuery(Packet);
+        break;
+    case 'H':
+        SendPacket("OK");
+        break;
+    case 'T':
+        SendPacket("OK");
+        break;
+    case 'D':
+        SendPacket("OK");
+        return false;
+    case 'k':
+        Killed = true;
+        return false;
+    default:
+        // Unsupported packets get empty reply
+        SendPacket("");
+        break;
+    }
+    return true;
+}
+
+void GdbStub::HandleQuery(const std::string& Packet)
+{
+    if(Packet.compare(0, 10, "qSupported") == 0) {
+        SendPacket("PacketSize=4000;QStartNoAckMode+;swbreak+;hwbreak+");
+    }
+    else if(Packet == "QStartNoAckMode") {
+        SendPacket("OK");
+        NoAck = true;
+    }
+    else if(Packet == "qAttached") {
+        SendPacket("1");
+    }
+    else if(Packet == "qC") {
+        SendPacket("QC1");
+    }
+    else if(Packet == "qfThreadInfo") {
+        SendPacket("m1");
+    }
+    else if(Packet == "qsThreadInfo") {
+        SendPacket("l");
+    }
+    else if(Packet.compare(0, 6, "qRcmd,") == 0) {
+        std::string Command;
+        for(size_t Pos=6; Pos+1 < Packet.size(); Pos+=2) {
+            Command += char(FromHex(Packet, Pos, 1));
+        }
+        SendPacket(ToHex(HandleMonitor(Command)));
+    }
+    else {
+        SendPacket("");
+    }
+}
+
+void GdbStub::HandleBreakpoint(const std::string& Packet, const bool Insert)
+{
+    size_t Pos = 1;
+    U32 Type, Addr, Length;
+    if(!ParseNumber(Packet, Pos, Type) || Packet[Pos++] != ','
+    || !ParseNumber(Packet, Pos, Addr) || Packet[Pos++] != ','
+    || !ParseNumber(Packet, Pos, Length) || Addr > 0xFFFF) {
+        SendPacket("E01");
+        return;
+    }
+
+    switch(Type) {
+    case 0:
+    case 1:
+        if(Insert)
+            Debug.SetBreakpoint(U16(Addr));
+        else
+            Debug.ClearBreakpoint(U16(Addr));
+        break;
+    case 2:
+    case 3:
+    case 4: {
+        static const U8 Kinds[] = { Debugger::WatchWrite, Debugger::WatchRead, Debugger::WatchAccess };
+        const U16 Size = U16(std::min<U32>(std::max<U32>(Length, 1), 0x10000 - Addr));
+        if(Insert)
+            Debug.SetWatchpoint(U16(Addr), Size, Kinds[Type-2]);
+        else
+            Debug.ClearWatchpoint(U16(Addr), Size, Kinds[Type-2]);
+        break;
+    }
+    default:
+        SendPacket("");
+        return;
+    }
+    SendPacket("OK");
+}
+
+std::string GdbStub::HandleMonitor(const std::string& Command)
+{
+    static const char* Operators[] = { "", "==", "!=", "<", "<=", ">", ">=" };
+
+    std::istringstream Stream(Command);
+    std::string Verb, Argument;
+    Stream >> Verb >> Argument;
+
+    U32 Addr;
+    if(Verb == "break" && ParseArgument(Argument, Addr)) {
+        Debugger::Condition Cond;
+        std::string If, Reg, Op, Value;
+        if(Stream >> If) {
+            U32 CondValue;
+            if(!(If == "if" && Stream >> Reg >> Op >> Value && ParseArgument(Value, CondValue)))
+                return "Usage: break ADDR [if REG OP VALUE]\n";
+
+            int RegIndex = 0, OpIndex = 1;
+            while(RegIndex < Debugger::NumRegisters && Reg != RegisterNames[RegIndex])
+                RegIndex++;
+            while(OpIndex <= Debugger::GreaterEqual && Op != Operators[OpIndex])
+                OpIndex++;
+            if(RegIndex == Debugger::NumRegisters || OpIndex > Debugger::GreaterEqual)
+                return "Registers: a x y p sp pc, operators: == != < <= > >=\n";
+
+            Cond = Debugger::Condition(Debugger::Register(RegIndex), Debugger::Operator(OpIndex), U16(CondValue));
+        }
+        Debug.SetBreakpoint(U16(Addr), Cond);
+        return "Breakpoint at $" + Argument.substr(Argument[0] == '$' ? 1 : 0) + "\n";
+    }
+    if(Verb == "delete" && ParseArgument(Argument, Addr)) {
+        Debug.ClearBreakpoint(U16(Addr));
+        return "OK\n";
+    }
+    if(Verb == "reset" && Argument.empty()) {
+        Debug.Reset();
+        return "OK\n";
+    }
+    return "Commands: break ADDR [if REG OP VALUE], delete ADDR, reset\n";
+}
+
+void GdbStub::SendPacket(const std::string& Data)
+{
+    U8 Checksum = 0;
+    for(char Char : Data) {
+        Checksum += U8(Char);
+    }
+
+    LastPacket = "$" + Data + "#" + ToHex(Checksum, 1);
+    send(Client, LastPacket.data(), LastPacket.size(), 0);
+}
+
+std::string GdbStub::StopReply() const
+{
+    if(Debug.Reason() == Debugger::StopWatchpoint) {
+        const char* Kind;
+        switch(Debug.WatchHit()) {
+        case Debugger::WatchWrite: Kind = "watch";  break;
+        case Debugger::WatchRead:  Kind = "rwatch"; break;
+        default:                   Kind = "awatch"; break;
+        }
+        char Reply[32];
+        std::snprintf(Reply, sizeof(Reply), "T05%s:%04x;", Kind, Debug.WatchAddr());
+        return Reply;
+    }
+    return "S05";
+}
+
+#endif // _WIN32
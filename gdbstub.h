@@ -0,0 +1,53 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef GDBSTUB_H
+#define GDBSTUB_H
+
+#include <string>
+#include "common.h"
+
+class Debugger;
+
+// GDB remote serial protocol server driving the host debugger.
+// Listens on a local TCP port or Unix domain socket, one client at a time.
+// Registers are A, X, Y, P, SP (one byte each) and PC (two bytes, little endian).
+class GdbStub
+{
+public:
+    // Address is a TCP port number on loopback interface or a socket path
+    GdbStub(Debugger& InDebug, const char* Address);
+    ~GdbStub();
+
+    // Serves pending requests, waits up to given time for input.
+    // Returns false if client asked to kill the emulator.
+    bool Update(const U32 Timeout);
+
+private:
+    void Accept();
+    void Disconnect();
+    bool Receive();
+    bool HandlePacket(const std::string& Packet);
+    void HandleQuery(const std::string& Packet);
+    void HandleBreakpoint(const std::string& Packet, const bool Insert);
+    std::string HandleMonitor(const std::string& Command);
+
+    void SendPacket(const std::string& Data);
+    std::string StopReply() const;
+
+    Debugger& Debug;
+
+    int Listener;
+    int Client;
+    std::string SocketPath;
+
+    std::string Input;
+    std::string LastPacket;
+    bool NoAck;
+    bool Running;
+    bool Killed;
+};
+
+#endif // GDBSTUB_H
@@ -0,0 +1,230 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cstring>
+#include "cpu.h"
+#include "hle.h"
+
+HLE::HLE(CPU* InCPU, const char* InName)
+    : Device(InCPU)
+    , Enabled(false)
+    , Pending(false)
+    , Name(InName)
+    , Verify(false)
+    , VerifyRoutine(0)
+    , VerifyPC(0)
+    , VerifySP(0)
+    , Verified(0)
+    , Mismatches(0)
+{}
+
+HLE::~HLE()
+{
+    if(Verify) {
+        std::fprintf(stderr, "%s HLE: %u calls verified, %u mismatches\n", Name, Verified, Mismatches);
+    }
+}
+
+void HLE::EnableVerify(const bool InVerify)
+{
+    Verify = InVerify;
+}
+
+bool HLE::Run(const int Routine, const bool Jump)
+{
+    if(Pending || !Prepare(Routine))
+        return false;
+
+    if(!Verify) {
+        if(!Jump) {
+            Jsr(TheCPU.PC - 3);
+        }
+        Execute(Routine);
+
+        // RTS
+        const U8 Lo = Pop();
+        const U8 Hi = Pop();
+        TheCPU.PC = U16((Hi << 8 | Lo) + 1);
+        TheCPU.StallCycles += Cost(Routine);
+        return true;
+    }
+
+    // Compute expected result natively, then let the real routine run from original state
+    State Original;
+    SaveState(Original);
+
+    if(Jump) {
+        VerifySP = TheCPU.SP + 2;
+        VerifyPC = U16((RAM.Peek(0x100 + VerifySP) << 8 | RAM.Peek(0x100 + U8(VerifySP-1))) + 1);
+    }
+    else {
+        VerifySP = TheCPU.SP;
+        VerifyPC = TheCPU.PC;
+        Jsr(TheCPU.PC - 3);
+    }
+    Execute(Routine);
+    Pop();
+    Pop();
+
+    SaveState(Expected);
+    LoadState(Original);
+
+    Pending       = true;
+    VerifyRoutine = Routine;
+    return false;
+}
+
+U32 HLE::Cost(const int) const
+{
+    return TheCPU.Settings.HLECycles;
+}
+
+void HLE::Return()
+{
+    if(TheCPU.PC != VerifyPC || TheCPU.SP != VerifySP)
+        return;
+
+    Pending = false;
+    Verified++;
+
+    State Actual;
+    SaveState(Actual);
+
+    int Errors = 0;
+    auto Report = [&](const char* What, const U8 Want, const U8 Got) {
+        if(Errors++ < 8) {
+            std::fprintf(stderr, "%s HLE: %s returning to $%04x: %s expected $%02x, got $%02x\n",
+                         Name, RoutineName(VerifyRoutine), VerifyPC, What, Want, Got);
+        }
+    };
+
+    if(Expected.A  != Actual.A)  Report("A",  Expected.A,  Actual.A);
+    if(Expected.X  != Actual.X)  Report("X",  Expected.X,  Actual.X);
+    if(Expected.Y  != Actual.Y)  Report("Y",  Expected.Y,  Actual.Y);
+    if(Expected.SP != Actual.SP) Report("SP", Expected.SP, Actual.SP);
+    if(Expected.P  != Actual.P)  Report("P",  Expected.P,  Actual.P);
+
+    // Stack below SP is scratch space and is clobbered by interrupts
+    for(U32 Addr=0; Addr<MEMSIZE; Addr++) {
+        if((Addr >> 8) == 0xFD || (Addr >= 0x100 && Addr <= U32(0x100 + VerifySP)))
+            continue;
+        if(Expected.Memory[Addr] != Actual.Memory[Addr]) {
+            char What[16];
+            std::snprintf(What, sizeof(What), "$%04x", Addr);
+            Report(What, Expected.Memory[Addr], Actual.Memory[Addr]);
+        }
+    }
+
+    if(Errors > 0)
+        Mismatches++;
+}
+
+void HLE::Push(const U8 Value)
+{
+    RAM.Poke(0x100 + TheCPU.SP, Value);
+    TheCPU.SP--;
+}
+
+U8 HLE::Pop()
+{
+    TheCPU.SP++;
+    return RAM.Peek(0x100 + TheCPU.SP);
+}
+
+void HLE::Jsr(const U16 Site)
+{
+    const U16 ReturnAddr = Site + 2;
+    Push(ReturnAddr >> 8);
+    Push(ReturnAddr & 0xFF);
+}
+
+void HLE::Rts()
+{
+    TheCPU.SP += 2;
+}
+
+void HLE::SetNZ(const U8 Value)
+{
+    TheCPU.Flags.Z = (Value == 0);
+    TheCPU.Flags.S = (Value >> 7);
+}
+
+U8 HLE::ADC(const U8 OpA, const U8 OpB)
+{
+    const U16 Sum    = OpA + OpB + TheCPU.Flags.C;
+    const U8  Result = Sum & 0xFF;
+    TheCPU.Flags.C = (Sum >> 8) & 1;
+    TheCPU.Flags.V = ((OpA ^ Result) & (OpB ^ Result) & 0x80) != 0;
+    SetNZ(Result);
+    return Result;
+}
+
+U8 HLE::SBC(const U8 OpA, const U8 OpB)
+{
+    const int Diff   = OpA - OpB - !TheCPU.Flags.C;
+    const U8  Result = Diff & 0xFF;
+    TheCPU.Flags.C = (Diff >= 0);
+    TheCPU.Flags.V = ((OpA ^ Result) & ((0xFF-OpB) ^ Result) & 0x80) != 0;
+    SetNZ(Result);
+    return Result;
+}
+
+void HLE::CMP(const U8 OpA, const U8 OpB)
+{
+    TheCPU.Flags.C = (OpA >= OpB);
+    SetNZ(U8(OpA - OpB));
+}
+
+U8 HLE::ASL(const U8 Value)
+{
+    TheCPU.Flags.C = Value >> 7;
+    SetNZ(Value << 1);
+    return Value << 1;
+}
+
+U8 HLE::LSR(const U8 Value)
+{
+    TheCPU.Flags.C = Value & 1;
+    SetNZ(Value >> 1);
+    return Value >> 1;
+}
+
+U8 HLE::ROL(const U8 Value)
+{
+    const U8 Result = (Value << 1) | TheCPU.Flags.C;
+    TheCPU.Flags.C  = Value >> 7;
+    SetNZ(Result);
+    return Result;
+}
+
+U8 HLE::PackFlags() const
+{
+    return TheCPU.FlagRegister();
+}
+
+void HLE::UnpackFlags(const U8 Value)
+{
+    TheCPU.FlagRegister() = Value;
+}
+
+void HLE::SaveState(State& Out) const
+{
+    Out.A  = TheCPU.A;
+    Out.X  = TheCPU.X;
+    Out.Y  = TheCPU.Y;
+    Out.SP = TheCPU.SP;
+    Out.P  = TheCPU.FlagRegister();
+    Out.Memory.assign(RAM.Memory, RAM.Memory + MEMSIZE);
+}
+
+void HLE::LoadState(const State& In)
+{
+    TheCPU.A  = In.A;
+    TheCPU.X  = In.X;
+    TheCPU.Y  = In.Y;
+    TheCPU.SP = In.SP;
+    TheCPU.FlagRegister() = In.P;
+    std::memcpy(RAM.Memory, In.Memory.data(), MEMSIZE);
+}
@@ -0,0 +1,100 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef HLE_H
+#define HLE_H
+
+#include <vector>
+#include "common.h"
+#include "device.h"
+
+// Base class for native (high-level) emulation of ROM routines.
+// Derived classes replicate every guest visible effect of a routine,
+// including scratch bytes left on the stack, registers and flags.
+class HLE : public Device
+{
+public:
+    virtual ~HLE();
+
+    // Called on RTS while verification is pending
+    void Return();
+
+    bool Enabled;
+    bool Pending;
+
+protected:
+    HLE(CPU* InCPU, const char* InName);
+
+    // Executes routine natively, or starts verification run. Returns false
+    // if guest should execute the routine itself. Jump is set if routine was
+    // entered via JMP (tail call) instead of JSR.
+    bool Run(const int Routine, const bool Jump);
+
+    // Checks whether routine can be executed natively in current state
+    virtual bool Prepare(const int Routine) = 0;
+    // Executes routine body, must leave SP pointing at return address
+    virtual void Execute(const int Routine) = 0;
+    virtual const char* RoutineName(const int Routine) const = 0;
+    // Cycles charged for natively executed routine
+    virtual U32 Cost(const int Routine) const;
+
+    void EnableVerify(const bool Verify);
+
+    // Memory & stack helpers, zero page is never banked
+    inline U8& ZeroPage(const U8 Addr)
+    {
+        return RAM.Memory[Addr];
+    }
+    inline U8 ZeroPage(const U8 Addr) const
+    {
+        return RAM.Peek(Addr);
+    }
+    inline U16 ReadPointer(const U8 Addr) const
+    {
+        return RAM.Peek(Addr) | RAM.Peek(U8(Addr+1)) << 8;
+    }
+    inline void WritePointer(const U8 Addr, const U16 Value)
+    {
+        RAM.Poke(Addr, Value & 0xFF);
+        RAM.Poke(U8(Addr+1), Value >> 8);
+    }
+    void Push(const U8 Value);
+    U8   Pop();
+    // Stack effects of JSR instruction located at Site and matching RTS
+    void Jsr(const U16 Site);
+    void Rts();
+
+    // Register & flag helpers following 6502 binary mode semantics
+    void SetNZ(const U8 Value);
+    U8   ADC(const U8 OpA, const U8 OpB);
+    U8   SBC(const U8 OpA, const U8 OpB);
+    void CMP(const U8 OpA, const U8 OpB);
+    U8   ASL(const U8 Value);
+    U8   LSR(const U8 Value);
+    U8   ROL(const U8 Value);
+    U8   PackFlags() const;
+    void UnpackFlags(const U8 Value);
+
+    const char* Name;
+
+private:
+    struct State {
+        U8 A, X, Y, SP, P;
+        std::vector<U8> Memory;
+    };
+    void SaveState(State& Out) const;
+    void LoadState(const State& In);
+
+    bool  Verify;
+    int   VerifyRoutine;
+    U16   VerifyPC;
+    U8    VerifySP;
+    State Expected;
+
+    U32 Verified;
+    U32 Mismatches;
+};
+
+#endif // HLE_H
@@ -0,0 +1,110 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "host.h"
+#include "ringbuffer.h"
+
+namespace {
+    U64 SteadyMilliseconds()
+    {
+        using namespace std::chrono;
+        return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+SystemClock::SystemClock()
+    : Origin(SteadyMilliseconds())
+{}
+
+U32 SystemClock::Milliseconds()
+{
+    return U32(SteadyMilliseconds() - Origin);
+}
+
+void SystemClock::Sleep(const U32 Duration)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(Duration));
+}
+
+// State shared with input thread, which may outlive the link while blocked reading
+struct StreamLink::Reader
+{
+    explicit Reader(std::FILE* InFile)
+        : File(InFile)
+        , Buffer(4096)
+        , End(InFile == nullptr)
+        , Stop(false)
+    {}
+
+    void Run()
+    {
+        int Char;
+        while(!Stop && (Char = std::fgetc(File)) != EOF) {
+            if(Char == '\r')
+                continue;
+            const U8 Byte = (Char == '\n') ? 0x0D : U8(Char);
+            while(!Buffer.Push(Byte)) {
+                if(Stop)
+                    return;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        End = true;
+    }
+
+    std::FILE*        File;
+    RingBuffer<U8>    Buffer;
+    std::atomic<bool> End;
+    std::atomic<bool> Stop;
+};
+
+StreamLink::StreamLink(std::FILE* Input, std::FILE* Output)
+    : In(std::make_shared<Reader>(Input))
+    , Out(Output)
+    , Unflushed(false)
+{
+    if(Input) {
+        std::shared_ptr<Reader> State = In;
+        std::thread([State]() { State->Run(); }).detach();
+    }
+}
+
+StreamLink::~StreamLink()
+{
+    In->Stop = true;
+    if(Out) {
+        std::fflush(Out);
+    }
+}
+
+void StreamLink::Send(const U8 Byte)
+{
+    if(!Out)
+        return;
+
+    std::fputc(Byte == 0x0D ? '\n' : Byte, Out);
+    Unflushed = true;
+}
+
+bool StreamLink::Receive(U8& Byte)
+{
+    if(In->Buffer.Pop(Byte))
+        return true;
+
+    // Guest is waiting for input, show what it has sent so far
+    if(Unflushed) {
+        std::fflush(Out);
+        Unflushed = false;
+    }
+    return false;
+}
+
+bool StreamLink::Closed() const
+{
+    return In->End && In->Buffer.Empty();
+}
@@ -0,0 +1,120 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include "common.h"
+
+// Host video output
+class VideoOutput
+{
+public:
+    virtual ~VideoOutput() {}
+
+    // Called on CPU thread with every complete frame.
+    // Pixels are 4 bytes each in R, G, B, A order.
+    virtual void Present(const U8* Pixels, const U16 Width, const U16 Height, const int Pitch) = 0;
+};
+
+// Host audio output
+class AudioOutput
+{
+public:
+    virtual ~AudioOutput() {}
+
+    // Called with every block of synthesized mono samples in [-1,1] range,
+    // on synthesis thread if there is one
+    virtual void Write(const float* Samples, const size_t Count) = 0;
+    // Fill level of output buffer in [0,1] range used for dynamic rate
+    // control, or negative if output consumes samples as fast as they come
+    virtual double Fill() const { return -1.0; }
+    // Number of times output ran out of samples so far
+    virtual U32 Underruns() const { return 0; }
+};
+
+// Host wall clock used to run emulation in real time
+class Clock
+{
+public:
+    virtual ~Clock() {}
+
+    virtual U32  Milliseconds() = 0;
+    virtual void Sleep(const U32 Duration) = 0;
+};
+
+// Clock based on C++ standard library
+class SystemClock : public Clock
+{
+public:
+    SystemClock();
+
+    U32  Milliseconds() override;
+    void Sleep(const U32 Duration) override;
+
+private:
+    U64 Origin;
+};
+
+// Host byte stream connected to serial port
+class SerialLink
+{
+public:
+    virtual ~SerialLink() {}
+
+    // Called on CPU thread with every byte transmitted by the guest
+    virtual void Send(const U8 Byte) = 0;
+    // Returns next received byte if one is available, must not block
+    virtual bool Receive(U8& Byte) = 0;
+    // True when no more bytes will be received
+    virtual bool Closed() const { return false; }
+};
+
+// Serial link over stdio streams, e.g. standard input and output.
+// Input is read on a separate thread so the guest never waits for the host.
+// Host line feeds are received as CR and transmitted CR is written as line feed.
+class StreamLink : public SerialLink
+{
+public:
+    // Either stream may be null
+    StreamLink(std::FILE* Input, std::FILE* Output);
+    ~StreamLink();
+
+    void Send(const U8 Byte) override;
+    bool Receive(U8& Byte) override;
+    bool Closed() const override;
+
+private:
+    struct Reader;
+    std::shared_ptr<Reader> In;
+    std::FILE* Out;
+    bool Unflushed;
+};
+
+// Host backends emulator is attached to, all of them are optional.
+// Backends are owned by the host and must outlive the emulator.
+struct Host
+{
+    Host()
+        : Video(nullptr)
+        , Audio(nullptr)
+        , Wallclock(nullptr)
+        , Serial(nullptr)
+    {}
+
+    // Frames are not rendered without video output
+    VideoOutput* Video;
+    // Audio is not synthesized without audio output
+    AudioOutput* Audio;
+    // Defaults to SystemClock
+    Clock*       Wallclock;
+    // Serial port is not attached without serial link
+    SerialLink*  Serial;
+};
+
+#endif // HOST_H
@@ -4,6 +4,8 @@
  */
 
 #include <map>
+#include <cstdlib>
+#include <cctype>
 #include "cpu.h"
 #include "mcc.h"
 #include "keyboard.h"
@@ -14,147 +16,259 @@ namespace {
         RegKeyboardData   = 0x01,
     };
 
-    const std::map<Sint32, U8> ShiftedSymbols = {
-        {SDLK_BACKQUOTE,   '~'},
-        {SDLK_1,           '!'},
-        {SDLK_2,           '@'},
-        {SDLK_3,           '#'},
-        {SDLK_4,           '$'},
-        {SDLK_5,           '%'},
-        {SDLK_6,           '^'},
-        {SDLK_7,           '&'},
-        {SDLK_8,           '*'},
-        {SDLK_9,           '('},
-        {SDLK_0,           ')'},
-        {SDLK_MINUS,       '_'},
-        {SDLK_EQUALS,      '+'},
-        {SDLK_LEFTBRACKET, '{'},
-        {SDLK_RIGHTBRACKET,'}'},
-        {SDLK_SEMICOLON,   ':'},
-        {SDLK_QUOTE,       '"'},
-        {SDLK_COMMA,       '<'},
-        {SDLK_PERIOD,      '>'},
-        {SDLK_SLASH,       '?'},
-        {SDLK_BACKSLASH,   '|'},
+    // Shifted symbols of US keyboard layout
+    const std::map<U8, U8> ShiftedSymbols = {
+        {'`',  '~'},
+        {'1',  '!'},
+        {'2',  '@'},
+        {'3',  '#'},
+        {'4',  '$'},
+        {'5',  '%'},
+        {'6',  '^'},
+        {'7',  '&'},
+        {'8',  '*'},
+        {'9',  '('},
+        {'0',  ')'},
+        {'-',  '_'},
+        {'=',  '+'},
+        {'[',  '{'},
+        {']',  '}'},
+        {';',  ':'},
+        {'\'', '"'},
+        {',',  '<'},
+        {'.',  '>'},
+        {'/',  '?'},
+        {'\\', '|'},
     };
 
-    const std::map<Sint32, U8> SpecialKeys = {
-        {SDLK_LSHIFT,   0x01},
-        {SDLK_RSHIFT,   0x02},
-        {SDLK_LCTRL,    0x03},
-        {SDLK_RCTRL,    0x04},
-        {SDLK_LALT,     0x05},
-        {SDLK_RALT,     0x06},
-
-        {SDLK_CAPSLOCK,   0x0A},
-        {SDLK_SCROLLLOCK, 0x0B},
-
-        {SDLK_RIGHT, 0x0E},
-        {SDLK_LEFT,  0x0F},
-        {SDLK_UP,    0x10},
-        {SDLK_DOWN,  0x11},
-
-        {SDLK_F1,  0x81},
-        {SDLK_F2,  0x82},
-        {SDLK_F3,  0x83},
-        {SDLK_F4,  0x84},
-        {SDLK_F5,  0x85},
-        {SDLK_F6,  0x86},
-        {SDLK_F7,  0x87},
-        {SDLK_F8,  0x88},
-        {SDLK_F9,  0x89},
-        {SDLK_F10, 0x8A},
-        {SDLK_F11, 0x8B},
-        {SDLK_F12, 0x8C},
-
-        {SDLK_HOME,     0x50},
-        {SDLK_END,      0x51},
-        {SDLK_PAGEUP,   0x52},
-        {SDLK_PAGEDOWN, 0x53},
-        {SDLK_INSERT,   0x7E},
+    const U8 KeyLeftShift  = 0x01;
+    const U8 KeyRightShift = 0x02;
+
+    // Key names recognized in {KEY} escapes of injected scripts
+    const std::map<std::string, U8> ScriptKeys = {
+        {"CR",    0x0D},
+        {"BS",    0x08},
+        {"TAB",   0x09},
+        {"ESC",   0x1B},
+        {"RIGHT", 0x0E},
+        {"LEFT",  0x0F},
+        {"UP",    0x10},
+        {"DOWN",  0x11},
+        {"HOME",  0x50},
+        {"END",   0x51},
+        {"PGUP",  0x52},
+        {"PGDN",  0x53},
+        {"INS",   0x7E},
+        {"F1",    0x81},
+        {"F2",    0x82},
+        {"F3",    0x83},
+        {"F4",    0x84},
+        {"F5",    0x85},
+        {"F6",    0x86},
+        {"F7",    0x87},
+        {"F8",    0x88},
+        {"F9",    0x89},
+        {"F10",   0x8A},
+        {"F11",   0x8B},
+        {"F12",   0x8C},
+    };
+
+    const U8 StatusPressed  = 1<<6;
+    const U8 StatusReleased = 1<<7;
+
+    enum ControlBits {
+        CtlShift     = 0x01,
+        CtlUppercase = 0x02,
+        CtlLevelIRQ  = 0x04,
     };
+
+    // Release of key code zero marks events lost while buffer was full
+    const U8 KeyOverflow = 0x00;
 }
 
 Keyboard::Keyboard(CPU* InCPU)
     : Device(InCPU)
-    , Data(0)
-    , Status(0)
+    , Control(0)
+    , Released(0)
+    , HasReleased(false)
 {
     RAM.AllocRegister<Keyboard>(RegKeyboardStatus, this, &Keyboard::ReadRegister, &Keyboard::WriteRegister);
     RAM.AllocRegister<Keyboard>(RegKeyboardData,   this, &Keyboard::ReadRegister, &Keyboard::WriteRegister);
 }
 
-void Keyboard::TranslateEvent(SDL_KeyboardEvent Event)
+void Keyboard::KeyEvent(const U8 Code, const bool Pressed, const U8 Mods)
 {
-    const Sint32 KeyCode = Event.keysym.sym;
-    bool ShiftKeys       = Event.keysym.mod & (KMOD_SHIFT | KMOD_CAPS);
-
-    if(KeyCode <= 0x7F) {
-        if(KeyCode >= SDLK_a && KeyCode <= SDLK_z) {
-            Data = KeyCode;
-            if(ShiftKeys || (Status & 0x02))
-                Data &= 0xDF;
-        }
-        else {
-            Data = KeyCode;
-            if(ShiftKeys && (Status & 0x01)) {
-                auto KeyIt = ShiftedSymbols.find(KeyCode);
-                if(KeyIt != ShiftedSymbols.end())
-                    Data = KeyIt->second;
-            }
-        }
-    }
-    else {
-        if((Status & 0x01) && (KeyCode == SDLK_LSHIFT || KeyCode == SDLK_RSHIFT))
-            return;
-
-        auto KeyIt = SpecialKeys.find(KeyCode);
-        if(KeyIt == SpecialKeys.end())
-            return;
+    const bool ShiftKeys = Mods & (ModShift | ModCaps);
+    U8 Data = Code;
 
-        Data = KeyIt->second;
+    if(Code >= 'a' && Code <= 'z') {
+        if(ShiftKeys || (Control & CtlUppercase))
+            Data &= 0xDF;
     }
-
-    Status &= 0x03;
-    if(Event.state == SDL_PRESSED) {
-        Status |= 1<<6;
-    }
-    else {
-        Status |= 1<<7;
+    else if(ShiftKeys && (Control & CtlShift)) {
+        auto KeyIt = ShiftedSymbols.find(Code);
+        if(KeyIt != ShiftedSymbols.end())
+            Data = KeyIt->second;
     }
 
+    // Shift is applied by controller, shift keys alone are not reported
+    if((Control & CtlShift) && (Code == KeyLeftShift || Code == KeyRightShift))
+        return;
+
+    U8 Status = Pressed ? StatusPressed : StatusReleased;
     if(ShiftKeys) {
         Status |= 1<<5;
     }
-    if(Event.keysym.mod & KMOD_ALT) {
+    if(Mods & ModAlt) {
         Status |= 1<<4;
     }
-    if(Event.keysym.mod & KMOD_CTRL) {
+    if(Mods & ModCtrl) {
         Status |= 1<<3;
     }
 
-    TheCPU.SignalInterrupt(CPU::INT_IRQ);
+    PushEvent(Data, Status);
+}
+
+void Keyboard::PressKey(const U8 Code)
+{
+    U8 Data = Code;
+    if(Data >= 'a' && Data <= 'z' && (Control & CtlUppercase))
+        Data &= 0xDF;
+
+    PushEvent(Data, StatusPressed);
+}
+
+void Keyboard::InjectText(const std::string& Text)
+{
+    TranslateText(Text, Injected);
+}
+
+void Keyboard::TranslateText(const std::string& Text, std::deque<U8>& Keys)
+{
+    // Both LF and CR LF line endings are typed as a single CR
+    for(size_t Index=0; Index<Text.size(); Index++) {
+        if(Text[Index] == '\r' && Index+1 < Text.size() && Text[Index+1] == '\n')
+            continue;
+        Keys.push_back(Text[Index] == '\n' ? 0x0D : U8(Text[Index]));
+    }
+}
+
+bool Keyboard::InjectScript(const std::string& Script)
+{
+    std::string Text;
+    std::deque<U8> Keys;
+    for(size_t Index=0; Index<Script.size(); Index++) {
+        if(Script[Index] != '{' || (Index+1 < Script.size() && Script[Index+1] == '{')) {
+            Text.push_back(Script[Index]);
+            Index += (Script[Index] == '{');
+            continue;
+        }
+
+        const size_t End = Script.find('}', Index);
+        if(End == std::string::npos)
+            return false;
+
+        const std::string Name = Script.substr(Index+1, End-Index-1);
+        U8 Code;
+        if(Name.size() == 3 && Name[0] == '$' && std::isxdigit(Name[1]) && std::isxdigit(Name[2])) {
+            Code = U8(std::strtoul(Name.c_str()+1, nullptr, 16));
+        }
+        else {
+            auto KeyIt = ScriptKeys.find(Name);
+            if(KeyIt == ScriptKeys.end())
+                return false;
+            Code = KeyIt->second;
+        }
+
+        // Escaped keys bypass newline translation of literal text
+        TranslateText(Text, Keys);
+        Text.clear();
+        Keys.push_back(Code);
+        Index = End;
+    }
+    TranslateText(Text, Keys);
+
+    Injected.insert(Injected.end(), Keys.begin(), Keys.end());
+    return true;
+}
+
+void Keyboard::PushEvent(const U8 Data, const U8 Status)
+{
+    // Last free slot is taken by overflow marker, further events are dropped
+    if(Events.size() + 1 < MaxEvents) {
+        Events.push_back({Data, Status});
+    }
+    else if(Events.size() < MaxEvents) {
+        Events.push_back({KeyOverflow, StatusReleased});
+    }
+    if(TheCPU.Events.Enabled)
+        TheCPU.Events.Instant(Timeline::EventKeyboardIRQ, Timeline::ThreadCPU, TheCPU.TotalCycles, Data);
+
+    // Edge-triggered IRQ is requested once per event and lost if masked
+    if(Control & CtlLevelIRQ)
+        UpdateIRQ();
+    else
+        TheCPU.SignalInterrupt(CPU::INT_IRQ);
+}
+
+void Keyboard::UpdateIRQ()
+{
+    // Level-triggered IRQ is held while events are pending
+    if((Control & CtlLevelIRQ) && !Events.empty())
+        TheCPU.AssertIRQ(CPU::IRQ_Keyboard);
+    else
+        TheCPU.ReleaseIRQ(CPU::IRQ_Keyboard);
+}
+
+void Keyboard::FeedInjected()
+{
+    // Injected keys are paced by the guest: next one is pressed only
+    // after the previous one has been read and the guest polls again
+    if(Events.empty() && !Injected.empty()) {
+        PressKey(Injected.front());
+        Injected.pop_front();
+    }
 }
 
 U8 Keyboard::ReadRegister(U8 Reg)
 {
+    // Also reached by dummy read of stores to KBDCTL, which may consume a release event
     U8 Result = 0;
     switch(Reg) {
     case RegKeyboardStatus:
-        Result = Status;
+        FeedInjected();
+        Result = Control;
+        HasReleased = false;
+        if(!Events.empty()) {
+            Result |= Events.front().Status;
+            // Release events are removed once reported, so software waiting
+            // for a key press is not blocked by them; KBDDAT still returns the key
+            if(Events.front().Status & StatusReleased) {
+                Released    = Events.front().Data;
+                HasReleased = true;
+                Events.pop_front();
+            }
+        }
         break;
     case RegKeyboardData:
-        Result  = Data;
-        Status &= 0x03;
-        Data    = 0;
+        if(HasReleased) {
+            Result      = Released;
+            HasReleased = false;
+        }
+        else if(!Events.empty()) {
+            Result = Events.front().Data;
+            Events.pop_front();
+        }
         break;
     }
+    UpdateIRQ();
     return Result;
 }
 
 void Keyboard::WriteRegister(U8 Reg, U8 Data)
 {
     if(Reg == RegKeyboardStatus) {
-        Status = (Data & 0x03) | (Status & 0xFC);
+        Control = Data & (CtlShift | CtlUppercase | CtlLevelIRQ);
+        UpdateIRQ();
     }
 }
@@ -6,7 +6,8 @@
 #ifndef KEYBOARD_H
 #define KEYBOARD_H
 
-#include <queue>
+#include <deque>
+#include <string>
 #include "common.h"
 #include "device.h"
 
@@ -14,13 +15,52 @@ class Keyboard : public Device
 {
 public:
     Keyboard(CPU* InCPU);
-    void TranslateEvent(SDL_KeyboardEvent Event);
 
-    U8 Data;
-    U8 Status;
+    // Modifier keys held during a host key event
+    enum Modifiers {
+        ModShift = 0x01,
+        ModCaps  = 0x02,
+        ModAlt   = 0x04,
+        ModCtrl  = 0x08,
+    };
+
+    // Host key press or release. Code is unshifted ASCII character for
+    // character keys or keyboard controller code for special keys.
+    void KeyEvent(const U8 Code, const bool Pressed, const U8 Mods);
+    void PressKey(const U8 Code);
+
+    // Queue text to be typed as fast as the guest consumes it
+    void InjectText(const std::string& Text);
+    // Same as InjectText, but also translates {KEY} escape sequences
+    bool InjectScript(const std::string& Script);
+
+    bool IsInjecting() const { return !Injected.empty(); }
+    // Presses next injected key if previous one has been consumed
+    void FeedInjected();
+
+    // Maximum number of keyboard events buffered by the controller
+    static const size_t MaxEvents = 16;
+
 private:
     U8   ReadRegister(U8 Reg);
     void WriteRegister(U8 Reg, U8 Data);
+
+    void PushEvent(const U8 Data, const U8 Status);
+    void UpdateIRQ();
+
+    static void TranslateText(const std::string& Text, std::deque<U8>& Keys);
+
+    struct Event {
+        U8 Data;
+        U8 Status;
+    };
+
+    std::deque<Event> Events;
+    std::deque<U8>    Injected;
+    U8 Control;
+    // Key code of release event reported by last KBDCTL read, until KBDDAT is read
+    U8 Released;
+    bool HasReleased;
 };
 
 #endif // KEYBOARD_H
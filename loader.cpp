@@ -0,0 +1,516 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include "loader.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    bool HasExtension(const std::string& Path, const char* Extension)
+    {
+        const size_t Length = std::strlen(Extension);
+        if(Path.size() < Length)
+            return false;
+        for(size_t i=0; i<Length; i++) {
+            if(std::tolower(U8(Path[Path.size() - Length + i])) != Extension[i])
+                return false;
+        }
+        return true;
+    }
+
+    bool IsDebugInfo(const MappedFile& File)
+    {
+        static const char Header[] = "version\tmajor=";
+        return File.Size() >= sizeof(Header) - 1 && std::memcmp(File.Data(), Header, sizeof(Header) - 1) == 0;
+    }
+
+    // Calls Func for every line of mapped text file
+    template<class Func>
+    void ForEachLine(const MappedFile& File, Func Callback)
+    {
+        const char* Text = reinterpret_cast<const char*>(File.Data());
+        const char* End  = Text + File.Size();
+        while(Text < End) {
+            const char* Eol = static_cast<const char*>(std::memchr(Text, '\n', End - Text));
+            const char* LineEnd = Eol ? Eol : End;
+            std::string Line(Text, LineEnd);
+            if(!Line.empty() && Line.back() == '\r')
+                Line.pop_back();
+            Callback(Line);
+            Text = LineEnd + 1;
+        }
+    }
+
+    // Labels of ld65 debug file, cheap local labels have a parent and are not unique
+    void AddSymbol(SymbolTable& Symbols, DebugRecord& Attributes)
+    {
+        if(Attributes["type"] != "lab" || Attributes.count("parent"))
+            return;
+        const long Value = DebugAttribute(Attributes, "val");
+        if(Value >= 0 && Value < long(MEMSIZE))
+            Symbols.Add(Attributes["name"], U16(Value));
+    }
+
+    int HexDigit(const char C)
+    {
+        if(C >= '0' && C <= '9') return C - '0';
+        if(C >= 'A' && C <= 'F') return C - 'A' + 10;
+        if(C >= 'a' && C <= 'f') return C - 'a' + 10;
+        return -1;
+    }
+}
+
+bool ParseDebugRecord(const std::string& Line, std::string& Type, DebugRecord& Attributes)
+{
+    const size_t Tab = Line.find('\t');
+    if(Tab == std::string::npos)
+        return false;
+
+    Type = Line.substr(0, Tab);
+    Attributes.clear();
+
+    size_t Pos = Tab + 1;
+    while(Pos < Line.size()) {
+        const size_t Equals = Line.find('=', Pos);
+        if(Equals == std::string::npos)
+            break;
+        const std::string Key = Line.substr(Pos, Equals - Pos);
+
+        std::string Value;
+        Pos = Equals + 1;
+        if(Pos < Line.size() && Line[Pos] == '"') {
+            const size_t Quote = Line.find('"', Pos + 1);
+            Value = Line.substr(Pos + 1, Quote - Pos - 1);
+            Pos = (Quote == std::string::npos) ? Line.size() : Quote + 1;
+        }
+        else {
+            const size_t Comma = Line.find(',', Pos);
+            Value = Line.substr(Pos, Comma - Pos);
+            Pos = (Comma == std::string::npos) ? Line.size() : Comma;
+        }
+        Attributes[Key] = Value;
+
+        if(Pos < Line.size() && Line[Pos] == ',')
+            Pos++;
+    }
+    return true;
+}
+
+long DebugAttribute(const DebugRecord& Attributes, const char* Key, const long Default)
+{
+    auto It = Attributes.find(Key);
+    return (It == Attributes.end()) ? Default : std::strtol(It->second.c_str(), nullptr, 0);
+}
+
+std::string DirectoryOf(const std::string& Path)
+{
+    const size_t Slash = Path.find_last_of("/\\");
+    return (Slash == std::string::npos) ? std::string() : Path.substr(0, Slash + 1);
+}
+
+MappedFile::MappedFile()
+    : Bytes(nullptr)
+    , Length(0)
+    , Shared(false)
+#ifdef _WIN32
+    , FileHandle(INVALID_HANDLE_VALUE)
+    , MappingHandle(nullptr)
+#else
+    , Mapped(false)
+#endif
+{}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const char* FileName, const bool Writable)
+{
+    Close();
+
+#ifdef _WIN32
+    FileHandle = CreateFileA(FileName, Writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(FileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER FileSize;
+    if(!GetFileSizeEx(FileHandle, &FileSize)) {
+        Close();
+        return false;
+    }
+    Length = size_t(FileSize.QuadPart);
+    if(Length > 0) {
+        MappingHandle = CreateFileMappingA(FileHandle, nullptr, Writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+        if(MappingHandle)
+            Bytes = static_cast<U8*>(MapViewOfFile(MappingHandle, Writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    const int Descriptor = open(FileName, Writable ? O_RDWR : O_RDONLY);
+    if(Descriptor < 0)
+        return false;
+
+    struct stat Status;
+    if(fstat(Descriptor, &Status) != 0 || !S_ISREG(Status.st_mode)) {
+        close(Descriptor);
+        return false;
+    }
+    Length = size_t(Status.st_size);
+    if(Length > 0) {
+        void* Address = Writable ? mmap(nullptr, Length, PROT_READ | PROT_WRITE, MAP_SHARED, Descriptor, 0)
+                                 : mmap(nullptr, Length, PROT_READ, MAP_PRIVATE, Descriptor, 0);
+        if(Address != MAP_FAILED) {
+            Bytes  = static_cast<U8*>(Address);
+            Mapped = true;
+        }
+    }
+    close(Descriptor);
+#endif
+
+    if(Writable) {
+        if(!Bytes) {
+            Close();
+            return false;
+        }
+        Shared = true;
+        return true;
+    }
+    if(!Bytes && Length > 0) {
+        std::ifstream File(FileName, std::ios::binary);
+        Buffer.resize(Length);
+        if(!File.read(reinterpret_cast<char*>(Buffer.data()), Length)) {
+            Close();
+            return false;
+        }
+        Bytes = Buffer.data();
+    }
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if(MappingHandle) {
+        if(Bytes && Buffer.empty())
+            UnmapViewOfFile(Bytes);
+        CloseHandle(MappingHandle);
+        MappingHandle = nullptr;
+    }
+    if(FileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(FileHandle);
+        FileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if(Mapped) {
+        munmap(Bytes, Length);
+        Mapped = false;
+    }
+#endif
+    Buffer.clear();
+    Bytes  = nullptr;
+    Length = 0;
+    Shared = false;
+}
+
+void SymbolTable::Add(const std::string& Name, const U16 Addr)
+{
+    ByName[Name] = Addr;
+    // First label at an address names it
+    ByAddr.insert(std::make_pair(Addr, Name));
+}
+
+bool SymbolTable::Find(const std::string& Name, U16& Addr) const
+{
+    auto It = ByName.find(Name);
+    if(It == ByName.end())
+        return false;
+    Addr = It->second;
+    return true;
+}
+
+const std::string* SymbolTable::Name(const U16 Addr) const
+{
+    auto It = ByAddr.find(Addr);
+    return (It == ByAddr.end()) ? nullptr : &It->second;
+}
+
+bool SymbolTable::Load(const char* FileName)
+{
+    MappedFile File;
+    if(!File.Open(FileName)) {
+        std::fprintf(stderr, "Could not open symbol file: %s\n", FileName);
+        return false;
+    }
+
+    const size_t Count = Size();
+    if(IsDebugInfo(File)) {
+        std::string Type;
+        DebugRecord Attributes;
+        ForEachLine(File, [&](const std::string& Line) {
+            if(ParseDebugRecord(Line, Type, Attributes) && Type == "sym")
+                AddSymbol(*this, Attributes);
+        });
+    }
+    else {
+        // VICE label format written by ld65 -Ln: "al 00C400 .Name"
+        ForEachLine(File, [&](const std::string& Line) {
+            char Name[256];
+            unsigned long Value;
+            if(std::sscanf(Line.c_str(), "al %lx %255s", &Value, Name) != 2 || Value >= MEMSIZE)
+                return;
+            Add(Name[0] == '.' ? Name + 1 : Name, U16(Value));
+        });
+    }
+
+    if(Size() == Count) {
+        std::fprintf(stderr, "No symbols in file: %s\n", FileName);
+        return false;
+    }
+    return true;
+}
+
+Loader::Loader(U8* InMemory)
+    : Memory(InMemory)
+{}
+
+bool Loader::LoadSymbols(const char* FileName)
+{
+    const size_t Count = Symbols.Size();
+    if(!Symbols.Load(FileName))
+        return false;
+    std::printf("Loaded %lu symbols from %s\n", (unsigned long)(Symbols.Size() - Count), FileName);
+    return true;
+}
+
+bool Loader::Load(const std::string& Spec)
+{
+    std::string FileName = Spec;
+    U16  Addr    = 0;
+    bool HasAddr = false;
+
+    const size_t At = Spec.rfind('@');
+    if(At != std::string::npos && At > 0) {
+        FileName = Spec.substr(0, At);
+        if(!ParseAddress(Spec.substr(At + 1), Addr)) {
+            std::fprintf(stderr, "Invalid load address: %s\n", Spec.c_str());
+            return false;
+        }
+        HasAddr = true;
+    }
+
+    MappedFile File;
+    if(!File.Open(FileName.c_str())) {
+        std::fprintf(stderr, "Could not open file: %s\n", FileName.c_str());
+        return false;
+    }
+
+    const bool IsHex   = HasExtension(FileName, ".hex") || HasExtension(FileName, ".ihx");
+    const bool IsDebug = IsDebugInfo(File);
+    if(HasAddr && (IsHex || IsDebug)) {
+        std::fprintf(stderr, "Load address applies to raw binaries only: %s\n", Spec.c_str());
+        return false;
+    }
+
+    if(IsDebug)
+        return LoadDebugInfo(FileName.c_str(), File);
+    if(IsHex)
+        return LoadHex(FileName.c_str(), File);
+    return LoadBinary(FileName.c_str(), File, HasAddr, Addr);
+}
+
+bool Loader::LoadBinary(const char* FileName, const MappedFile& File, const bool HasAddr, const U16 Addr)
+{
+    if(File.Size() == 0 || File.Size() > MEMSIZE) {
+        std::fprintf(stderr, "Invalid binary file size (%lu bytes): %s\n", (unsigned long)File.Size(), FileName);
+        return false;
+    }
+
+    // Partial images without load address hold the top of memory with vectors
+    const U32 Start = HasAddr ? Addr : U32(MEMSIZE - File.Size());
+    if(!Place(FileName, File.Data(), Start, File.Size()))
+        return false;
+
+    std::printf("Loaded %s at address $%04x (%lu bytes)\n", FileName, Start, (unsigned long)File.Size());
+    return true;
+}
+
+bool Loader::LoadHex(const char* FileName, const MappedFile& File)
+{
+    const size_t FirstSegment = Segments.size();
+
+    U32  Base  = 0;
+    U32  Total = 0;
+    U32  LineNo = 0;
+    bool Valid = true;
+    bool Ended = false;
+    std::vector<U8> Record;
+
+    ForEachLine(File, [&](const std::string& Line) {
+        LineNo++;
+        if(!Valid || Ended || Line.empty())
+            return;
+
+        Record.clear();
+        bool Ok = Line[0] == ':' && (Line.size() % 2) == 1;
+        for(size_t i=1; Ok && i+1<Line.size(); i+=2) {
+            const int Hi = HexDigit(Line[i]);
+            const int Lo = HexDigit(Line[i+1]);
+            Ok = Hi >= 0 && Lo >= 0;
+            Record.push_back(U8(Hi << 4 | Lo));
+        }
+        U8 Sum = 0;
+        for(const U8 Byte : Record) {
+            Sum += Byte;
+        }
+        // Extended address records carry exactly two bytes
+        const bool Extended = Record.size() >= 5 && (Record[3] == 0x02 || Record[3] == 0x04);
+        if(!Ok || Record.size() < 5 || Record.size() != size_t(Record[0]) + 5 || Sum != 0 || (Extended && Record[0] != 2)) {
+            std::fprintf(stderr, "Invalid Intel HEX record at line %u: %s\n", LineNo, FileName);
+            Valid = false;
+            return;
+        }
+
+        const U8  Count  = Record[0];
+        const U32 Offset = U32(Record[1]) << 8 | Record[2];
+        const U8* Data   = &Record[4];
+        switch(Record[3]) {
+        case 0x00:
+            Valid = Place(FileName, Data, Base + Offset, Count);
+            Total += Count;
+            break;
+        case 0x01:
+            Ended = true;
+            break;
+        case 0x02:
+            Base = (U32(Data[0]) << 8 | Data[1]) << 4;
+            break;
+        case 0x04:
+            Base = (U32(Data[0]) << 8 | Data[1]) << 16;
+            break;
+        default:
+            // Start address records do not apply, CPU starts at RESET vector
+            break;
+        }
+    });
+
+    if(!Valid)
+        return false;
+    std::printf("Loaded %s (%u bytes in %lu ranges)\n", FileName, Total, (unsigned long)(Segments.size() - FirstSegment));
+    return true;
+}
+
+bool Loader::LoadDebugInfo(const char* FileName, const MappedFile& File)
+{
+    struct OutputSegment {
+        std::string Name;
+        std::string Output;
+        long        Start;
+        long        Size;
+        long        Offset;
+    };
+    std::vector<OutputSegment> Described;
+
+    const size_t NumSymbols = Symbols.Size();
+    std::string Type;
+    DebugRecord Attributes;
+    ForEachLine(File, [&](const std::string& Line) {
+        if(!ParseDebugRecord(Line, Type, Attributes))
+            return;
+        if(Type == "sym")
+            AddSymbol(Symbols, Attributes);
+        if(Type != "seg" || !Attributes.count("oname"))
+            return;
+        const OutputSegment Seg = { Attributes["name"], Attributes["oname"],
+            DebugAttribute(Attributes, "start"), DebugAttribute(Attributes, "size", 0), DebugAttribute(Attributes, "ooffs", 0) };
+        if(Seg.Size > 0)
+            Described.push_back(Seg);
+    });
+    if(Described.empty()) {
+        std::fprintf(stderr, "No segments in debug file: %s\n", FileName);
+        return false;
+    }
+
+    // Output file names are relative to directory ld65 was run from
+    const std::string BaseDir = DirectoryOf(FileName);
+
+    std::map<std::string, std::unique_ptr<MappedFile>> Outputs;
+    U32 Total = 0;
+    for(const OutputSegment& Seg : Described) {
+        std::unique_ptr<MappedFile>& Output = Outputs[Seg.Output];
+        if(!Output) {
+            Output.reset(new MappedFile);
+            std::string Path = Seg.Output;
+            if(Path[0] != '/' && Path.find(':') == std::string::npos)
+                Path = BaseDir + Path;
+            if(!Output->Open(Path.c_str())) {
+                std::fprintf(stderr, "Could not open output file of debug file %s: %s\n", FileName, Path.c_str());
+                return false;
+            }
+        }
+        if(Seg.Start < 0 || Seg.Offset < 0 || size_t(Seg.Offset + Seg.Size) > Output->Size()) {
+            std::fprintf(stderr, "Segment %s is outside of output file %s\n", Seg.Name.c_str(), Seg.Output.c_str());
+            return false;
+        }
+        if(!Place(Seg.Name.c_str(), Output->Data() + Seg.Offset, U32(Seg.Start), size_t(Seg.Size)))
+            return false;
+        Total += U32(Seg.Size);
+    }
+
+    std::printf("Loaded %s (%u bytes in %lu segments, %lu symbols)\n", FileName, Total, (unsigned long)Described.size(),
+                (unsigned long)(Symbols.Size() - NumSymbols));
+    return true;
+}
+
+bool Loader::Place(const char* Name, const U8* Data, const U32 Addr, const size_t Size)
+{
+    if(Addr + Size > MEMSIZE) {
+        std::fprintf(stderr, "%s does not fit in memory at address $%04x (%lu bytes)\n", Name, Addr, (unsigned long)Size);
+        return false;
+    }
+    std::memcpy(&Memory[Addr], Data, Size);
+
+    // Consecutive records of a file form a single range
+    if(!Segments.empty() && Segments.back().Name == Name && Segments.back().Start + Segments.back().Size == Addr)
+        Segments.back().Size += U32(Size);
+    else
+        Segments.push_back({ U16(Addr), U32(Size), Name });
+    return true;
+}
+
+bool Loader::ParseAddress(const std::string& Text, U16& Addr) const
+{
+    if(Symbols.Find(Text, Addr))
+        return true;
+
+    size_t Start = 0;
+    if(Text.compare(0, 1, "$") == 0)
+        Start = 1;
+    else if(Text.compare(0, 2, "0x") == 0 || Text.compare(0, 2, "0X") == 0)
+        Start = 2;
+    if(Start >= Text.size())
+        return false;
+
+    char* End;
+    const unsigned long Value = std::strtoul(Text.c_str() + Start, &End, 16);
+    if(*End != '\0' || Value >= MEMSIZE)
+        return false;
+    Addr = U16(Value);
+    return true;
+}
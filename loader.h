@@ -0,0 +1,113 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "common.h"
+
+// View of a whole file, memory mapped where the host supports it.
+// Writable views are always mapped and shared with the file, the host
+// writes modified pages back when it sees fit and at the latest when closed.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool Open(const char* FileName, const bool Writable=false);
+    void Close();
+
+    const U8* Data() const { return Bytes; }
+    size_t    Size() const { return Length; }
+    // Null unless opened writable
+    U8* WritableData() const { return Shared ? Bytes : nullptr; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    U8*       Bytes;
+    size_t    Length;
+    bool      Shared;
+    // Used instead of a mapping for empty files or where mapping fails
+    std::vector<U8> Buffer;
+#ifdef _WIN32
+    void* FileHandle;
+    void* MappingHandle;
+#else
+    bool  Mapped;
+#endif
+};
+
+// Addresses of labels from ld65 label files (-Ln) or debug files (--dbgfile)
+class SymbolTable
+{
+public:
+    bool Load(const char* FileName);
+
+    bool Find(const std::string& Name, U16& Addr) const;
+    // Label at address, null if there is none
+    const std::string* Name(const U16 Addr) const;
+
+    size_t Size() const { return ByName.size(); }
+
+    void Add(const std::string& Name, const U16 Addr);
+
+private:
+    std::map<std::string, U16> ByName;
+    std::map<U16, std::string> ByAddr;
+};
+
+// Record of ld65 debug file (--dbgfile): type followed by key=value attributes
+typedef std::map<std::string, std::string> DebugRecord;
+
+// Splits debug file line into record type & attributes, false if it is not a record
+bool ParseDebugRecord(const std::string& Line, std::string& Type, DebugRecord& Attributes);
+// Numeric attribute, decimal or 0x prefixed hex, Default if missing
+long DebugAttribute(const DebugRecord& Attributes, const char* Key, const long Default=-1);
+// Directory part of path with trailing separator, debug files name paths relative to it
+std::string DirectoryOf(const std::string& Path);
+
+// Builds initial memory image from program files, later files overlay earlier ones.
+// Raw binaries go to their load address: a 64kB image to $0000, a shorter one by
+// default so that it ends at $FFFF. Intel HEX files and ld65 programs described by
+// their debug file carry their own addresses; debug files also provide symbols.
+// Files are copied once, straight from the mapping into emulated memory.
+class Loader
+{
+public:
+    Loader(U8* InMemory);
+
+    // Loads "file" or "file@address", address is hex ($ prefix optional) or a known symbol.
+    // Prints reason and returns false on failure.
+    bool Load(const std::string& Spec);
+    bool LoadSymbols(const char* FileName);
+
+    struct Segment {
+        U16         Start;
+        U32         Size;
+        std::string Name;
+    };
+
+    // Memory ranges written so far, in load order
+    std::vector<Segment> Segments;
+    SymbolTable Symbols;
+
+private:
+    bool LoadBinary(const char* FileName, const MappedFile& File, const bool HasAddr, const U16 Addr);
+    bool LoadHex(const char* FileName, const MappedFile& File);
+    bool LoadDebugInfo(const char* FileName, const MappedFile& File);
+
+    bool Place(const char* Name, const U8* Data, const U32 Addr, const size_t Size);
+    bool ParseAddress(const std::string& Text, U16& Addr) const;
+
+    U8* Memory;
+};
+
+#endif // LOADER_H
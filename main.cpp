@@ -4,72 +4,443 @@
  */
 
 #include <cstring>
+#include <cstdlib>
+#include <algorithm>
 #include <fstream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <csignal>
 #include "cpu.h"
+#include "loader.h"
+#include "sdlhost.h"
+#include "wavefile.h"
+#include "terminal.h"
+#include "gdbstub.h"
 
-int main(int argc, char** argv)
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static void PrintBanner()
 {
     std::printf("BENDER-I Computer Emulator\n");
     std::printf("(c) 2015 Michal Siejak <michal@siejak.pl>\n\n");
+}
+
+// Set by SIGUSR1 to dump instruction trace
+static volatile std::sig_atomic_t TraceRequested = 0;
+
+static void RequestTrace(int)
+{
+    TraceRequested = 1;
+}
+
+static bool ReadTextFile(const char* FileName, std::string& Text)
+{
+    std::ifstream File(FileName, std::ios::binary);
+    if(!File) {
+        std::fprintf(stderr, "Could not open file: %s\n", FileName);
+        return false;
+    }
+    std::stringstream Stream;
+    Stream << File.rdbuf();
+    Text = Stream.str();
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Config Settings;
+    bool Headless    = false;
+    bool UseTerminal = false;
+    bool UseSerial   = false;
+    bool ShowStats   = false;
+    double TimeLimit = 0.0;
+    const char* RomFileName = "rom.bin";
+    const char* PasteFileName = nullptr;
+    const char* KeysFileName  = nullptr;
+    const char* WaveFileName  = nullptr;
+    const char* SerialInName  = nullptr;
+    const char* SerialOutName = nullptr;
+    const char* GdbAddress    = nullptr;
+    const char* CoverageName  = nullptr;
+    const char* TimelineName  = nullptr;
+    U32 TraceSize = 1 << 20;
+    std::vector<std::string> Overlays;
+    std::vector<const char*> SymbolNames;
+    SampleFormat AudioFormat  = SampleFormat::S16;
 
-    if(argc >= 2 && (std::strcmp(argv[1], "-h") == 0 ||
-                     std::strcmp(argv[1], "--help") == 0)) {
-        std::printf("Usage: %s [romfile]\n", argv[0]);
-        return 0;
+    for(int i=1; i<argc; i++) {
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+            PrintBanner();
+            std::printf("Usage: %s [options] [romfile[@address]]\n\n", argv[0]);
+            std::printf("Options:\n");
+            std::printf("  -t, --terminal         Display text screen in ANSI terminal instead of SDL window\n");
+            std::printf("  --headless             Run without display\n");
+            std::printf("  --turbo                Run as fast as possible instead of real time\n");
+            std::printf("  --time <seconds>       Quit after given amount of emulated time\n");
+            std::printf("  --stats                Print emulation speed statistics at exit\n");
+            std::printf("  --threads              Render video and synthesize audio on separate threads\n");
+            std::printf("  --audio-rate <hz>      Host audio sample rate (default: 44100)\n");
+            std::printf("  --audio-format <fmt>   Host audio sample format: u8, s16, f32 (default: s16)\n");
+            std::printf("  --wav <file>           Render audio to WAV file instead of audio device\n");
+            std::printf("  --65c02                Emulate 65C02 instruction set\n");
+            std::printf("  --exact-timing         Charge exact 6502 instruction cycle counts (always on with --65c02)\n");
+            std::printf("  --no-dma               Run without DMA controller\n");
+            std::printf("  --no-timer             Run without interval timer\n");
+            std::printf("  --no-debug-port        Run without single-step port, System Monitor traces in software\n");
+            std::printf("  --storage <dir>        Attach storage device backed by host directory\n");
+            std::printf("  --expansion <file>     Attach bank-switched memory expansion backed by host file\n");
+            std::printf("  --serial               Attach serial console to standard input & output, quit when input ends\n");
+            std::printf("  --serial-in <file>     Read serial console input from file instead of standard input\n");
+            std::printf("  --serial-out <file>    Write serial console output to file instead of standard output\n");
+            std::printf("  --hle                  Execute BIOS text output routines natively\n");
+            std::printf("  --hle-basic            Execute Tiny BASIC IL interpreter natively\n");
+            std::printf("  --hle-verify           Check native routines against ROM code\n");
+            std::printf("  --hle-cycles <n>       Cycles charged for native routine call (default: 40)\n");
+            std::printf("  --gdb <port|path>      Stop at reset and serve GDB remote protocol on local TCP port or socket\n");
+            std::printf("  --profile-basic        Report cycles spent in Tiny BASIC program lines at exit\n");
+            std::printf("  --coverage <file>      Record executed instructions & branches, merge into coverage file at exit\n");
+            std::printf("  --trace <file>         Keep instruction trace in memory, dump it on illegal opcode, BRK, watchpoint,\n");
+            std::printf("                         SIGUSR1 or at exit\n");
+            std::printf("  --trace-size <n>       Number of instructions kept by --trace (default: 1048576)\n");
+            std::printf("  --trace-stream <file>  Write every executed instruction to compressed trace file\n");
+            std::printf("  --timeline <file>      Write Chrome trace JSON of interrupts, frames, audio blocks and sleeps\n");
+            std::printf("  --load <file[@addr]>   Load program over ROM: raw binary at address or symbol, Intel HEX (.hex)\n");
+            std::printf("                         or ld65 debug file (segments of its output and symbols)\n");
+            std::printf("  --symbols <file>       Read symbols for load addresses from ld65 label or debug file\n");
+            std::printf("  --paste <file>         Type contents of text file on keyboard\n");
+            std::printf("  --keys <file>          Type key script ({CR}, {F1}, {$hh}, ...) on keyboard\n");
+            return 0;
+        }
+        else if(std::strcmp(argv[i], "-t") == 0 || std::strcmp(argv[i], "--terminal") == 0) {
+            UseTerminal = true;
+            Headless    = true;
+        }
+        else if(std::strcmp(argv[i], "--headless") == 0) {
+            Headless = true;
+        }
+        else if(std::strcmp(argv[i], "--turbo") == 0) {
+            Settings.Turbo = true;
+        }
+        else if(std::strcmp(argv[i], "--time") == 0 && i+1 < argc) {
+            TimeLimit = std::atof(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--stats") == 0) {
+            ShowStats = true;
+        }
+        else if(std::strcmp(argv[i], "--threads") == 0) {
+            Settings.Threads = true;
+        }
+        else if(std::strcmp(argv[i], "--audio-rate") == 0 && i+1 < argc) {
+            Settings.AudioRate = std::max(std::atoi(argv[++i]), 8000);
+        }
+        else if(std::strcmp(argv[i], "--audio-format") == 0 && i+1 < argc) {
+            const char* Format = argv[++i];
+            if(std::strcmp(Format, "u8") == 0)
+                AudioFormat = SampleFormat::U8;
+            else if(std::strcmp(Format, "s16") == 0)
+                AudioFormat = SampleFormat::S16;
+            else if(std::strcmp(Format, "f32") == 0)
+                AudioFormat = SampleFormat::F32;
+            else {
+                std::fprintf(stderr, "Unknown audio format: %s\n", Format);
+                return 1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--wav") == 0 && i+1 < argc) {
+            WaveFileName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--65c02") == 0) {
+            Settings.CMOS = true;
+        }
+        else if(std::strcmp(argv[i], "--exact-timing") == 0) {
+            Settings.ExactTiming = true;
+        }
+        else if(std::strcmp(argv[i], "--no-dma") == 0) {
+            Settings.DMA = false;
+        }
+        else if(std::strcmp(argv[i], "--no-timer") == 0) {
+            Settings.Timer = false;
+        }
+        else if(std::strcmp(argv[i], "--no-debug-port") == 0) {
+            Settings.DebugPort = false;
+        }
+        else if(std::strcmp(argv[i], "--storage") == 0 && i+1 < argc) {
+            Settings.StorageDir = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--expansion") == 0 && i+1 < argc) {
+            Settings.ExpansionFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--serial") == 0) {
+            UseSerial = true;
+        }
+        else if(std::strcmp(argv[i], "--serial-in") == 0 && i+1 < argc) {
+            UseSerial    = true;
+            SerialInName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--serial-out") == 0 && i+1 < argc) {
+            UseSerial     = true;
+            SerialOutName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--hle") == 0) {
+            Settings.HLE = true;
+        }
+        else if(std::strcmp(argv[i], "--hle-basic") == 0) {
+            Settings.HLEBasic = true;
+        }
+        else if(std::strcmp(argv[i], "--hle-verify") == 0) {
+            Settings.HLEVerify = true;
+        }
+        else if(std::strcmp(argv[i], "--hle-cycles") == 0 && i+1 < argc) {
+            Settings.HLECycles = std::max(std::atoi(argv[++i]), 0);
+        }
+        else if(std::strcmp(argv[i], "--gdb") == 0 && i+1 < argc) {
+            GdbAddress = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--profile-basic") == 0) {
+            Settings.ProfileBasic = true;
+        }
+        else if(std::strcmp(argv[i], "--coverage") == 0 && i+1 < argc) {
+            Settings.Coverage = true;
+            CoverageName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--trace") == 0 && i+1 < argc) {
+            Settings.TraceFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--trace-size") == 0 && i+1 < argc) {
+            TraceSize = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if(std::strcmp(argv[i], "--trace-stream") == 0 && i+1 < argc) {
+            Settings.TraceStream = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--timeline") == 0 && i+1 < argc) {
+            Settings.Timeline = true;
+            TimelineName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--load") == 0 && i+1 < argc) {
+            Overlays.push_back(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--symbols") == 0 && i+1 < argc) {
+            SymbolNames.push_back(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--paste") == 0 && i+1 < argc) {
+            PasteFileName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--keys") == 0 && i+1 < argc) {
+            KeysFileName = argv[++i];
+        }
+        else {
+            RomFileName = argv[i];
+        }
     }
 
+    if(!Settings.TraceFile.empty() || !Settings.TraceStream.empty()) {
+        Settings.TraceSize = TraceSize;
+    }
+
+    std::FILE* SerialIn  = nullptr;
+    std::FILE* SerialOut = nullptr;
+    if(UseSerial) {
+        if(UseTerminal && (!SerialInName || !SerialOutName)) {
+            std::fprintf(stderr, "Terminal cannot share standard input & output with serial console\n");
+            return 1;
+        }
+        SerialIn  = SerialInName  ? std::fopen(SerialInName,  "rb") : stdin;
+        SerialOut = SerialOutName ? std::fopen(SerialOutName, "wb") : stdout;
+        if(!SerialIn || !SerialOut) {
+            std::fprintf(stderr, "Could not open serial console file: %s\n", SerialIn ? SerialOutName : SerialInName);
+            return 2;
+        }
+        if(SerialOut == stdout) {
+            // Standard output belongs to the guest, emulator messages go to standard error
+            SerialOut = fdopen(dup(fileno(stdout)), "wb");
+            dup2(fileno(stderr), fileno(stdout));
+        }
+    }
+
+    PrintBanner();
+
     if(SDL_Init(SDL_INIT_EVENTS) < 0) {
         std::fprintf(stderr, "Cannot initialize SDL!\n");
         return 1;
     }
 
+    // SDL window & audio device are backends of emulator core
+    SDLVideo*   Video  = nullptr;
+    SDLAudio*   Audio  = nullptr;
+    StreamLink* Serial = nullptr;
+    WaveFile    WaveSink;
+    Host        Backends;
+
     CPU* TheCPU;
     {
-        const char* RomFileName = argc >= 2 ? argv[1] : "rom.bin";
+        try {
+            if(!Headless) {
+                Backends.Video = Video = new SDLVideo(VPU::ScreenWidth, VPU::ScreenHeight);
+            }
+            if(WaveFileName) {
+                if(!WaveSink.Open(WaveFileName, Settings.AudioRate, AudioFormat)) {
+                    throw Device::Error("Could not open WAV file");
+                }
+                Backends.Audio = &WaveSink;
+            }
+            else if(!Headless) {
+                Backends.Audio = Audio = new SDLAudio(Settings.AudioRate, AudioFormat);
+            }
+            if(UseSerial) {
+                Backends.Serial = Serial = new StreamLink(SerialIn, SerialOut);
+            }
+            TheCPU = new CPU(CPUFREQ, VIDEOHZ, Settings, Backends, nullptr, 0, 0);
+            std::printf("CPU is %s compatible running at %d cycles per second\n", TheCPU->Settings.CMOS ? "65C02" : "6502", TheCPU->Frequency);
+            std::printf("Target video refresh rate is %dHz, jiffy is %d cycles\n", VIDEOHZ, TheCPU->JiffyCycles());
+        }
+        catch(const Device::Error& Error) {
+            std::fprintf(stderr, "Error: %s\n", Error.what());
+            return 4;
+        }
 
-        std::ifstream RomFile(RomFileName, std::ios::binary);
-        if(!RomFile) {
-            std::fprintf(stderr, "Could not open rom file: %s\n", RomFileName);
-            return 2;
+        // Files are mapped and copied straight into emulated memory
+        Loader Image(TheCPU->RAM.Memory);
+        for(const char* Name : SymbolNames) {
+            if(!Image.LoadSymbols(Name))
+                return 2;
         }
+        if(!Image.Load(RomFileName))
+            return 3;
+        for(const std::string& Spec : Overlays) {
+            if(!Image.Load(Spec))
+                return 3;
+        }
+        TheCPU->Reset();
+    }
 
-        char Buffer[MEMSIZE];
-        RomFile.read(Buffer, MEMSIZE);
-        if(!RomFile) {
-            std::fprintf(stderr, "Invalid rom file: %s\n", RomFileName);
+    if(PasteFileName) {
+        std::string Text;
+        if(!ReadTextFile(PasteFileName, Text))
+            return 2;
+        TheCPU->Kbd.InjectText(Text);
+    }
+    if(KeysFileName) {
+        std::string Script;
+        if(!ReadTextFile(KeysFileName, Script))
+            return 2;
+        if(!TheCPU->Kbd.InjectScript(Script)) {
+            std::fprintf(stderr, "Invalid key script: %s\n", KeysFileName);
             return 3;
         }
+    }
 
+    GdbStub* Stub = nullptr;
+    if(GdbAddress) {
         try {
-            TheCPU = new CPU(CPUFREQ, VIDEOHZ, Buffer, 0, sizeof(Buffer));
+            Stub = new GdbStub(TheCPU->Debug, GdbAddress);
         }
         catch(const Device::Error& Error) {
             std::fprintf(stderr, "Error: %s\n", Error.what());
             return 4;
         }
+        // Nothing runs until debugger says so
+        TheCPU->Debug.Halt();
     }
 
+    Terminal* Term = UseTerminal ? new Terminal(TheCPU) : nullptr;
+    U32 LastFrame  = 0;
+
+    const U64 CycleLimit = TimeLimit * TheCPU->Frequency;
+
+    // Host input is polled once per video frame instead of every instruction,
+    // which bounds input latency to a single frame (20 ms at 50 Hz).
+    const U64 InputInterval = TheCPU->Frequency / TheCPU->VideoHz;
+    U64 NextInputPoll = 0;
+
+#ifdef SIGUSR1
+    if(TheCPU->Trace.Enabled) {
+        std::signal(SIGUSR1, RequestTrace);
+    }
+#endif
+
+    const auto StartTime = std::chrono::steady_clock::now();
+
     bool ShouldQuit = false;
     do {
-        SDL_Event event;
-        while(SDL_PollEvent(&event)) {
-            switch(event.type)
-            {
-            case SDL_KEYDOWN:
-            case SDL_KEYUP:
-                TheCPU->Kbd.TranslateEvent(event.key);
-                break;
-            case SDL_QUIT:
+        // Stopped CPU does not advance, input is polled on every tick instead
+        const bool Halted = TheCPU->Debug.Halted();
+        if(Halted || TheCPU->TotalCycles >= NextInputPoll) {
+            NextInputPoll = TheCPU->TotalCycles + InputInterval;
+
+            SDL_Event event;
+            while(SDL_PollEvent(&event)) {
+                switch(event.type)
+                {
+                case SDL_KEYDOWN:
+                case SDL_KEYUP:
+                    SDLKeyEvent(TheCPU->Kbd, event.key);
+                    break;
+                case SDL_QUIT:
+                    ShouldQuit = true;
+                    break;
+                }
+            }
+
+            if(CycleLimit > 0 && TheCPU->TotalCycles >= CycleLimit) {
+                ShouldQuit = true;
+            }
+            // Serial console input is a job for the guest, quit when it is done
+            if(Serial && TheCPU->Uart.Drained()) {
+                ShouldQuit = true;
+            }
+            if(TraceRequested) {
+                TraceRequested = 0;
+                TheCPU->Trace.Dump(Tracer::TriggerRequest);
+            }
+            // Debugger waits for requests only while CPU is stopped
+            if(Stub && !Stub->Update(Halted ? 10 : 0)) {
                 ShouldQuit = true;
-                break;
             }
         }
 
         TheCPU->Tick();
 
+        if(Term && TheCPU->Video.Frame != LastFrame) {
+            LastFrame = TheCPU->Video.Frame;
+            Term->Update();
+        }
+
     } while(!ShouldQuit);
 
+    delete Term;
+    delete Stub;
+
+    if(ShowStats) {
+        const double WallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+        const double EmuTime  = double(TheCPU->TotalCycles) / TheCPU->Frequency;
+        std::printf("Executed %llu instructions (%llu cycles) in %.3f s\n",
+                    (unsigned long long)TheCPU->TotalInstructions, (unsigned long long)TheCPU->TotalCycles, WallTime);
+        std::printf("Emulated %.3f s at %.2f MIPS (%.1fx real time), CPU idle %.1f%%\n",
+                    EmuTime, TheCPU->TotalInstructions / WallTime / 1e6, EmuTime / WallTime,
+                    100.0 * TheCPU->IdleCycles / std::max(TheCPU->TotalCycles, U64(1)));
+    }
+
+    if(CoverageName) {
+        // Coverage of previous runs is kept
+        TheCPU->Cover.Load(CoverageName);
+        if(!TheCPU->Cover.Save(CoverageName)) {
+            std::fprintf(stderr, "Could not write coverage file: %s\n", CoverageName);
+        }
+    }
+
+    if(TimelineName && !TheCPU->Events.Save(TimelineName, TheCPU->Frequency)) {
+        std::fprintf(stderr, "Could not write timeline file: %s\n", TimelineName);
+    }
+
     delete TheCPU;
+    delete Serial;
+    delete Audio;
+    delete Video;
     SDL_Quit();
     return 0;
 }
@@ -14,6 +14,72 @@ MCC::MCC()
     std::memset(Memory, 0, sizeof(Memory));
     ReadCallback.fill(std::bind(&MCC::PassthroughRegisterRead, this, _1));
     WriteCallback.fill(std::bind(&MCC::PassthroughRegisterWrite, this, _1, _2));
+
+    Pages.fill(0);
+    Pages[0xFD] = PageIO;
+    Banks.fill(nullptr);
+}
+
+U8 MCC::ReadPage(const U16 Addr)
+{
+    const U8 Flags = Pages[Addr >> 8];
+    if(Flags & PageWatch)
+        WatchCallback(Addr, false);
+
+    if(Flags & PageIO)
+        return ReadRegister(Addr & 0xFF);
+    else if(Flags & PageBank)
+        return Banks[Addr >> 8] ? Banks[Addr >> 8][Addr & 0xFF] : 0xFF;
+    else
+        return Memory[Addr];
+}
+
+void MCC::WritePage(const U16 Addr, const U8 Value)
+{
+    const U8 Flags = Pages[Addr >> 8];
+    if(Flags & PageWatch)
+        WatchCallback(Addr, true);
+
+    if(Flags & PageIO)
+        WriteRegister(Addr & 0xFF, Value);
+    else if(Flags & PageBank) {
+        if(!(Flags & PageReadOnly))
+            Banks[Addr >> 8][Addr & 0xFF] = Value;
+    }
+    else
+        Memory[Addr] = Value;
+}
+
+void MCC::WatchPage(const U8 Page, const bool Watch)
+{
+    if(Watch)
+        Pages[Page] |= PageWatch;
+    else
+        Pages[Page] &= ~PageWatch;
+}
+
+void MCC::MapBank(const U8 Page, U8* Base, const bool Writable)
+{
+    Banks[Page] = Base;
+    Pages[Page] |= PageBank;
+    if(Base && Writable)
+        Pages[Page] &= ~PageReadOnly;
+    else
+        Pages[Page] |= PageReadOnly;
+}
+
+void MCC::UnmapBank(const U8 Page)
+{
+    Banks[Page] = nullptr;
+    Pages[Page] &= ~(PageBank | PageReadOnly);
+}
+
+void MCC::MapRegisters(const bool Map)
+{
+    if(Map)
+        Pages[0xFD] |= PageIO;
+    else
+        Pages[0xFD] &= ~PageIO;
 }
 
 U8 MCC::ReadRegister(const U8 Reg)
@@ -16,25 +16,74 @@ class MCC
 public:
     MCC();
 
+    // Page attributes, plain memory pages have none
+    enum PageFlags {
+        PageIO       = 0x01,
+        PageWatch    = 0x02,
+        PageBank     = 0x04,
+        PageReadOnly = 0x08,
+    };
+
     inline U8 Read(const U16 Addr)
     {
-        if((Addr >> 8) == 0xFD)
-            return ReadRegister(Addr & 0xFF);
+        if(Pages[Addr >> 8])
+            return ReadPage(Addr);
         else
             return Memory[Addr];
     }
     inline void Write(const U16 Addr, const U8 Value)
     {
-        if((Addr >> 8) == 0xFD)
-            WriteRegister(Addr & 0xFF, Value);
+        if(Pages[Addr >> 8])
+            WritePage(Addr, Value);
         else
             Memory[Addr] = Value;
     }
     inline U8 operator[](const U16 Addr) { return Read(Addr); }
 
+    // Access without side effects for native routines & host tools: follows banks,
+    // but I/O page accesses underlying memory and watchpoints are not reported
+    inline U8 Peek(const U16 Addr) const
+    {
+        if(!(Pages[Addr >> 8] & PageBank))
+            return Memory[Addr];
+        const U8* Base = Banks[Addr >> 8];
+        return Base ? Base[Addr & 0xFF] : 0xFF;
+    }
+    inline void Poke(const U16 Addr, const U8 Value)
+    {
+        const U8 Flags = Pages[Addr >> 8];
+        if(!(Flags & PageBank))
+            Memory[Addr] = Value;
+        else if(!(Flags & PageReadOnly))
+            Banks[Addr >> 8][Addr & 0xFF] = Value;
+    }
+
     U8   ReadRegister(const U8 Reg);
     void WriteRegister(const U8 Reg, const U8 Value);
 
+    // Reports CPU accesses to page through watch callback
+    void WatchPage(const U8 Page, const bool Watch);
+    // Device registers occupy page $FD unless unmapped for flat memory tests
+    void MapRegisters(const bool Map);
+
+    // Page accesses host memory instead of RAM, null base reads $FF & ignores writes
+    void MapBank(const U8 Page, U8* Base, const bool Writable);
+    // RAM is visible again at page
+    void UnmapBank(const U8 Page);
+
+    // True if [Addr, Addr+Count) neither wraps around nor touches MMIO, watched or banked pages
+    bool IsPlainMemory(const U16 Addr, const U32 Count) const
+    {
+        const U32 End = U32(Addr) + Count;
+        if(End > MEMSIZE)
+            return false;
+        for(U32 Page=Addr >> 8; Page<(End+0xFF) >> 8; Page++) {
+            if(Pages[Page] & (PageIO | PageWatch | PageBank))
+                return false;
+        }
+        return true;
+    }
+
     template<class T>
     void AllocRegister(const U8 Reg, T* Device, U8 (T::*ReadFunc)(U8), void (T::*WriteFunc)(U8, U8))
     {
@@ -49,9 +98,17 @@ public:
     // Memory-mapped IO callbacks
     std::array<std::function<U8(U8)>, 256>      ReadCallback;
     std::array<std::function<void(U8,U8)>, 256> WriteCallback;
+    // Called with address and write flag on access to watched page
+    std::function<void(U16,bool)>               WatchCallback;
 private:
+    U8   ReadPage(const U16 Addr);
+    void WritePage(const U16 Addr, const U8 Value);
+
     U8   PassthroughRegisterRead(U8 Reg);
     void PassthroughRegisterWrite(U8 Reg, U8 Data);
+
+    std::array<U8, 256> Pages;
+    std::array<U8*, 256> Banks;
 };
 
 #endif // MCC_H
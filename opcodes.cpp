@@ -0,0 +1,180 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "opcodes.h"
+
+namespace {
+    // Undefined opcodes are named ???, 65C02 opcodes are given separately
+    // with WDC bit instructions and its undefined opcodes decoded as NOPs
+    const char* MnemonicsNMOS[256] = {
+        "BRK", "ORA", "???", "???", "???", "ORA", "ASL", "???", "PHP", "ORA", "ASL", "???", "???", "ORA", "ASL", "???", // 0x
+        "BPL", "ORA", "???", "???", "???", "ORA", "ASL", "???", "CLC", "ORA", "???", "???", "???", "ORA", "ASL", "???", // 1x
+        "JSR", "AND", "???", "???", "BIT", "AND", "ROL", "???", "PLP", "AND", "ROL", "???", "BIT", "AND", "ROL", "???", // 2x
+        "BMI", "AND", "???", "???", "???", "AND", "ROL", "???", "SEC", "AND", "???", "???", "???", "AND", "ROL", "???", // 3x
+        "RTI", "EOR", "???", "???", "???", "EOR", "LSR", "???", "PHA", "EOR", "LSR", "???", "JMP", "EOR", "LSR", "???", // 4x
+        "BVC", "EOR", "???", "???", "???", "EOR", "LSR", "???", "CLI", "EOR", "???", "???", "???", "EOR", "LSR", "???", // 5x
+        "RTS", "ADC", "???", "???", "???", "ADC", "ROR", "???", "PLA", "ADC", "ROR", "???", "JMP", "ADC", "ROR", "???", // 6x
+        "BVS", "ADC", "???", "???", "???", "ADC", "ROR", "???", "SEI", "ADC", "???", "???", "???", "ADC", "ROR", "???", // 7x
+        "???", "STA", "???", "???", "STY", "STA", "STX", "???", "DEY", "???", "TXA", "???", "STY", "STA", "STX", "???", // 8x
+        "BCC", "STA", "???", "???", "STY", "STA", "STX", "???", "TYA", "STA", "TXS", "???", "???", "STA", "???", "???", // 9x
+        "LDY", "LDA", "LDX", "???", "LDY", "LDA", "LDX", "???", "TAY", "LDA", "TAX", "???", "LDY", "LDA", "LDX", "???", // Ax
+        "BCS", "LDA", "???", "???", "LDY", "LDA", "LDX", "???", "CLV", "LDA", "TSX", "???", "LDY", "LDA", "LDX", "???", // Bx
+        "CPY", "CMP", "???", "???", "CPY", "CMP", "DEC", "???", "INY", "CMP", "DEX", "WAI", "CPY", "CMP", "DEC", "???", // Cx
+        "BNE", "CMP", "???", "???", "???", "CMP", "DEC", "???", "CLD", "CMP", "???", "???", "???", "CMP", "DEC", "???", // Dx
+        "CPX", "SBC", "???", "???", "CPX", "SBC", "INC", "???", "INX", "SBC", "NOP", "???", "CPX", "SBC", "INC", "???", // Ex
+        "BEQ", "SBC", "???", "???", "???", "SBC", "INC", "???", "SED", "SBC", "???", "???", "???", "SBC", "INC", "???", // Fx
+    };
+    const char* MnemonicsCMOS[256] = {
+        "BRK", "ORA", "NOP", "NOP", "TSB", "ORA", "ASL", "RMB0", "PHP", "ORA", "ASL", "NOP", "TSB", "ORA", "ASL", "BBR0", // 0x
+        "BPL", "ORA", "ORA", "NOP", "TRB", "ORA", "ASL", "RMB1", "CLC", "ORA", "INC", "NOP", "TRB", "ORA", "ASL", "BBR1", // 1x
+        "JSR", "AND", "NOP", "NOP", "BIT", "AND", "ROL", "RMB2", "PLP", "AND", "ROL", "NOP", "BIT", "AND", "ROL", "BBR2", // 2x
+        "BMI", "AND", "AND", "NOP", "BIT", "AND", "ROL", "RMB3", "SEC", "AND", "DEC", "NOP", "BIT", "AND", "ROL", "BBR3", // 3x
+        "RTI", "EOR", "NOP", "NOP", "NOP", "EOR", "LSR", "RMB4", "PHA", "EOR", "LSR", "NOP", "JMP", "EOR", "LSR", "BBR4", // 4x
+        "BVC", "EOR", "EOR", "NOP", "NOP", "EOR", "LSR", "RMB5", "CLI", "EOR", "PHY", "NOP", "NOP", "EOR", "LSR", "BBR5", // 5x
+        "RTS", "ADC", "NOP", "NOP", "STZ", "ADC", "ROR", "RMB6", "PLA", "ADC", "ROR", "NOP", "JMP", "ADC", "ROR", "BBR6", // 6x
+        "BVS", "ADC", "ADC", "NOP", "STZ", "ADC", "ROR", "RMB7", "SEI", "ADC", "PLY", "NOP", "JMP", "ADC", "ROR", "BBR7", // 7x
+        "BRA", "STA", "NOP", "NOP", "STY", "STA", "STX", "SMB0", "DEY", "BIT", "TXA", "NOP", "STY", "STA", "STX", "BBS0", // 8x
+        "BCC", "STA", "STA", "NOP", "STY", "STA", "STX", "SMB1", "TYA", "STA", "TXS", "NOP", "STZ", "STA", "STZ", "BBS1", // 9x
+        "LDY", "LDA", "LDX", "NOP", "LDY", "LDA", "LDX", "SMB2", "TAY", "LDA", "TAX", "NOP", "LDY", "LDA", "LDX", "BBS2", // Ax
+        "BCS", "LDA", "LDA", "NOP", "LDY", "LDA", "LDX", "SMB3", "CLV", "LDA", "TSX", "NOP", "LDY", "LDA", "LDX", "BBS3", // Bx
+        "CPY", "CMP", "NOP", "NOP", "CPY", "CMP", "DEC", "SMB4", "INY", "CMP", "DEX", "WAI", "CPY", "CMP", "DEC", "BBS4", // Cx
+        "BNE", "CMP", "CMP", "NOP", "NOP", "CMP", "DEC", "SMB5", "CLD", "CMP", "PHX", "STP", "NOP", "CMP", "DEC", "BBS5", // Dx
+        "CPX", "SBC", "NOP", "NOP", "CPX", "SBC", "INC", "SMB6", "INX", "SBC", "NOP", "NOP", "CPX", "SBC", "INC", "BBS6", // Ex
+        "BEQ", "SBC", "SBC", "NOP", "NOP", "SBC", "INC", "SMB7", "SED", "SBC", "PLX", "NOP", "NOP", "SBC", "INC", "BBS7", // Fx
+    };
+
+    enum {
+        Imp = OpcodeInfo::Implied,
+        Acc = OpcodeInfo::Accumulator,
+        Imm = OpcodeInfo::Immediate,
+        Zp  = OpcodeInfo::ZeroPage,
+        ZpX = OpcodeInfo::ZeroPageX,
+        ZpY = OpcodeInfo::ZeroPageY,
+        Abs = OpcodeInfo::Absolute,
+        AbX = OpcodeInfo::AbsoluteX,
+        AbY = OpcodeInfo::AbsoluteY,
+        Ind = OpcodeInfo::Indirect,
+        IzX = OpcodeInfo::IndexedX,
+        IzY = OpcodeInfo::IndexedY,
+        Izp = OpcodeInfo::IndirectZP,
+        IaX = OpcodeInfo::IndirectX,
+        Rel = OpcodeInfo::Relative,
+        ZpR = OpcodeInfo::ZeroPageRelative,
+    };
+
+    const U8 ModesNMOS[256] = {
+        Imp, IzX, Imp, Imp, Imp, Zp,  Zp,  Imp, Imp, Imm, Acc, Imp, Imp, Abs, Abs, Imp, // 0x
+        Rel, IzY, Imp, Imp, Imp, ZpX, ZpX, Imp, Imp, AbY, Imp, Imp, Imp, AbX, AbX, Imp, // 1x
+        Abs, IzX, Imp, Imp, Zp,  Zp,  Zp,  Imp, Imp, Imm, Acc, Imp, Abs, Abs, Abs, Imp, // 2x
+        Rel, IzY, Imp, Imp, Imp, ZpX, ZpX, Imp, Imp, AbY, Imp, Imp, Imp, AbX, AbX, Imp, // 3x
+        Imp, IzX, Imp, Imp, Imp, Zp,  Zp,  Imp, Imp, Imm, Acc, Imp, Abs, Abs, Abs, Imp, // 4x
+        Rel, IzY, Imp, Imp, Imp, ZpX, ZpX, Imp, Imp, AbY, Imp, Imp, Imp, AbX, AbX, Imp, // 5x
+        Imp, IzX, Imp, Imp, Imp, Zp,  Zp,  Imp, Imp, Imm, Acc, Imp, Ind, Abs, Abs, Imp, // 6x
+        Rel, IzY, Imp, Imp, Imp, ZpX, ZpX, Imp, Imp, AbY, Imp, Imp, Imp, AbX, AbX, Imp, // 7x
+        Imp, IzX, Imp, Imp, Zp,  Zp,  Zp,  Imp, Imp, Imp, Imp, Imp, Abs, Abs, Abs, Imp, // 8x
+        Rel, IzY, Imp, Imp, ZpX, ZpX, ZpY, Imp, Imp, AbY, Imp, Imp, Imp, AbX, Imp, Imp, // 9x
+        Imm, IzX, Imm, Imp, Zp,  Zp,  Zp,  Imp, Imp, Imm, Imp, Imp, Abs, Abs, Abs, Imp, // Ax
+        Rel, IzY, Imp, Imp, ZpX, ZpX, ZpY, Imp, Imp, AbY, Imp, Imp, AbX, AbX, AbY, Imp, // Bx
+        Imm, IzX, Imp, Imp, Zp,  Zp,  Zp,  Imp, Imp, Imm, Imp, Imp, Abs, Abs, Abs, Imp, // Cx
+        Rel, IzY, Imp, Imp, Imp, ZpX, ZpX, Imp, Imp, AbY, Imp, Imp, Imp, AbX, AbX, Imp, // Dx
+        Imm, IzX, Imp, Imp, Zp,  Zp,  Zp,  Imp, Imp, Imm, Imp, Imp, Abs, Abs, Abs, Imp, // Ex
+        Rel, IzY, Imp, Imp, Imp, ZpX, ZpX, Imp, Imp, AbY, Imp, Imp, Imp, AbX, AbX, Imp, // Fx
+    };
+    const U8 ModesCMOS[256] = {
+        Imp, IzX, Imm, Imp, Zp,  Zp,  Zp,  Zp,  Imp, Imm, Acc, Imp, Abs, Abs, Abs, ZpR, // 0x
+        Rel, IzY, Izp, Imp, Zp,  ZpX, ZpX, Zp,  Imp, AbY, Acc, Imp, Abs, AbX, AbX, ZpR, // 1x
+        Abs, IzX, Imm, Imp, Zp,  Zp,  Zp,  Zp,  Imp, Imm, Acc, Imp, Abs, Abs, Abs, ZpR, // 2x
+        Rel, IzY, Izp, Imp, ZpX, ZpX, ZpX, Zp,  Imp, AbY, Acc, Imp, AbX, AbX, AbX, ZpR, // 3x
+        Imp, IzX, Imm, Imp, Zp,  Zp,  Zp,  Zp,  Imp, Imm, Acc, Imp, Abs, Abs, Abs, ZpR, // 4x
+        Rel, IzY, Izp, Imp, ZpX, ZpX, ZpX, Zp,  Imp, AbY, Imp, Imp, Abs, AbX, AbX, ZpR, // 5x
+        Imp, IzX, Imm, Imp, Zp,  Zp,  Zp,  Zp,  Imp, Imm, Acc, Imp, Ind, Abs, Abs, ZpR, // 6x
+        Rel, IzY, Izp, Imp, ZpX, ZpX, ZpX, Zp,  Imp, AbY, Imp, Imp, IaX, AbX, AbX, ZpR, // 7x
+        Rel, IzX, Imm, Imp, Zp,  Zp,  Zp,  Zp,  Imp, Imm, Imp, Imp, Abs, Abs, Abs, ZpR, // 8x
+        Rel, IzY, Izp, Imp, ZpX, ZpX, ZpY, Zp,  Imp, AbY, Imp, Imp, Abs, AbX, AbX, ZpR, // 9x
+        Imm, IzX, Imm, Imp, Zp,  Zp,  Zp,  Zp,  Imp, Imm, Imp, Imp, Abs, Abs, Abs, ZpR, // Ax
+        Rel, IzY, Izp, Imp, ZpX, ZpX, ZpY, Zp,  Imp, AbY, Imp, Imp, AbX, AbX, AbY, ZpR, // Bx
+        Imm, IzX, Imm, Imp, Zp,  Zp,  Zp,  Zp,  Imp, Imm, Imp, Imp, Abs, Abs, Abs, ZpR, // Cx
+        Rel, IzY, Izp, Imp, ZpX, ZpX, ZpX, Zp,  Imp, AbY, Imp, Imp, Abs, AbX, AbX, ZpR, // Dx
+        Imm, IzX, Imm, Imp, Zp,  Zp,  Zp,  Zp,  Imp, Imm, Imp, Imp, Abs, Abs, Abs, ZpR, // Ex
+        Rel, IzY, Izp, Imp, ZpX, ZpX, ZpX, Zp,  Imp, AbY, Imp, Imp, Abs, AbX, AbX, ZpR, // Fx
+    };
+
+    const U8 ModeLengths[] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 2, 2, 2, 3, 2, 3 };
+
+    U8 AccessOf(const char* Mnemonic, const U8 Mode)
+    {
+        static const char* Stores[]  = { "STA", "STX", "STY", "STZ" };
+        static const char* Modifies[] = { "ASL", "LSR", "ROL", "ROR", "INC", "DEC", "TSB", "TRB" };
+
+        if(Mode == Imp || Mode == Acc || Mode == Imm || Mode == Rel || Mode == Ind || Mode == IaX)
+            return OpcodeInfo::NoAccess;
+        if(std::strcmp(Mnemonic, "JMP") == 0 || std::strcmp(Mnemonic, "JSR") == 0)
+            return OpcodeInfo::NoAccess;
+        for(const char* Store : Stores) {
+            if(std::strcmp(Mnemonic, Store) == 0)
+                return OpcodeInfo::Write;
+        }
+        for(const char* Modify : Modifies) {
+            if(std::strcmp(Mnemonic, Modify) == 0)
+                return OpcodeInfo::Modify;
+        }
+        // RMB0-7 & SMB0-7
+        if(std::strncmp(Mnemonic, "RMB", 3) == 0 || std::strncmp(Mnemonic, "SMB", 3) == 0)
+            return OpcodeInfo::Modify;
+        return OpcodeInfo::Read;
+    }
+
+    struct OpcodeTable
+    {
+        OpcodeTable(const char* const* Mnemonics, const U8* Modes)
+        {
+            for(int i=0; i<256; i++) {
+                OpcodeInfo& Op = Info[i];
+                Op.Mnemonic = Mnemonics[i];
+                Op.Mode     = Modes[i];
+                Op.Access   = AccessOf(Mnemonics[i], Modes[i]);
+                Op.Length   = ModeLengths[Modes[i]];
+                Op.Defined  = std::strcmp(Mnemonics[i], "???") != 0;
+            }
+        }
+        OpcodeInfo Info[256];
+    };
+}
+
+const OpcodeInfo& DecodeOpcode(const U8 OpCode, const bool CMOS)
+{
+    static const OpcodeTable TableNMOS(MnemonicsNMOS, ModesNMOS);
+    static const OpcodeTable TableCMOS(MnemonicsCMOS, ModesCMOS);
+    return (CMOS ? TableCMOS : TableNMOS).Info[OpCode];
+}
+
+std::string Disassemble(const U16 Addr, const U8 OpCode, const U8 Operand1, const U8 Operand2, const bool CMOS)
+{
+    const OpcodeInfo& Op = DecodeOpcode(OpCode, CMOS);
+    const U16 Word = Operand1 | Operand2 << 8;
+
+    char Text[32];
+    switch(Op.Mode) {
+    case Acc: std::snprintf(Text, sizeof(Text), "%s A", Op.Mnemonic); break;
+    case Imm: std::snprintf(Text, sizeof(Text), "%s #$%02X", Op.Mnemonic, Operand1); break;
+    case Zp:  std::snprintf(Text, sizeof(Text), "%s $%02X", Op.Mnemonic, Operand1); break;
+    case ZpX: std::snprintf(Text, sizeof(Text), "%s $%02X,X", Op.Mnemonic, Operand1); break;
+    case ZpY: std::snprintf(Text, sizeof(Text), "%s $%02X,Y", Op.Mnemonic, Operand1); break;
+    case Abs: std::snprintf(Text, sizeof(Text), "%s $%04X", Op.Mnemonic, Word); break;
+    case AbX: std::snprintf(Text, sizeof(Text), "%s $%04X,X", Op.Mnemonic, Word); break;
+    case AbY: std::snprintf(Text, sizeof(Text), "%s $%04X,Y", Op.Mnemonic, Word); break;
+    case Ind: std::snprintf(Text, sizeof(Text), "%s ($%04X)", Op.Mnemonic, Word); break;
+    case IzX: std::snprintf(Text, sizeof(Text), "%s ($%02X,X)", Op.Mnemonic, Operand1); break;
+    case IzY: std::snprintf(Text, sizeof(Text), "%s ($%02X),Y", Op.Mnemonic, Operand1); break;
+    case Izp: std::snprintf(Text, sizeof(Text), "%s ($%02X)", Op.Mnemonic, Operand1); break;
+    case IaX: std::snprintf(Text, sizeof(Text), "%s ($%04X,X)", Op.Mnemonic, Word); break;
+    case Rel: std::snprintf(Text, sizeof(Text), "%s $%04X", Op.Mnemonic, U16(Addr + 2 + S8(Operand1))); break;
+    case ZpR: std::snprintf(Text, sizeof(Text), "%s $%02X,$%04X", Op.Mnemonic, Operand1, U16(Addr + 3 + S8(Operand2))); break;
+    default:  std::snprintf(Text, sizeof(Text), "%s", Op.Mnemonic); break;
+    }
+    return Text;
+}
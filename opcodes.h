@@ -0,0 +1,55 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef OPCODES_H
+#define OPCODES_H
+
+#include <string>
+#include "common.h"
+
+// Instruction set tables for tracing and host side disassembly
+struct OpcodeInfo
+{
+    enum AddressingMode {
+        Implied = 0,
+        Accumulator,
+        Immediate,
+        ZeroPage,
+        ZeroPageX,
+        ZeroPageY,
+        Absolute,
+        AbsoluteX,
+        AbsoluteY,
+        Indirect,
+        IndexedX,
+        IndexedY,
+        IndirectZP,
+        IndirectX,
+        Relative,
+        // Zero page operand followed by branch offset (BBR, BBS)
+        ZeroPageRelative,
+    };
+
+    // Data memory access, stack accesses are implied by mnemonic
+    enum AccessType {
+        NoAccess = 0,
+        Read,
+        Write,
+        Modify,
+    };
+
+    const char* Mnemonic;
+    U8 Mode;
+    U8 Access;
+    U8 Length;
+    bool Defined;
+};
+
+const OpcodeInfo& DecodeOpcode(const U8 OpCode, const bool CMOS);
+
+// Formats instruction with given operand bytes, e.g. "LDA $0200,X"
+std::string Disassemble(const U16 Addr, const U8 OpCode, const U8 Operand1, const U8 Operand2, const bool CMOS);
+
+#endif // OPCODES_H
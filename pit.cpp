@@ -0,0 +1,126 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include "cpu.h"
+#include "pit.h"
+
+namespace {
+    enum Registers {
+        RegCounterLo = 0x18,
+        RegCounterHi = 0x19,
+        RegPrescaler = 0x1A,
+        RegControl   = 0x1B,
+    };
+
+    enum ControlBits {
+        CtlEnable  = 0x01,
+        CtlRepeat  = 0x02,
+        CtlExpired = 0x20,
+        CtlIRQ     = 0x40,
+    };
+}
+
+PIT::PIT(CPU* InCPU)
+    : Device(InCPU)
+    , Latch(0)
+    , Prescaler(0)
+    , Control(0)
+    , Remaining(0)
+{
+    // Without timer registers are plain memory, which BIOS detects
+    if(!TheCPU.Settings.Timer)
+        return;
+
+    for(int Reg=RegCounterLo; Reg<=RegControl; Reg++) {
+        RAM.AllocRegister<PIT>(Reg, this, &PIT::ReadRegister, &PIT::WriteRegister);
+    }
+}
+
+U32 PIT::Period() const
+{
+    // Latch value of zero stands for 65536 counts
+    const U32 Counts = Latch ? Latch : 0x10000;
+    return Counts * (Prescaler + 1);
+}
+
+void PIT::Tick(const U32 DeltaCycles)
+{
+    if(!(Control & CtlEnable))
+        return;
+
+    if(DeltaCycles < Remaining) {
+        Remaining -= DeltaCycles;
+        return;
+    }
+
+    const U32 Overrun = DeltaCycles - Remaining;
+    Expire();
+
+    if(Control & CtlRepeat) {
+        const U32 Length = Period();
+        Remaining = Length - Overrun % Length;
+    }
+    else {
+        Control  &= ~CtlEnable;
+        Remaining = 0;
+    }
+}
+
+void PIT::Expire()
+{
+    Control |= CtlExpired;
+    UpdateIRQ();
+}
+
+void PIT::UpdateIRQ()
+{
+    // IRQ is held until expiry is acknowledged, so expiry while masked is not lost
+    if((Control & (CtlExpired | CtlIRQ)) == (CtlExpired | CtlIRQ))
+        TheCPU.AssertIRQ(CPU::IRQ_Timer);
+    else
+        TheCPU.ReleaseIRQ(CPU::IRQ_Timer);
+}
+
+U32 PIT::CyclesToEvent() const
+{
+    return (Control & CtlEnable) ? Remaining : ~0u;
+}
+
+U8 PIT::ReadRegister(U8 Reg)
+{
+    // Running counter reports whole counts left, stopped counter reports latch
+    const U32 Count = (Control & CtlEnable) ? (Remaining + Prescaler) / (Prescaler + 1) : Latch;
+
+    switch(Reg) {
+    case RegCounterLo: return Count & 0xFF;
+    case RegCounterHi: return (Count >> 8) & 0xFF;
+    case RegPrescaler: return Prescaler;
+    case RegControl: {
+        // Expiry flag is cleared on read, which acknowledges the interrupt
+        const U8 Value = Control;
+        Control &= ~CtlExpired;
+        UpdateIRQ();
+        return Value;
+    }
+    }
+    return 0;
+}
+
+void PIT::WriteRegister(U8 Reg, U8 Data)
+{
+    switch(Reg) {
+    case RegCounterLo: Latch = (Latch & 0xFF00) | Data;      break;
+    case RegCounterHi: Latch = (Latch & 0x00FF) | Data << 8; break;
+    case RegPrescaler: Prescaler = Data; break;
+    case RegControl:
+        // Enabling the timer (re)loads counter from latch. CPU stores read
+        // the register first, so a store instruction has already acknowledged
+        // expiry; only DMA writes, which do not read, keep the expiry flag.
+        Control = (Control & CtlExpired) | (Data & (CtlEnable | CtlRepeat | CtlIRQ));
+        Remaining = (Control & CtlEnable) ? Period() : 0;
+        UpdateIRQ();
+        break;
+    }
+}
@@ -0,0 +1,42 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef PIT_H
+#define PIT_H
+
+#include "common.h"
+#include "device.h"
+
+// Programmable interval timer.
+// 16-bit counter decremented every (prescaler+1) CPU cycles, asserts IRQ
+// when it expires until control register is read, and optionally reloads
+// itself from the latch.
+class PIT : public Device
+{
+public:
+    PIT(class CPU* InCPU);
+
+    void Tick(const U32 DeltaCycles) override;
+
+    // Cycles until next expiry, used to skip idle cycles while CPU is halted
+    U32 CyclesToEvent() const;
+
+    U16 Latch;
+    U8  Prescaler;
+    U8  Control;
+
+private:
+    U8   ReadRegister(U8 Reg);
+    void WriteRegister(U8 Reg, U8 Data);
+
+    U32 Period() const;
+    void Expire();
+    void UpdateIRQ();
+
+    // Cycles remaining until counter reaches zero
+    U32 Remaining;
+};
+
+#endif // PIT_H
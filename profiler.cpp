@@ -0,0 +1,170 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include "cpu.h"
+#include "profiler.h"
+
+namespace {
+    // Zero-page locations used by IL interpreter
+    const U8 LINENO  = 0x28; // Current line number
+    const U8 ILPC    = 0x2A; // IL program counter
+    const U8 RUNMODE = 0xBE; // Nonzero while program is running
+    const U8 ILSTMT  = 0xC4; // IL address of statement executor
+
+    // Number of lines listed in report
+    const size_t ReportLines = 20;
+
+    const char* OpNames[] = {
+        "NO", "LB", "LN", "DS", "SP", "NO", "NO", "NO",
+        "SB", "RB", "FV", "SV", "GS", "RS", "GO", "NE",
+        "AD", "SU", "MP", "DV", "CP", "NX", "NO", "LS",
+        "PN", "PQ", "PT", "NL", "PC", "NO", "NO", "GL",
+        "28", "29", "IL", "MT", "XQ", "WS", "US", "RT",
+    };
+
+    const char* OpName(const U8 OpCode)
+    {
+        static const char* BranchNames[] = { "BR", "BR", "BC", "BV", "BN", "BE" };
+
+        if(OpCode >= 0x40)
+            return BranchNames[(OpCode >> 5) - 2];
+        if(OpCode >= 0x30)
+            return OpCode >= 0x38 ? "J" : "JS";
+        if(OpCode >= 0x08)
+            return OpNames[OpCode - 0x08];
+        return "XC";
+    }
+}
+
+BasicProfiler::BasicProfiler(CPU* InCPU)
+    : Device(InCPU)
+    , Enabled(false)
+    , Dispatch(0)
+    , Started(false)
+    , Running(false)
+    , Line(0)
+    , OpCode(0)
+    , LastCycles(0)
+{}
+
+BasicProfiler::~BasicProfiler()
+{
+    if(Enabled) {
+        Report();
+    }
+}
+
+void BasicProfiler::Attach()
+{
+    Enabled = false;
+    if(!TheCPU.Settings.ProfileBasic)
+        return;
+
+    if(!TheCPU.Basic.Locate()) {
+        std::fprintf(stderr, "BASIC profiler: Tiny BASIC interpreter not recognized, disabled\n");
+        return;
+    }
+
+    Dispatch = TheCPU.Basic.DispatchAddr();
+    Lines.assign(0x10000, Counter());
+    Enabled = true;
+    std::printf("BASIC profiler enabled, IL dispatch at $%04x\n", Dispatch);
+}
+
+void BasicProfiler::Account()
+{
+    // Cycles since previous dispatch belong to previous IL operation
+    const U64 Delta = TheCPU.TotalCycles - LastCycles;
+    if(Started) {
+        if(Running) {
+            Lines[Line].Cycles += Delta;
+            Ops[OpCode].Cycles += Delta;
+        }
+        else {
+            Direct.Cycles += Delta;
+        }
+    }
+    LastCycles = TheCPU.TotalCycles;
+}
+
+void BasicProfiler::Sample()
+{
+    Account();
+    Started = true;
+
+    OpCode  = TheCPU.A;
+    Running = RAM.Peek(RUNMODE) != 0;
+    Line    = RAM.Peek(LINENO) | RAM.Peek(LINENO+1) << 8;
+    if(!Running)
+        return;
+
+    // Statement begins when IL execution returns to statement executor
+    const U16 OpAddr = (RAM.Peek(ILPC) | RAM.Peek(ILPC+1) << 8) - 1;
+    if(OpAddr == (RAM.Peek(ILSTMT) | RAM.Peek(ILSTMT+1) << 8)) {
+        Lines[Line].Count++;
+    }
+    Ops[OpCode].Count++;
+}
+
+void BasicProfiler::Report()
+{
+    Account();
+
+    U64 Statements = 0;
+    U64 Cycles     = 0;
+    std::vector<U16> Hot;
+    for(U32 Number=0; Number<Lines.size(); Number++) {
+        if(Lines[Number].Cycles == 0 && Lines[Number].Count == 0)
+            continue;
+        Hot.push_back(Number);
+        Statements += Lines[Number].Count;
+        Cycles     += Lines[Number].Cycles;
+    }
+
+    std::printf("BASIC profile: %llu statements executed in %llu cycles, %llu cycles in direct mode\n",
+                (unsigned long long)Statements, (unsigned long long)Cycles, (unsigned long long)Direct.Cycles);
+    if(Cycles == 0)
+        return;
+
+    std::sort(Hot.begin(), Hot.end(), [this](const U16 A, const U16 B) {
+        return Lines[A].Cycles > Lines[B].Cycles;
+    });
+    if(Hot.size() > ReportLines) {
+        Hot.resize(ReportLines);
+    }
+
+    std::printf("\n   Line  Statements        Cycles      %%   Cycles/stmt\n");
+    for(const U16 Number : Hot) {
+        const Counter& Stats = Lines[Number];
+        std::printf("  %5u  %10llu  %12llu  %5.1f  %12.1f\n", Number,
+                    (unsigned long long)Stats.Count, (unsigned long long)Stats.Cycles,
+                    100.0 * Stats.Cycles / Cycles, Stats.Count ? double(Stats.Cycles) / Stats.Count : 0.0);
+    }
+
+    // Opcodes sharing a handler (branches, jumps) are reported together
+    std::map<std::string, Counter> ByName;
+    for(int Code=0; Code<256; Code++) {
+        if(Ops[Code].Count == 0)
+            continue;
+        Counter& Stats = ByName[OpName(Code)];
+        Stats.Cycles += Ops[Code].Cycles;
+        Stats.Count  += Ops[Code].Count;
+    }
+
+    std::vector<std::pair<std::string, Counter>> HotOps(ByName.begin(), ByName.end());
+    std::sort(HotOps.begin(), HotOps.end(), [](const std::pair<std::string, Counter>& A, const std::pair<std::string, Counter>& B) {
+        return A.second.Cycles > B.second.Cycles;
+    });
+
+    std::printf("\n   IL op       Count        Cycles      %%     Cycles/op\n");
+    for(const auto& Op : HotOps) {
+        std::printf("  %6s  %10llu  %12llu  %5.1f  %12.1f\n", Op.first.c_str(),
+                    (unsigned long long)Op.second.Count, (unsigned long long)Op.second.Cycles,
+                    100.0 * Op.second.Cycles / Cycles, double(Op.second.Cycles) / Op.second.Count);
+    }
+}
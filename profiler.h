@@ -0,0 +1,54 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <vector>
+#include "common.h"
+#include "device.h"
+
+// Attributes emulated cycles to Tiny BASIC line numbers & IL operations.
+// Sampled on every call to IL dispatch routine, report is printed at exit.
+class BasicProfiler : public Device
+{
+public:
+    BasicProfiler(CPU* InCPU);
+    ~BasicProfiler();
+
+    // Locates IL dispatch routine, must be called after ROM is loaded
+    void Attach();
+
+    // Called on JSR to IL dispatch routine
+    void Sample();
+
+    bool Enabled;
+    U16  Dispatch;
+
+private:
+    struct Counter {
+        Counter() : Cycles(0), Count(0) {}
+        U64 Cycles;
+        U64 Count;
+    };
+
+    void Account();
+    void Report();
+
+    // Indexed by line number, counts statements executed
+    std::vector<Counter> Lines;
+    // Indexed by IL opcode, counts operations executed by program
+    Counter Ops[256];
+    // Direct mode (line editing & immediate commands)
+    Counter Direct;
+
+    bool Started;
+    bool Running;
+    U16  Line;
+    U8   OpCode;
+    U64  LastCycles;
+};
+
+#endif // PROFILER_H
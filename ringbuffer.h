@@ -0,0 +1,109 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include "common.h"
+
+// Lock-free single producer, single consumer ring buffer
+template<class T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(size_t MinCapacity=1)
+        : ReadIndex(0)
+        , WriteIndex(0)
+    {
+        Reset(MinCapacity);
+    }
+
+    // Not thread safe, must be called before producer & consumer start
+    void Reset(size_t MinCapacity)
+    {
+        size_t Capacity = 1;
+        while(Capacity < MinCapacity)
+            Capacity <<= 1;
+
+        Elements.assign(Capacity, T());
+        Mask = Capacity - 1;
+
+        ReadIndex  = 0;
+        WriteIndex = 0;
+    }
+
+    size_t Capacity() const { return Elements.size(); }
+
+    size_t Size() const
+    {
+        return WriteIndex.load(std::memory_order_acquire) - ReadIndex.load(std::memory_order_acquire);
+    }
+    size_t Free() const
+    {
+        return Capacity() - Size();
+    }
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+    // Producer side
+    bool Push(const T& Element)
+    {
+        const size_t Index = WriteIndex.load(std::memory_order_relaxed);
+        if(Index - ReadIndex.load(std::memory_order_acquire) == Capacity())
+            return false;
+
+        Elements[Index & Mask] = Element;
+        WriteIndex.store(Index+1, std::memory_order_release);
+        return true;
+    }
+    size_t Write(const T* Data, size_t Count)
+    {
+        const size_t Index = WriteIndex.load(std::memory_order_relaxed);
+        Count = std::min(Count, Capacity() - (Index - ReadIndex.load(std::memory_order_acquire)));
+
+        for(size_t i=0; i<Count; i++) {
+            Elements[(Index+i) & Mask] = Data[i];
+        }
+        WriteIndex.store(Index+Count, std::memory_order_release);
+        return Count;
+    }
+
+    // Consumer side
+    bool Pop(T& Element)
+    {
+        const size_t Index = ReadIndex.load(std::memory_order_relaxed);
+        if(Index == WriteIndex.load(std::memory_order_acquire))
+            return false;
+
+        Element = Elements[Index & Mask];
+        ReadIndex.store(Index+1, std::memory_order_release);
+        return true;
+    }
+    size_t Read(T* Data, size_t Count)
+    {
+        const size_t Index = ReadIndex.load(std::memory_order_relaxed);
+        Count = std::min(Count, WriteIndex.load(std::memory_order_acquire) - Index);
+
+        for(size_t i=0; i<Count; i++) {
+            Data[i] = Elements[(Index+i) & Mask];
+        }
+        ReadIndex.store(Index+Count, std::memory_order_release);
+        return Count;
+    }
+
+private:
+    std::vector<T> Elements;
+    size_t Mask;
+
+    std::atomic<size_t> ReadIndex;
+    std::atomic<size_t> WriteIndex;
+};
+
+#endif // RINGBUFFER_H
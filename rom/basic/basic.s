@@ -141,7 +141,7 @@ SRVT     .word  IL_BBR               ; ($40-$5F) Backward Branch Relative
          .word  IL__PC               ; ($24) Print Literal String
          .word  IL__NO               ; ($25) (Reserved)
          .word  IL__NO               ; ($26) (Reserved)
-         .word  IL__GL               ; ($27) Get input Line
+         .word  IL__GX               ; ($27) Get input Line
          .word  ILRES1               ; ($28) (Seems to be reserved - No IL opcode calls this)
          .word  ILRES2               ; ($29) (Seems to be reserved - No IL opcode calls this)
          .word  IL__IL               ; ($2A) Insert BASIC Line
@@ -1302,3 +1302,84 @@ NO_CHR   pla
 
 RESET    jmp ($FFFC)
 
+;
+; Get input line, handling SAVE and LOAD commands.
+; Program is transferred to or from storage device and the IL is left
+; with an empty line. Command and file name are separated by one space.
+; Commands are recognized in direct mode only, INPUT lines are unchanged.
+;
+IL__GX   jsr IL__GL                 ; Get input line
+         lda $BE                    ; Check run mode flag
+         bne LBL157
+         ldx #$00                   ; Offset of first command name
+LBL150   ldy #$00
+LBL151   lda $30,Y                  ; Compare input line with command name
+         cmp FCMD,X
+         bne LBL152
+         inx
+         iny
+         cpy #$04
+         bne LBL151
+         beq LBL153                 ; Command matched
+LBL152   txa                        ; Skip to next command name
+         ora #$03
+         tax
+         inx
+         cpx #$08
+         bne LBL150
+LBL157   rts                        ; Not a storage command
+LBL153   lda $30,Y                  ; Terminate file name with 0
+         iny
+         cmp #$0D
+         bne LBL153
+         lda #$00
+         sta $2F,Y
+         lda $20                    ; Program starts at beginning of free ram
+         sta FCB+2
+         lda $21
+         sta FCB+3
+         cpx #$08                   ; Carry is set for SAVE
+         beq LBL154
+         sec
+         lda $22                    ; LOAD - limit length to end of free ram
+         sbc $20
+         sta FCB+4
+         lda $23
+         sbc $21
+         sta FCB+5
+         ldx #<FCB
+         ldy #>FCB
+         jsr $FF1E                  ; Handled by BIOS
+         bcs LBL155
+         lda $20                    ; Set end of program
+         adc FCB+4
+         sta $24
+         lda $21
+         adc FCB+5
+         sta $25
+         bcc LBL156
+LBL154   lda $24                    ; SAVE - program with spare stack
+         sbc $20
+         sta FCB+4
+         lda $25
+         sbc $21
+         sta FCB+5
+         ldx #<FCB
+         ldy #>FCB
+         jsr $FF21                  ; Handled by BIOS
+         bcc LBL156
+LBL155   pha                        ; Print error code
+         lda #'?'
+         jsr OUT_V
+         pla
+         and #$0F
+         ora #$30
+         jsr OUT_V
+         jsr P_NWLN
+LBL156   lda #$0D                   ; Leave empty line
+         sta $30
+         rts
+
+FCMD     .byte "LOADSAVE"           ; Storage command names
+FCB      .word $35                  ; File control block, name follows command
+         .res 4
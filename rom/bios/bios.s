@@ -30,6 +30,48 @@
 	AUDCTL = $FD0C
 	AUDFRQ = $FD0D
 
+	DMASRCL = $FD10
+	DMASRCH = $FD11
+	DMADSTL = $FD12
+	DMADSTH = $FD13
+	DMALENL = $FD14
+	DMALENH = $FD15
+	DMAFIL  = $FD16
+	DMACTL  = $FD17
+
+	DMACOPY = $80		; DMACTL values starting a transfer
+	DMAFILL = $81
+
+	TMRL   = $FD18
+	TMRH   = $FD19
+	TMRPRE = $FD1A
+	TMRCTL = $FD1B
+
+	TMRONE = $01		; TMRCTL value starting one-shot count
+	TMRJIF = $43		; TMRCTL value starting periodic count with IRQ
+	TMREXP = $20		; TMRCTL expiry flag
+	JIFFY  = 20000		; CPU cycles per video frame
+
+	STBLKL = $FD20
+	STBLKH = $FD21
+	STCTL  = $FD22
+	STERR  = $FD23
+
+	STLOAD  = $01		; STCTL values starting a command
+	STSAVE  = $02
+	STNODEV = $FF		; Error code returned without storage device
+
+	SERRX  = $FD28
+	SERTX  = $FD29
+	SERSTA = $FD2A
+	SERCTL = $FD2B
+
+	SERRCV = $01		; SERSTA received byte flag
+	SERRDY = $02		; SERSTA transmitter ready flag
+
+	GETCHRV = $FF04		; Jump table entries redirected to serial port
+	PUTCHRV = $FF07
+
 	VRAM   = $F000
 	CMAP   = $F400
 
@@ -52,6 +94,8 @@
 	JMP CLRSCR
 	JMP WAIT
 	JMP BEEP
+	JMP FLOAD
+	JMP FSAVE
 
 ; BIOS code
 	.segment "BIOS"
@@ -109,6 +153,56 @@ INIT:
 	LDA #DEFCUR
 	STA CURSOR
 
+	LDA #0			; Detect DMA controller by filling TEMP with $FF
+	STA DMADSTH		; ... TEMP stays zero if there is none
+	STA DMALENH
+	LDA #TEMP
+	STA DMADSTL
+	LDA #1
+	STA DMALENL
+	LDA #$FF
+	STA DMAFIL
+	LDA #DMAFILL
+	STA DMACTL
+	LDA TEMP
+	STA DMAOK
+	LDA #0
+	STA TEMP
+
+	LDA #1			; Detect timer by letting it expire after one cycle
+	STA TMRL		; ... expiry flag stays clear if there is none
+	LDA #0
+	STA TMRH
+	STA TMRPRE
+	LDA #TMRONE
+	STA TMRCTL
+	NOP
+	LDA TMRCTL
+	AND #TMREXP
+	STA TMROK
+
+	LDA #$FF		; Detect storage device, its error register
+	STA STERR		; ... is read only and starts at zero
+	LDA STERR
+	EOR #$FF
+	STA STOK
+
+	LDX #0			; Detect serial port, its status register is read
+	STX SERSTA		; ... only and always reports transmitter ready
+	LDA SERSTA
+	AND #SERRDY
+	BEQ @SetConsole
+	LDX #4			; Redirect console to serial port if present
+@SetConsole:
+	LDA CONSOLE+0,X		; Point GETCHR & PUTCHR jump table entries
+	STA GETCHRV+0		; ... at console routines
+	LDA CONSOLE+1,X
+	STA GETCHRV+1
+	LDA CONSOLE+2,X
+	STA PUTCHRV+0
+	LDA CONSOLE+3,X
+	STA PUTCHRV+1
+
 	LDA #0			; Zero CPU registers
 	LDX #0
 	LDY #0
@@ -128,6 +222,41 @@ GETCHR:
 	PLP			; Restore CPU flags
 	RTS
 
+; Gets character from serial port or keyboard, whichever has one first
+; Arguments : none
+; Modifies  : result in A
+SERGET:
+	PHP			; Save CPU flags
+@Poll:
+	LDA SERSTA		; Check serial port for received byte
+	AND #SERRCV
+	BNE @Serial
+	LDA KBDCTL		; Check keyboard for key press
+	AND #$40
+	BEQ @Poll
+	LDA KBDDAT		; Load key data
+	PLP			; Restore CPU flags
+	RTS
+@Serial:
+	LDA SERRX		; Load received byte
+	PLP			; Restore CPU flags
+	RTS
+
+; Outputs character to serial port
+; Arguments : Character in A
+; Modifies  : none
+SERPUT:
+	PHP			; Save CPU flags and A
+	PHA
+@Wait:
+	LDA SERSTA		; Wait until transmitter is ready
+	AND #SERRDY
+	BEQ @Wait
+	PLA			; Transmit character
+	STA SERTX
+	PLP			; Restore CPU flags
+	RTS
+
 ; Outputs character to the screen
 ; Arguments : Character in A
 ; Modifies  : none
@@ -212,6 +341,9 @@ SCROLL_PUTCHR:			; Entry point for PUTCHR
 	TXA
 	PHA
 
+	LDA DMAOK		; Use DMA controller if present
+	BNE @DmaScroll
+
 	LDX #1			; Initialize X to 1. It will be source line number
 				; ... for copying the screen line-by-line
 	LDA #<VRAM		; Reset VRAM pointer #1 to the beginning of VRAM
@@ -266,6 +398,38 @@ SCROLL_PUTCHR:			; Entry point for PUTCHR
 	PLP
 	RTS
 
+@DmaScroll:
+	LDA #<(VRAM+MAXCOL)	; Move rows 1..MAXROW-1 one row up
+	STA DMASRCL
+	LDA #>(VRAM+MAXCOL)
+	STA DMASRCH
+	LDA #<VRAM
+	STA DMADSTL
+	LDA #>VRAM
+	STA DMADSTH
+	LDA #<((MAXROW-1)*MAXCOL)
+	STA DMALENL
+	LDA #>((MAXROW-1)*MAXCOL)
+	STA DMALENH
+	LDA #DMACOPY
+	STA DMACTL
+
+	LDA #MAXCOL		; Clear last row, destination is already there
+	STA DMALENL
+	LDA #0
+	STA DMALENH
+	STA DMAFIL
+	LDA #DMAFILL
+	STA DMACTL
+
+	LDA #<(VRAM+(MAXROW-1)*MAXCOL)	; Point VRAM pointers at last row
+	STA VRAMOFF0+0
+	STA VRAMOFF1+0
+	LDA #>(VRAM+(MAXROW-1)*MAXCOL)
+	STA VRAMOFF0+1
+	STA VRAMOFF1+1
+	JMP @Done
+
 ; Sets current TTY column
 ; Arguments : Column number in Y
 ; Modifies  : Carry set on error
@@ -425,6 +589,9 @@ CLRSCR:
 	STA TTYROW
 	STA TTYCOL
 
+	LDX DMAOK		; Use DMA controller if present
+	BNE @DmaClear
+
 	LDX #4			; Clear 4 256-byte memory segments
 	LDY #0
 @LoopSegment:
@@ -436,6 +603,7 @@ CLRSCR:
 	DEX			; ... it points to the next segment
 	BNE @LoopSegment
 
+@PlaceCursor:
 	LDA CURSOR
 	STA (VRAMOFF0),Y	; Place cursor at top of the screen
 
@@ -447,6 +615,24 @@ CLRSCR:
 	PLP
 	RTS
 
+@DmaClear:
+	STA DMAFIL		; Fill 4 256-byte memory segments with zero
+	LDA #<VRAM
+	STA DMADSTL
+	LDA #>VRAM
+	STA DMADSTH
+	LDA #0
+	STA DMALENL
+	LDA #4
+	STA DMALENH
+	LDA #DMAFILL
+	STA DMACTL
+
+	LDA #>(VRAM+$400)	; Leave VRAMOFF1 past cleared area
+	STA VRAMOFF1+1
+	LDY #0
+	JMP @PlaceCursor
+
 ; Delays execution until timer is zero.
 ; Arguments : Timer value in A
 ; Modifies  : None
@@ -455,6 +641,9 @@ WAIT:
 	PHA
 
 	STA TIMER		; Set timer value
+	LDA TMROK		; Use interval timer if present
+	BNE @Sleep
+
 	LDA #$E8		; Enable raster interrupt on VBLANK
 	STA RASINT
 @Loop:
@@ -468,6 +657,32 @@ WAIT:
 	PLP
 	RTS
 
+@Sleep:
+	SEI			; Expiry wakes the CPU without calling ISR
+	LDA #<JIFFY		; Expire once per video frame
+	STA TMRL
+	LDA #>JIFFY
+	STA TMRH
+	LDA #0
+	STA TMRPRE
+	LDA #TMRJIF
+	STA TMRCTL
+@Halt:
+	LDA TIMER
+	BEQ @Stop		; Halt until timer is zero
+	.byte $CB		; WAI (65C02), resumes on any interrupt request
+	LDA TMRCTL		; Count frames only on timer expiry
+	AND #TMREXP
+	BEQ @Halt
+	DEC TIMER
+	JMP @Halt
+@Stop:
+	STA TMRCTL		; Stop timer, A is zero here
+
+	PLA			; Restore CPU flags and registers
+	PLP
+	RTS
+
 ; Delays execution and makes a sound
 ; Arguments : Timer value in A
 ;             Sound frequency in X
@@ -499,11 +714,50 @@ BEEP:
 	SEC
 	RTS
 
+; Loads file from storage device
+; Arguments : Address of file control block in X (low) and Y (high)
+; Modifies  : A, carry set on error with error code in A
+; File control block holds three words: address of zero terminated
+; file name, memory address and length. Length limits the number of
+; bytes loaded (zero for no limit) and is set to the number loaded.
+FLOAD:
+	LDA #STLOAD
+	BNE FILEIO
+
+; Saves memory block to a file on storage device
+; Arguments : Address of file control block in X (low) and Y (high)
+; Modifies  : A, carry set on error with error code in A
+FSAVE:
+	LDA #STSAVE
+FILEIO:
+	PHA
+	LDA STOK		; Fail if there is no storage device
+	BEQ @Error
+	STX STBLKL		; Pass file control block
+	STY STBLKH
+	PLA
+	STA STCTL		; Command completes before next instruction
+	LDA STERR
+	CMP #1			; Set carry if error code is nonzero
+	RTS
+
+@Error:
+	PLA
+	LDA #STNODEV
+	SEC
+	RTS
+
 ; Variables
 TTYCOL: .res 1		; Current TTY column
 TTYROW: .res 1		; Current TTY row
 CURSOR: .res 1		; Cursor
 TIMER:  .res 1		; Timer counter
+DMAOK:  .res 1		; Nonzero if DMA controller is present
+TMROK:  .res 1		; Nonzero if interval timer is present
+STOK:   .res 1		; Nonzero if storage device is present
+
+; Console routines: keyboard & screen, serial port
+CONSOLE: .word GETCHR, PUTCHR, SERGET, SERPUT
 
 ; Interrupt service routines follow
 	.include "isr.s"
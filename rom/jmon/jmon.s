@@ -106,6 +106,17 @@
   FGCOLH  = $FD09
   AUDCTL  = $FD0C		; Audio control
   AUDFRQ  = $FD0D		; Audio frequency
+  DBGA    = $FD30		; Debug port: registers of traced program
+  DBGX    = $FD31
+  DBGY    = $FD32
+  DBGS    = $FD33
+  DBGP    = $FD34
+  DBGPCL  = $FD35
+  DBGPCH  = $FD36
+  DBGCTL  = $FD37		; Debug port command & stop reason
+  DBGID   = $FD3F		; Debug port identification
+  DBGSIG  = $B1			; DBGID value if debug port is present
+  DBGSTEP = $01			; DBGCTL single step command
   VRAM	  = $F000		; VRAM start
 
 ; BIOS functions
@@ -113,6 +124,8 @@
   PUTCHR  = $FF06
   SCROLL  = $FF09
   CLRSCR  = $FF15
+  FLOAD   = $FF1E
+  FSAVE   = $FF21
 
 ; Page Zero locations
 ; Note: Woz Mon uses $24 through $2B and $0200 through $027F.
@@ -1301,6 +1314,121 @@ Checksum:
 @NoCarry2:
 	JMP @CalcSum
 
+; Load file command. Load file from storage device into memory.
+; Format: E <address> <name>
+; e.g.
+; E 0200 HELLO.BIN
+LoadFile:
+	JSR PUTCHR		; echo command
+	JSR PrintSpace		; print space
+	JSR GetAddress		; prompt for load address
+	STX FCB+2		; store address
+	STY FCB+3
+	JSR PrintSpace		; print space
+	JSR GetFileName		; prompt for file name
+	JSR PrintCR
+	LDA #0			; load up to end of memory
+	STA FCB+4
+	STA FCB+5
+	LDX #<FCB
+	LDY #>FCB
+	JSR FLOAD
+	JMP PrintFileResult
+
+; Save file command. Save memory range to a file on storage device.
+; Format: P <start> <end> <name>
+; e.g.
+; P 0200 02FF HELLO.BIN
+SaveFile:
+	JSR PUTCHR		; echo command
+	JSR PrintSpace		; print space
+	JSR GetAddress		; prompt for start address
+	STX SL			; store address
+	STY SH
+	STX FCB+2
+	STY FCB+3
+	JSR PrintSpace		; print space
+	JSR GetAddress		; prompt for end address
+	STX EL			; store address
+	STY EH
+	JSR PrintSpace		; print space
+	JSR GetFileName		; prompt for file name
+	JSR PrintCR
+	JSR RequireStartNotAfterEnd
+	BCC @okay1
+	RTS
+
+@okay1:
+	SEC			; length is end - start + 1
+	LDA EL
+	SBC SL
+	STA FCB+4
+	LDA EH
+	SBC SH
+	STA FCB+5
+	INC FCB+4
+	BNE @NoCarry
+	INC FCB+5
+@NoCarry:
+	LDX #<FCB
+	LDY #>FCB
+	JSR FSAVE
+				; Falls through into PrintFileResult
+
+; Print number of bytes transferred or storage error code.
+; Pass carry and error code in A as returned by BIOS.
+PrintFileResult:
+	BCS @Error
+	LDX #<BytesString
+	LDY #>BytesString
+	JSR PrintString
+	LDX FCB+4		; Print the length
+	LDY FCB+5
+	JSR PrintAddress
+	JMP PrintCR
+@Error:
+	PHA
+	LDX #<StorageError
+	LDY #>StorageError
+	JSR PrintString
+	PLA
+	JSR PRBYTE		; Print error code
+	JMP PrintCR
+
+; Get file name, echoing characters as typed.
+; Name is stored in IN buffer and its address in FCB.
+; Registers changed: A, X
+GetFileName:
+	LDX #0			; Initialize index into buffer
+@Loop:
+	JSR GETCHR		; Get character from keyboard
+	CMP #CR			; <Enter> key pressed?
+	BEQ @Done
+	CMP #BS			; <Backspace> key pressed?
+	BEQ @Backspace
+	CMP #' '+1		; Ignore spaces and control characters
+	BCC @Loop
+	CPX #16			; Ignore characters past maximum length
+	BCS @Loop
+	JSR PUTCHR		; Echo the key pressed
+	STA IN,X		; Store character in buffer
+	INX
+	BNE @Loop		; Always taken
+@Backspace:
+	CPX #0			; If already at index 0 do nothing
+	BEQ @Loop
+	JSR PUTCHR		; Echo backspace to terminal
+	DEX
+	JMP @Loop
+@Done:
+	LDA #0			; Terminate name with 0
+	STA IN,X
+	LDA #<IN
+	STA FCB
+	LDA #>IN
+	STA FCB+1
+	RTS
+
 ; Reboot command
 ; This function does not return.
 Reboot:
@@ -1818,7 +1946,7 @@ GOTMCH: INX			; Makes zero a miss
 	MATCHN = JMPFL-MATCHFL
 
 MATCHFL:
-	.byte "ABCDFGHIKLMNORSTUV:=.",F1,F12
+	.byte "ABCDEFGHIKLMNOPRSTUV:=.",F1,F12
 
 JMPFL:
 	.word Invalid-1
@@ -1826,6 +1954,7 @@ JMPFL:
 	.word Breakpoint-1
 	.word Copy-1
 	.word Dump-1
+	.word LoadFile-1
 	.word Fill-1
 	.word Go-1
 	.word Hex-1
@@ -1835,6 +1964,7 @@ JMPFL:
 	.word SoundTest-1
 	.word Info-1
 	.word Options-1
+	.word SaveFile-1
 	.word Registers-1
 	.word Search-1
 	.word Test-1
@@ -2031,6 +2161,7 @@ HelpString:
 	.byte "Breakpoint  B <n or ?> <address>", CR
 	.byte "Copy        C <start> <end> <dest>", CR
 	.byte "Dump        D <start>", CR
+	.byte "Load file   E <address> <name>", CR
 	.byte "Fill        F <start> <end> <data>...", CR
 	.byte "Go          G <address>", CR
 	.byte "Hex to dec  H <address>", CR
@@ -2040,6 +2171,7 @@ HelpString:
 	.byte "Sound test  M", CR
 	.byte "Info        N", CR
 	.byte "Options     O", CR
+	.byte "Save file   P <start> <end> <name>", CR
 	.byte "Registers   R", CR
 	.byte "Search      S <start> <end> <data>...", CR
 	.byte "Test        T <start> <end>", CR
@@ -2064,6 +2196,12 @@ NotFound:
 Found:
 	.asciiz "Found at: "
 
+BytesString:
+	.asciiz "Bytes: "
+
+StorageError:
+	.asciiz "Storage error "
+
 MismatchString:
 	.asciiz "Mismatch: "
 
@@ -2208,3 +2346,4 @@ MNEM:	   .res 3		; Hold three letter mnemonic string used by assembler
 OPERAND:   .res 2		; Holds any operands for assembled instruction
 TRACEINST: .res 8		; buffer holding traced instruction followed by a JMP and optionally another jump (Up to 8 bytes)
 TAKEN:	   .res 1		; Flag indicating if a traced branch instruction was taken
+FCB:	   .res 6		; File control block: name address, memory address, length
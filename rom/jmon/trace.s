@@ -80,6 +80,52 @@
 
 Trace:
 
+; If the emulator debug port is present it executes the instruction
+; exactly, otherwise it is executed (or emulated) by the code below.
+; The port ignores writes to DBGID, plain memory returns them.
+
+        LDA #0
+        STA DBGID
+        LDA DBGID
+        CMP #DBGSIG
+        BNE SoftTrace
+
+        LDA SAVE_A              ; Pass saved registers to the port
+        STA DBGA
+        LDA SAVE_X
+        STA DBGX
+        LDA SAVE_Y
+        STA DBGY
+        LDA SAVE_S
+        STA DBGS
+        LDA SAVE_P
+        STA DBGP
+        LDA SAVE_PC
+        STA DBGPCL
+        LDA SAVE_PC+1
+        STA DBGPCH
+
+        LDA #DBGSTEP            ; Instruction is executed before the next one here
+        STA DBGCTL
+
+        LDA DBGA                ; Save new register values
+        STA SAVE_A
+        LDA DBGX
+        STA SAVE_X
+        LDA DBGY
+        STA SAVE_Y
+        LDA DBGS
+        STA SAVE_S
+        LDA DBGP
+        STA SAVE_P
+        LDA DBGPCL
+        STA NEXT_PC
+        LDA DBGPCH
+        STA NEXT_PC+1
+        JMP NewPC               ; Display registers and next instruction
+
+SoftTrace:
+
 ; Get next instruction op code from saved PC location.
 
         LDA SAVE_PC             ; Get address of instruction to execute (low byte)
@@ -0,0 +1,192 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <map>
+#include <cstring>
+#include <algorithm>
+#include "device.h"
+#include "keyboard.h"
+#include "wavefile.h"
+#include "sdlhost.h"
+
+namespace {
+    // Host samples per audio callback
+    const U16 DeviceSamples = 512;
+
+    const std::map<Sint32, U8> SpecialKeys = {
+        {SDLK_LSHIFT,   0x01},
+        {SDLK_RSHIFT,   0x02},
+        {SDLK_LCTRL,    0x03},
+        {SDLK_RCTRL,    0x04},
+        {SDLK_LALT,     0x05},
+        {SDLK_RALT,     0x06},
+
+        {SDLK_CAPSLOCK,   0x0A},
+        {SDLK_SCROLLLOCK, 0x0B},
+
+        {SDLK_RIGHT, 0x0E},
+        {SDLK_LEFT,  0x0F},
+        {SDLK_UP,    0x10},
+        {SDLK_DOWN,  0x11},
+
+        {SDLK_F1,  0x81},
+        {SDLK_F2,  0x82},
+        {SDLK_F3,  0x83},
+        {SDLK_F4,  0x84},
+        {SDLK_F5,  0x85},
+        {SDLK_F6,  0x86},
+        {SDLK_F7,  0x87},
+        {SDLK_F8,  0x88},
+        {SDLK_F9,  0x89},
+        {SDLK_F10, 0x8A},
+        {SDLK_F11, 0x8B},
+        {SDLK_F12, 0x8C},
+
+        {SDLK_HOME,     0x50},
+        {SDLK_END,      0x51},
+        {SDLK_PAGEUP,   0x52},
+        {SDLK_PAGEDOWN, 0x53},
+        {SDLK_INSERT,   0x7E},
+    };
+}
+
+SDLVideo::SDLVideo(const U16 Width, const U16 Height)
+    : Window(nullptr)
+    , Renderer(nullptr)
+    , Texture(nullptr)
+{
+    if(SDL_InitSubSystem(SDL_INIT_VIDEO) < 0) {
+        throw Device::Error(SDL_GetError());
+    }
+
+    if(!(Window = SDL_CreateWindow("B1 Display", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, Width*2, Height*2, 0))) {
+        throw Device::Error(SDL_GetError());
+    }
+    if(!(Renderer = SDL_CreateRenderer(Window, -1, 0))) {
+        throw Device::Error(SDL_GetError());
+    }
+    if(!(Texture = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, Width, Height))) {
+        throw Device::Error(SDL_GetError());
+    }
+}
+
+SDLVideo::~SDLVideo()
+{
+    if(Texture)
+        SDL_DestroyTexture(Texture);
+    if(Renderer)
+        SDL_DestroyRenderer(Renderer);
+    if(Window)
+        SDL_DestroyWindow(Window);
+}
+
+void SDLVideo::Present(const U8* Pixels, const U16 Width, const U16 Height, const int Pitch)
+{
+    UNUSED(Width); UNUSED(Height);
+
+    SDL_UpdateTexture(Texture, nullptr, Pixels, Pitch);
+    SDL_RenderCopy(Renderer, Texture, nullptr, nullptr);
+    SDL_RenderPresent(Renderer);
+}
+
+SDLAudio::SDLAudio(const U32 Rate, const SampleFormat InFormat)
+    : AudioDevice(0)
+    , Format(InFormat)
+    , NumUnderruns(0)
+{
+    if(SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+        throw Device::Error(SDL_GetError());
+    }
+
+    SDL_AudioSpec InAudioSpec;
+    std::memset(&InAudioSpec, 0, sizeof(SDL_AudioSpec));
+    InAudioSpec.freq     = Rate;
+    InAudioSpec.channels = 1;
+    InAudioSpec.samples  = DeviceSamples;
+    InAudioSpec.callback = SDLAudio::AudioCallback;
+    InAudioSpec.userdata = this;
+
+    switch(Format) {
+    case SampleFormat::U8:  InAudioSpec.format = AUDIO_U8;     break;
+    case SampleFormat::S16: InAudioSpec.format = AUDIO_S16LSB; break;
+    case SampleFormat::F32: InAudioSpec.format = AUDIO_F32SYS; break;
+    }
+
+    if(!(AudioDevice = SDL_OpenAudioDevice(nullptr, 0, &InAudioSpec, &AudioSpec, 0))) {
+        throw Device::Error(SDL_GetError());
+    }
+
+    Buffer.Reset(4 * AudioSpec.samples);
+    CallbackBlock.resize(AudioSpec.size / WaveFile::SampleSize(Format));
+    SDL_PauseAudioDevice(AudioDevice, 0);
+}
+
+SDLAudio::~SDLAudio()
+{
+    if(AudioDevice) {
+        SDL_CloseAudioDevice(AudioDevice);
+    }
+    if(NumUnderruns > 0) {
+        std::fprintf(stderr, "SPU: %u audio buffer underruns\n", U32(NumUnderruns));
+    }
+}
+
+void SDLAudio::Write(const float* Samples, const size_t Count)
+{
+    // Samples that don't fit are dropped, emulation is running too fast
+    Buffer.Write(Samples, Count);
+}
+
+double SDLAudio::Fill() const
+{
+    return double(Buffer.Size()) / Buffer.Capacity();
+}
+
+U32 SDLAudio::Underruns() const
+{
+    return NumUnderruns;
+}
+
+void SDLAudio::AudioCallback(void *UserData, Uint8 *Stream, int Length)
+{
+    SDLAudio& Self = *static_cast<SDLAudio*>(UserData);
+
+    const size_t NumSamples = std::min<size_t>(Length / WaveFile::SampleSize(Self.Format), Self.CallbackBlock.size());
+    const size_t SamplesRead = Self.Buffer.Read(Self.CallbackBlock.data(), NumSamples);
+    if(SamplesRead < NumSamples) {
+        std::fill(Self.CallbackBlock.begin() + SamplesRead, Self.CallbackBlock.begin() + NumSamples, 0.0f);
+        Self.NumUnderruns++;
+    }
+    WaveFile::ConvertSamples(Self.CallbackBlock.data(), Stream, NumSamples, Self.Format);
+}
+
+void SDLKeyEvent(Keyboard& Kbd, const SDL_KeyboardEvent& Event)
+{
+    const Sint32 KeyCode = Event.keysym.sym;
+    U8 Code;
+
+    // SDL key codes of character keys are their ASCII codes
+    if(KeyCode <= 0x7F) {
+        Code = U8(KeyCode);
+    }
+    else {
+        auto KeyIt = SpecialKeys.find(KeyCode);
+        if(KeyIt == SpecialKeys.end())
+            return;
+        Code = KeyIt->second;
+    }
+
+    U8 Mods = 0;
+    if(Event.keysym.mod & KMOD_SHIFT)
+        Mods |= Keyboard::ModShift;
+    if(Event.keysym.mod & KMOD_CAPS)
+        Mods |= Keyboard::ModCaps;
+    if(Event.keysym.mod & KMOD_ALT)
+        Mods |= Keyboard::ModAlt;
+    if(Event.keysym.mod & KMOD_CTRL)
+        Mods |= Keyboard::ModCtrl;
+
+    Kbd.KeyEvent(Code, Event.state == SDL_PRESSED, Mods);
+}
@@ -0,0 +1,62 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef SDLHOST_H
+#define SDLHOST_H
+
+#include <atomic>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "common.h"
+#include "config.h"
+#include "host.h"
+#include "ringbuffer.h"
+
+class Keyboard;
+
+// SDL window showing emulator display
+class SDLVideo : public VideoOutput
+{
+public:
+    SDLVideo(const U16 Width, const U16 Height);
+    ~SDLVideo();
+
+    void Present(const U8* Pixels, const U16 Width, const U16 Height, const int Pitch) override;
+
+private:
+    SDL_Window*   Window;
+    SDL_Renderer* Renderer;
+    SDL_Texture*  Texture;
+};
+
+// SDL audio device playing samples from a ring buffer
+class SDLAudio : public AudioOutput
+{
+public:
+    SDLAudio(const U32 Rate, const SampleFormat InFormat);
+    ~SDLAudio();
+
+    void   Write(const float* Samples, const size_t Count) override;
+    double Fill() const override;
+    U32    Underruns() const override;
+
+private:
+    static void AudioCallback(void* UserData, Uint8* Stream, int Length);
+
+    SDL_AudioDeviceID AudioDevice;
+    SDL_AudioSpec     AudioSpec;
+    SampleFormat      Format;
+
+    // Number of audio callbacks that ran out of samples
+    std::atomic<U32> NumUnderruns;
+
+    RingBuffer<float>  Buffer;
+    std::vector<float> CallbackBlock;
+};
+
+// Passes SDL keyboard event to keyboard controller
+void SDLKeyEvent(Keyboard& Kbd, const SDL_KeyboardEvent& Event);
+
+#endif // SDLHOST_H
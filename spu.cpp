@@ -3,7 +3,6 @@
  * (c) 2014-2015 Michał Siejak
  */
 
-#include <cstring>
 #include <cmath>
 #include "cpu.h"
 #include "spu.h"
@@ -18,90 +17,185 @@ namespace {
         WaveSquare   = 0x01,
         WaveSine     = 0x02,
     };
-    const double Pi = 3.141593;
+    const double Pi = 3.14159265358979;
+
+    // Host samples synthesized per block (at most)
+    const U32 BlockSamples  = 256;
+
+    // Maximum playback rate adjustment for dynamic rate control
+    const double MaxRateDelta = 0.005;
+    // DC blocking filter pole
+    const float  DCBlockPole  = 0.995f;
+
+    const int SineTableSize = 1024;
 }
 
 SPU::SPU(CPU *InCPU)
     : Device(InCPU)
+    , Output(InCPU->Backends.Audio)
+    , AudioCtl(0)
+    , KeyReg(0)
+    , PendingCycles(0)
     , Waveform(0)
     , Volume(240)
-    , SampleIndex(0)
-    , Buffer(nullptr)
-    , BufferSize(0)
-    , ReadCursor(0)
-    , WriteCursor(0)
-    , BytesAvailable(0)
+    , Phase(0.0)
+    , Time(0.0)
+    , Position(0)
+    , BlockPosition(0)
+    , Underruns(0)
+    , Level(Volume / 256.0f)
+    , DCInput(Level)
+    , DCOutput(0.0f)
+    , Synth(2 * BlockSamples)
+    , Block(2 * BlockSamples)
+    , SineTable(SineTableSize+1)
 {
-    if(SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
-        throw Device::Error(SDL_GetError());
-    }
+    RAM.AllocRegister<SPU>(RegAudioCtl,  this, &SPU::ReadRegister, &SPU::WriteRegister);
+    RAM.AllocRegister<SPU>(RegFrequency, this, &SPU::ReadRegister, &SPU::WriteRegister);
 
-    SDL_AudioSpec InAudioSpec;
-    std::memset(&InAudioSpec, 0, sizeof(SDL_AudioSpec));
-    InAudioSpec.freq     = 8000;
-    InAudioSpec.format   = AUDIO_U8;
-    InAudioSpec.channels = 1;
-    InAudioSpec.samples  = 256;
-    InAudioSpec.callback = SPU::AudioCallback;
-    InAudioSpec.userdata = this;
+    SetKey(0);
+    AudioCtl = (Waveform << 4) | ((Volume >> 4) & 0x0F);
 
-    if(!(AudioDevice = SDL_OpenAudioDevice(nullptr, 0, &InAudioSpec, &AudioSpec, 0))) {
-        throw Device::Error(SDL_GetError());
+    for(int Index=0; Index<=SineTableSize; Index++) {
+        SineTable[Index] = 0.5 * (std::sin(2*Pi * Index/SineTableSize) + 1.0);
     }
 
-    BufferSize     = 4 * AudioSpec.size;
-    CyclesPerTick  = TheCPU.Frequency / AudioSpec.freq;
-    BytesAvailable = BufferSize;
+    const U32 Rate = TheCPU.Settings.AudioRate;
+    BaseTimeScale = double(Rate) / TheCPU.Frequency;
+    TimeScale     = BaseTimeScale;
+    BlockCycles   = BlockSamples / BaseTimeScale;
 
-    Buffer = new(std::nothrow) U8[BufferSize];
-    if(!Buffer) {
-        throw Device::Error("Could not allocate memory");
+    if(Output && TheCPU.Settings.Threads) {
+        SynthThread.Start(4096, [this](const Event& E) {
+            if(E.Reg) {
+                Cycles += E.Cycles;
+                Apply(E.Reg, E.Data);
+            }
+            else {
+                Advance(E.Cycles);
+            }
+        });
     }
-    std::memset(Buffer, AudioSpec.silence, BufferSize);
-    SDL_PauseAudioDevice(AudioDevice, 0);
+}
 
-    SetKey(0);
+SPU::~SPU()
+{
+    SynthThread.Stop();
+}
 
-    RAM.AllocRegister<SPU>(RegAudioCtl,  this, &SPU::ReadRegister, &SPU::WriteRegister);
-    RAM.AllocRegister<SPU>(RegFrequency, this, &SPU::ReadRegister, &SPU::WriteRegister);
+void SPU::Tick(const U32 DeltaCycles)
+{
+    if(!Output)
+        return;
+
+    if(SynthThread.IsRunning()) {
+        // Elapsed time is posted in blocks, register writes flush it earlier
+        PendingCycles += DeltaCycles;
+        if(PendingCycles >= BlockCycles) {
+            SynthThread.Post({PendingCycles, 0, 0});
+            PendingCycles = 0;
+        }
+    }
+    else {
+        Advance(DeltaCycles);
+    }
 }
 
-SPU::~SPU()
+void SPU::Advance(const U32 DeltaCycles)
 {
-    if(AudioDevice) {
-        SDL_CloseAudioDevice(AudioDevice);
-        delete[] Buffer;
+    Cycles += DeltaCycles;
+    if(Cycles >= BlockCycles) {
+        Synthesize();
+        OutputSamples();
     }
 }
 
-void SPU::Tick(const U32 DeltaCycles)
+void SPU::Synthesize()
 {
-    while(ShouldTick(DeltaCycles)) {
-        SDL_LockAudioDevice(AudioDevice);
-        if(BytesAvailable > 0) {
-            BytesAvailable--;
-
-            auto SampleFunction = &SPU::SampleFlat;
-            switch(Waveform) {
-            case WaveSquare: SampleFunction = &SPU::SampleSquare; break;
-            case WaveSine:   SampleFunction = &SPU::SampleSine;   break;
-            }
+    const double EndTime   = Time + Cycles * TimeScale;
+    const double PhaseStep = Frequency / TheCPU.Frequency;
+    const float  Amplitude = Volume / 256.0f;
+
+    switch(Waveform) {
+    case WaveSquare: {
+        // Square wave is high during second half of the period
+        double EdgeTime  = Time;
+        double EdgePhase = Phase;
+
+        SetLevel(Time, EdgePhase >= 0.5 ? Amplitude : 0.0f);
+        for(;;) {
+            const double NextEdge = EdgePhase < 0.5 ? 0.5 : 1.0;
+            EdgeTime += (NextEdge - EdgePhase) / PhaseStep * TimeScale;
+            if(EdgeTime >= EndTime)
+                break;
+
+            EdgePhase = NextEdge < 1.0 ? NextEdge : 0.0;
+            SetLevel(EdgeTime, EdgePhase >= 0.5 ? Amplitude : 0.0f);
+        }
+    } break;
+    case WaveSine: {
+        // Sine is band-limited already, sample it directly at host rate
+        const double PhasePerSample = PhaseStep / TimeScale;
+
+        SetLevel(Time, 0.0f);
+        for(size_t Index=size_t(std::ceil(Time)); Index < EndTime; Index++) {
+            Synth.AddSample(Index, Amplitude * Sine(Phase + (Index - Time) * PhasePerSample));
+        }
+    } break;
+    default:
+        SetLevel(Time, Amplitude);
+        break;
+    }
+
+    Phase  = std::fmod(Phase + Cycles * PhaseStep, 1.0);
+    Time   = EndTime;
+    Position += Cycles;
+    Cycles = 0;
+}
+
+void SPU::OutputSamples()
+{
+    const U64 HostStart = TheCPU.Events.Enabled ? TheCPU.Events.Now() : 0;
+
+    const size_t NumSamples = Synth.ReadSamples(Block.data(), Synth.SamplesReady(Time));
+    Time -= NumSamples;
+
+    // Remove DC offset of unsigned SPU output
+    for(size_t i=0; i<NumSamples; i++) {
+        const float Input = Block[i];
+        DCOutput = Input - DCInput + DCBlockPole * DCOutput;
+        DCInput  = Input;
+        Block[i] = DCOutput;
+    }
+
+    Output->Write(Block.data(), NumSamples);
+
+    // Dynamic rate control: steer output buffer towards being half full
+    const double Fill = Output->Fill();
+    if(Fill >= 0.0) {
+        TimeScale = BaseTimeScale * (1.0 + MaxRateDelta * (1.0 - 2.0*Fill));
+    }
 
-            Buffer[WriteCursor] = (this->*SampleFunction)();
-            SampleIndex = (SampleIndex+1) % (HalfPeriod<<1);
-            WriteCursor = (WriteCursor+1) % BufferSize;
+    if(TheCPU.Events.Enabled) {
+        const Timeline::ThreadId Thread = SynthThread.IsRunning() ? Timeline::ThreadSynth : Timeline::ThreadCPU;
+        TheCPU.Events.Complete(Timeline::EventAudioBlock, Thread, HostStart, BlockPosition, Position, U32(NumSamples), float(Fill));
+
+        const U32 NewUnderruns = Output->Underruns();
+        if(NewUnderruns != Underruns) {
+            Underruns = NewUnderruns;
+            TheCPU.Events.Instant(Timeline::EventUnderrun, Thread, Position, Underruns);
         }
-        SDL_UnlockAudioDevice(AudioDevice);
     }
+    BlockPosition = Position;
 }
 
 U8 SPU::ReadRegister(U8 Reg)
 {
     switch(Reg) {
     case RegAudioCtl:
-        return (Waveform << 4) | ((Volume >> 4) & 0x0F);
+        return AudioCtl;
     case RegFrequency:
-        return KeyIndex;
+        return KeyReg;
     }
     return 0;
 }
@@ -110,48 +204,63 @@ void SPU::WriteRegister(U8 Reg, U8 Data)
 {
     switch(Reg) {
     case RegAudioCtl:
-        Volume   = (Data & 0x0F) << 4;
-        Waveform = std::min((Data & 0xF0) >> 4, int(WaveSine));
+        AudioCtl = (std::min((Data & 0xF0) >> 4, int(WaveSine)) << 4) | (Data & 0x0F);
         break;
     case RegFrequency:
-        SetKey(Data);
-        SampleIndex %= HalfPeriod<<1;
+        KeyReg = Data & 0x3F;
         break;
     }
-}
 
-U8 SPU::SampleFlat() const
-{
-    return Volume;
+    if(SynthThread.IsRunning()) {
+        SynthThread.Post({PendingCycles, Reg, Data});
+        PendingCycles = 0;
+    }
+    else {
+        Apply(Reg, Data);
+    }
 }
 
-U8 SPU::SampleSquare() const
+void SPU::Apply(const U8 Reg, const U8 Data)
 {
-    return (SampleIndex / HalfPeriod) ? Volume : 0;
+    // Synthesize up to this point with previous register values
+    if(Output) {
+        Synthesize();
+        if(Time >= BlockSamples) {
+            OutputSamples();
+        }
+    }
+
+    switch(Reg) {
+    case RegAudioCtl:
+        Volume   = (Data & 0x0F) << 4;
+        Waveform = std::min((Data & 0xF0) >> 4, int(WaveSine));
+        break;
+    case RegFrequency:
+        SetKey(Data);
+        break;
+    }
 }
 
-U8 SPU::SampleSine() const
+void SPU::SetKey(const U8 NewIndex)
 {
-    return Volume * (std::sin(SampleIndex/double(HalfPeriod) * Pi) + 1.0) * 0.5;
+    KeyIndex  = NewIndex & 0x3F;
+    Frequency = std::pow(2.0, (KeyIndex-48)/12.0) * 440;
 }
 
-void SPU::SetKey(const U8 NewIndex)
+void SPU::SetLevel(const double AtTime, const float NewLevel)
 {
-    KeyIndex   = NewIndex & 0x3F;
-    Frequency  = std::pow(2.0, (KeyIndex-48)/12.0) * 440;
-    HalfPeriod = AudioSpec.freq / (Frequency<<1);
+    if(NewLevel != Level) {
+        Synth.AddStep(AtTime, NewLevel - Level);
+        Level = NewLevel;
+    }
 }
 
-void SPU::AudioCallback(void *UserData, Uint8 *Stream, int Length)
+float SPU::Sine(double AtPhase) const
 {
-    SPU& Self = *static_cast<SPU*>(UserData);
+    AtPhase -= std::floor(AtPhase);
 
-    for(; Self.BytesAvailable < Self.BufferSize && Length > 0; Length--) {
-        *Stream++ = Self.Buffer[Self.ReadCursor];
-        Self.ReadCursor = (Self.ReadCursor+1) % Self.BufferSize;
-        Self.BytesAvailable++;
-    }
-    if(Length > 0) {
-        std::memset(Stream, Self.AudioSpec.silence, Length);
-    }
+    const double Position = AtPhase * SineTableSize;
+    const int    Index    = int(Position);
+    const float  Fraction = Position - Index;
+    return SineTable[Index] + Fraction * (SineTable[Index+1] - SineTable[Index]);
 }
@@ -6,8 +6,12 @@
 #ifndef SPU_H
 #define SPU_H
 
+#include <vector>
 #include "common.h"
 #include "device.h"
+#include "host.h"
+#include "synth.h"
+#include "worker.h"
 
 // Sound Processing Unit
 class SPU : public Device
@@ -19,31 +23,62 @@ public:
     void Tick(const U32 DeltaCycles) override;
 
 private:
+    // Register write or elapsed time, posted to synthesis thread
+    struct Event {
+        U32 Cycles;
+        U8  Reg;
+        U8  Data;
+    };
+
     U8   ReadRegister(U8 Reg);
     void WriteRegister(U8 Reg, U8 Data);
 
-    inline U8 SampleFlat() const;
-    inline U8 SampleSquare() const;
-    inline U8 SampleSine() const;
+    // Run on synthesis thread if there is one
+    void Advance(const U32 DeltaCycles);
+    void Apply(const U8 Reg, const U8 Data);
+
+    void Synthesize();
+    void OutputSamples();
+
+    inline void  SetKey(const U8 NewIndex);
+    inline void  SetLevel(const double AtTime, const float NewLevel);
+    inline float Sine(double AtPhase) const;
+
+    AudioOutput* Output;
+
+    // Register values as seen by CPU
+    U8  AudioCtl;
+    U8  KeyReg;
+
+    Worker<Event> SynthThread;
+    U32           PendingCycles;
+
+    U8     Waveform;
+    U8     Volume;
+    U8     KeyIndex;
+    double Frequency;
 
-    inline void SetKey(const U8 NewIndex);
-    static void AudioCallback(void* UserData, Uint8* Stream, int Length);
+    // Oscillator phase in periods, [0,1)
+    double Phase;
+    // Current position on output timeline, in host samples
+    double Time;
+    // Host samples per emulated cycle, nominal and rate controlled
+    double BaseTimeScale;
+    double TimeScale;
+    U32    BlockCycles;
 
-    SDL_AudioDeviceID AudioDevice;
-    SDL_AudioSpec     AudioSpec;
+    // Cycles synthesized so far & at end of previous block, for timeline
+    U64    Position;
+    U64    BlockPosition;
+    U32    Underruns;
 
-    U8  Waveform;
-    U8  Volume;
-    U8  KeyIndex;
-    U16 Frequency;
-    U16 HalfPeriod;
-    U16 SampleIndex;
+    float  Level;
+    float  DCInput;
+    float  DCOutput;
 
-    U8* Buffer;
-    int BufferSize;
-    int ReadCursor;
-    int WriteCursor;
-    int BytesAvailable;
+    BandLimitedSynth   Synth;
+    std::vector<float> Block;
+    std::vector<float> SineTable;
 };
 
 #endif // SPU_H
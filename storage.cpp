@@ -0,0 +1,195 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include "cpu.h"
+#include "storage.h"
+
+namespace {
+    enum Registers {
+        RegBlockLo = 0x20,
+        RegBlockHi = 0x21,
+        RegControl = 0x22,
+        RegStatus  = 0x23,
+    };
+
+    enum ControlBits {
+        CtlCommand = 0x0F,
+        CtlDone    = 0x20,
+        CtlIRQ     = 0x40,
+    };
+
+    enum Commands {
+        CmdLoad = 0x01,
+        CmdSave = 0x02,
+    };
+
+    // File control block layout
+    enum BlockFields {
+        FieldName   = 0,
+        FieldAddr   = 2,
+        FieldLength = 4,
+    };
+}
+
+Storage::Storage(CPU* InCPU)
+    : Device(InCPU)
+    , Block(0)
+    , Control(0)
+    , Status(OK)
+    , Directory(InCPU->Settings.StorageDir)
+    , Busy(false)
+{
+    // Without storage registers are plain memory, which BIOS detects
+    if(Directory.empty())
+        return;
+
+    for(int Reg=RegBlockLo; Reg<=RegStatus; Reg++) {
+        RAM.AllocRegister<Storage>(Reg, this, &Storage::ReadRegister, &Storage::WriteRegister);
+    }
+}
+
+U8 Storage::ReadRegister(U8 Reg)
+{
+    switch(Reg) {
+    case RegBlockLo: return Block & 0xFF;
+    case RegBlockHi: return Block >> 8;
+    case RegControl: {
+        // Completion flag is cleared on read
+        const U8 Value = Control;
+        Control &= ~CtlDone;
+        return Value;
+    }
+    case RegStatus:  return Status;
+    }
+    return 0;
+}
+
+void Storage::WriteRegister(U8 Reg, U8 Data)
+{
+    switch(Reg) {
+    case RegBlockLo: Block = (Block & 0xFF00) | Data;      break;
+    case RegBlockHi: Block = (Block & 0x00FF) | Data << 8; break;
+    case RegControl:
+        // Loaded file may overwrite STCTL, such writes are ignored
+        if(Busy)
+            break;
+        Control = (Control & CtlDone) | (Data & CtlIRQ);
+        if(Data & CtlCommand) {
+            Busy     = true;
+            Status   = Execute(Data & CtlCommand);
+            Busy     = false;
+            Control |= CtlDone;
+            if(Control & CtlIRQ) {
+                TheCPU.SignalInterrupt(CPU::INT_IRQ);
+            }
+        }
+        break;
+    }
+}
+
+Storage::Result Storage::Execute(const U8 Command)
+{
+    std::string Name;
+    if(!ReadName(ReadWord(U16(Block + FieldName)), Name))
+        return InvalidName;
+
+    const std::string Path = Directory + "/" + Name;
+    const U16 Addr   = ReadWord(U16(Block + FieldAddr));
+    U16       Length = ReadWord(U16(Block + FieldLength));
+
+    Result Outcome;
+    switch(Command) {
+    case CmdLoad: Outcome = Load(Path, Addr, Length); break;
+    case CmdSave: Outcome = Save(Path, Addr, Length); break;
+    default:
+        return InvalidCmd;
+    }
+
+    // Number of bytes actually transferred is written back to the block
+    WriteWord(U16(Block + FieldLength), Length);
+    TheCPU.StallCycles += Length * TransferCycles;
+    return Outcome;
+}
+
+Storage::Result Storage::Load(const std::string& Path, const U16 Addr, U16& Length)
+{
+    // Zero length loads up to the end of address space, as much as length word can report
+    const U32 MaxCount = Length ? Length : std::min<U32>(MEMSIZE - Addr, 0xFFFF);
+    Length = 0;
+
+    std::FILE* File = std::fopen(Path.c_str(), "rb");
+    if(!File)
+        return NotFound;
+
+    Buffer.resize(MaxCount + 1);
+    const size_t Count = std::fread(Buffer.data(), 1, Buffer.size(), File);
+    const bool   Error = std::ferror(File) != 0;
+    std::fclose(File);
+
+    if(Error)
+        return IOError;
+    if(Count > MaxCount)
+        return TooLarge;
+
+    if(RAM.IsPlainMemory(Addr, Count)) {
+        std::memcpy(&RAM.Memory[Addr], Buffer.data(), Count);
+    }
+    else {
+        for(size_t i=0; i<Count; i++)
+            RAM.Write(U16(Addr+i), Buffer[i]);
+    }
+    Length = U16(Count);
+    return OK;
+}
+
+Storage::Result Storage::Save(const std::string& Path, const U16 Addr, U16& Length)
+{
+    const U32 Count = Length;
+    Length = 0;
+
+    Buffer.resize(Count);
+    for(U32 i=0; i<Count; i++)
+        Buffer[i] = RAM.Read(U16(Addr+i));
+
+    std::FILE* File = std::fopen(Path.c_str(), "wb");
+    if(!File)
+        return IOError;
+
+    const size_t Written = std::fwrite(Buffer.data(), 1, Count, File);
+    const bool   Error   = std::fclose(File) != 0 || Written != Count;
+    if(Error)
+        return IOError;
+
+    Length = U16(Count);
+    return OK;
+}
+
+bool Storage::ReadName(const U16 Addr, std::string& Name)
+{
+    // Names are restricted so that they can't escape storage directory
+    for(size_t i=0; i<=MaxNameLength; i++) {
+        const char C = char(RAM.Read(U16(Addr+i)));
+        if(C == 0)
+            return !Name.empty() && Name[0] != '.';
+        if(!std::isalnum(static_cast<unsigned char>(C)) && C != '.' && C != '_' && C != '-')
+            return false;
+        Name.push_back(C);
+    }
+    return false;
+}
+
+U16 Storage::ReadWord(const U16 Addr)
+{
+    return RAM.Read(Addr) | RAM.Read(U16(Addr+1)) << 8;
+}
+
+void Storage::WriteWord(const U16 Addr, const U16 Value)
+{
+    RAM.Write(Addr, Value & 0xFF);
+    RAM.Write(U16(Addr+1), Value >> 8);
+}
@@ -0,0 +1,59 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <string>
+#include <vector>
+#include "common.h"
+#include "device.h"
+
+// File storage backed by a host directory.
+// Commands transfer whole files between host and memory described by a
+// file control block. Like DMA transfers they halt the CPU for a fixed
+// number of cycles per byte and are complete before the next instruction.
+class Storage : public Device
+{
+public:
+    Storage(class CPU* InCPU);
+
+    enum Result {
+        OK           = 0,
+        NotFound     = 1,
+        TooLarge     = 2,
+        InvalidName  = 3,
+        IOError      = 4,
+        InvalidCmd   = 5,
+    };
+
+    U16 Block;
+    U8  Control;
+    U8  Status;
+
+    // Transfer cost in CPU cycles per byte
+    static const U32 TransferCycles = 2;
+    // Maximum length of file name
+    static const size_t MaxNameLength = 16;
+
+private:
+    U8   ReadRegister(U8 Reg);
+    void WriteRegister(U8 Reg, U8 Data);
+
+    Result Execute(const U8 Command);
+    Result Load(const std::string& Path, const U16 Addr, U16& Length);
+    Result Save(const std::string& Path, const U16 Addr, U16& Length);
+
+    bool ReadName(const U16 Addr, std::string& Name);
+    U16  ReadWord(const U16 Addr);
+    void WriteWord(const U16 Addr, const U16 Value);
+
+    std::string     Directory;
+    std::vector<U8> Buffer;
+    // Set while a command is executed, commands can't start themselves
+    bool Busy;
+};
+
+#endif // STORAGE_H
@@ -0,0 +1,84 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cmath>
+#include <algorithm>
+#include "synth.h"
+
+namespace {
+    const double Pi = 3.14159265358979;
+
+    // Fraction of Nyquist frequency passed through
+    const double Cutoff = 0.9;
+}
+
+BandLimitedSynth::BandLimitedSynth(const size_t InCapacity)
+    : Kernel(Phases * Taps)
+    , Deltas(InCapacity + Taps, 0.0f)
+    , Direct(InCapacity + Taps, 0.0f)
+    , Accumulator(0.0f)
+{
+    // Blackman windowed sinc impulse, one set of taps per sub-sample phase
+    for(int Phase=0; Phase<Phases; Phase++) {
+        float* Impulse = &Kernel[Phase * Taps];
+        double Sum   = 0.0;
+
+        for(int Tap=0; Tap<Taps; Tap++) {
+            const double X      = Tap - (Taps/2 - 1) - double(Phase)/Phases;
+            const double W      = 0.5 + 0.5 * X/(Taps/2);
+            const double Window = 0.42 - 0.5*std::cos(2*Pi*W) + 0.08*std::cos(4*Pi*W);
+            const double Sinc   = X == 0.0 ? 1.0 : std::sin(Pi*Cutoff*X) / (Pi*Cutoff*X);
+
+            Impulse[Tap] = Sinc * std::max(Window, 0.0);
+            Sum += Impulse[Tap];
+        }
+        for(int Tap=0; Tap<Taps; Tap++) {
+            Impulse[Tap] /= Sum;
+        }
+    }
+}
+
+void BandLimitedSynth::AddStep(const double Time, const float Delta)
+{
+    const size_t Index = size_t(Time);
+    const int    Phase = int((Time - Index) * Phases);
+
+    if(Index >= Capacity())
+        return;
+
+    const float* Impulse = &Kernel[Phase * Taps];
+    float*       Output  = &Deltas[Index];
+    for(int Tap=0; Tap<Taps; Tap++) {
+        Output[Tap] += Delta * Impulse[Tap];
+    }
+}
+
+void BandLimitedSynth::AddSample(const size_t Index, const float Value)
+{
+    if(Index < Capacity()) {
+        Direct[Index + Taps/2 - 1] += Value;
+    }
+}
+
+size_t BandLimitedSynth::SamplesReady(const double Time) const
+{
+    return std::min(size_t(Time), Capacity());
+}
+
+size_t BandLimitedSynth::ReadSamples(float* Output, size_t Count)
+{
+    Count = std::min(Count, Capacity());
+
+    for(size_t i=0; i<Count; i++) {
+        Accumulator += Deltas[i];
+        Output[i] = Accumulator + Direct[i];
+    }
+
+    std::copy(Deltas.begin() + Count, Deltas.end(), Deltas.begin());
+    std::copy(Direct.begin() + Count, Direct.end(), Direct.begin());
+    std::fill(Deltas.end() - Count, Deltas.end(), 0.0f);
+    std::fill(Direct.end() - Count, Direct.end(), 0.0f);
+    return Count;
+}
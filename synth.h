@@ -0,0 +1,43 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <vector>
+#include "common.h"
+
+// Band-limited step synthesizer.
+// Amplitude steps placed at fractional output sample positions are
+// rendered as windowed-sinc impulses and integrated, which also makes
+// it a resampler from emulated clock timeline to host sample rate.
+class BandLimitedSynth
+{
+public:
+    static const int Taps   = 16;
+    static const int Phases = 64;
+
+    BandLimitedSynth(const size_t InCapacity=4096);
+
+    // Add amplitude step at given position (in output samples)
+    void AddStep(const double Time, const float Delta);
+    // Add already band-limited sample value at given output sample
+    void AddSample(const size_t Index, const float Value);
+
+    // Number of samples that can't be affected by steps at or after Time
+    size_t SamplesReady(const double Time) const;
+    // Remove finished samples from the buffer
+    size_t ReadSamples(float* Output, size_t Count);
+
+    size_t Capacity() const { return Deltas.size() - Taps; }
+
+private:
+    std::vector<float> Kernel;
+    std::vector<float> Deltas;
+    std::vector<float> Direct;
+    float Accumulator;
+};
+
+#endif // SYNTH_H
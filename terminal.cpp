@@ -0,0 +1,157 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cstring>
+#include "cpu.h"
+#include "terminal.h"
+
+#ifdef _WIN32
+#include <conio.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+namespace {
+    const U8 KeyCR    = 0x0D;
+    const U8 KeyBS    = 0x08;
+    const U8 KeyESC   = 0x1B;
+    const U8 KeyRight = 0x0E;
+    const U8 KeyLeft  = 0x0F;
+    const U8 KeyUp    = 0x10;
+    const U8 KeyDown  = 0x11;
+}
+
+Terminal::Terminal(CPU* InCPU)
+    : TheCPU(*InCPU)
+    , FrameAddr(0)
+    , Invalid(true)
+    , RestoreMode(false)
+{
+#ifdef _WIN32
+    HANDLE Console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD  Mode;
+    if(GetConsoleMode(Console, &Mode)) {
+        SavedMode   = Mode;
+        RestoreMode = true;
+        SetConsoleMode(Console, Mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+    SetConsoleOutputCP(CP_UTF8);
+#else
+    if(isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &SavedMode) == 0) {
+        struct termios Mode = SavedMode;
+        Mode.c_lflag &= ~(ICANON | ECHO);
+        Mode.c_cc[VMIN]  = 0;
+        Mode.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &Mode);
+        RestoreMode = true;
+    }
+    else {
+        fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+    }
+#endif
+
+    // Hide cursor & clear screen
+    std::fputs("\x1b[?25l\x1b[2J", stdout);
+    std::fflush(stdout);
+}
+
+Terminal::~Terminal()
+{
+    std::printf("\x1b[%d;1H\x1b[?25h\n", VPU::TextRows+1);
+    std::fflush(stdout);
+
+    if(RestoreMode) {
+#ifdef _WIN32
+        SetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), SavedMode);
+#else
+        tcsetattr(STDIN_FILENO, TCSANOW, &SavedMode);
+#endif
+    }
+}
+
+void Terminal::Update()
+{
+    ReadInput();
+    DrawScreen();
+}
+
+void Terminal::ReadInput()
+{
+    char Buffer[64];
+    int  Length = 0;
+
+#ifdef _WIN32
+    while(Length < int(sizeof(Buffer)) && _kbhit()) {
+        Buffer[Length++] = _getch();
+    }
+#else
+    Length = read(STDIN_FILENO, Buffer, sizeof(Buffer));
+#endif
+
+    // Pasted text may arrive faster than guest reads it, so it is queued
+    std::string Keys;
+    for(int i=0; i<Length; i++) {
+        U8 Code = Buffer[i];
+
+        if(Code == KeyESC && i+2 < Length && Buffer[i+1] == '[') {
+            switch(Buffer[i+2]) {
+            case 'A': Code = KeyUp;    break;
+            case 'B': Code = KeyDown;  break;
+            case 'C': Code = KeyRight; break;
+            case 'D': Code = KeyLeft;  break;
+            }
+            if(Code != KeyESC) {
+                i += 2;
+            }
+        }
+        else if(Code == '\n') {
+            Code = KeyCR;
+        }
+        else if(Code == 0x7F) {
+            Code = KeyBS;
+        }
+        Keys.push_back(char(Code));
+    }
+    if(!Keys.empty()) {
+        TheCPU.Kbd.InjectText(Keys);
+    }
+}
+
+void Terminal::DrawScreen()
+{
+    if(FrameAddr != TheCPU.Video.FrameAddr) {
+        FrameAddr = TheCPU.Video.FrameAddr;
+        Invalid   = true;
+    }
+
+    Output.clear();
+
+    int CursorIndex = -1;
+    for(int Index=0; Index < int(sizeof(Shadow)); Index++) {
+        const U8 Code = TheCPU.RAM.Memory[U16(FrameAddr + Index)];
+        if(!Invalid && Shadow[Index] == Code)
+            continue;
+
+        if(Index != CursorIndex) {
+            char Position[16];
+            std::snprintf(Position, sizeof(Position), "\x1b[%d;%dH", Index/VPU::TextColumns+1, Index%VPU::TextColumns+1);
+            Output.append(Position);
+        }
+
+        Shadow[Index] = Code;
+        Output.append(VPU::GlyphToText(Code));
+
+        // Terminal cursor stays put after writing the last column
+        CursorIndex = (Index+1) % VPU::TextColumns ? Index+1 : -1;
+    }
+    Invalid = false;
+
+    if(!Output.empty()) {
+        std::fwrite(Output.data(), 1, Output.size(), stdout);
+        std::fflush(stdout);
+    }
+}
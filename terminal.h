@@ -0,0 +1,48 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include <string>
+#include "common.h"
+#include "vpu.h"
+
+#ifndef _WIN32
+#include <termios.h>
+#endif
+
+class CPU;
+
+// ANSI terminal frontend for text mode screen
+class Terminal
+{
+public:
+    Terminal(CPU* InCPU);
+    ~Terminal();
+
+    void Update();
+
+private:
+    void ReadInput();
+    void DrawScreen();
+
+    CPU& TheCPU;
+
+    U16  FrameAddr;
+    U8   Shadow[VPU::TextRows * VPU::TextColumns];
+    bool Invalid;
+
+    std::string Output;
+
+#ifdef _WIN32
+    unsigned long SavedMode;
+#else
+    struct termios SavedMode;
+#endif
+    bool RestoreMode;
+};
+
+#endif // TERMINAL_H
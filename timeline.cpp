@@ -0,0 +1,108 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cstdio>
+#include "timeline.h"
+
+namespace {
+    // Both time axes are separate processes of the trace
+    enum ProcessId {
+        ProcessHost = 1,
+        ProcessEmulated,
+    };
+
+    struct EventInfo {
+        const char* Name;
+        const char* Category;
+        bool        Duration;
+    };
+
+    const EventInfo EventInfos[] = {
+        { "Interrupt",    "cpu",    false },
+        { "Keyboard IRQ", "input",  false },
+        { "Frame",        "video",  true  },
+        { "Present",      "video",  true  },
+        { "Sleep",        "pacing", true  },
+        { "Audio block",  "audio",  true  },
+        { "Underrun",     "audio",  false },
+    };
+
+    const char* InterruptNames[] = { "None", "RESET", "NMI", "IRQ", "BRK" };
+
+    const char* ArgNames[] = { "addr", "key", "frame", "frame", "requested_ms", "samples", "underruns" };
+}
+
+Timeline::Timeline()
+    : Enabled(false)
+    , Origin(std::chrono::steady_clock::now())
+    , Dropped(0)
+{}
+
+void Timeline::Add(const U8 Type, const U8 Thread, const U64 HostTime, const U64 HostDuration, const U64 Cycle, const U32 CycleDuration,
+                   const U32 Arg, const U32 Arg2, const float Value)
+{
+    std::lock_guard<std::mutex> Guard(Lock);
+    if(Events.size() >= MaxEvents) {
+        Dropped++;
+        return;
+    }
+    Events.push_back({HostTime, HostDuration, Cycle, CycleDuration, Type, Thread, Arg, Arg2, Value});
+}
+
+bool Timeline::Save(const char* FileName, const U32 Frequency) const
+{
+    std::FILE* File = std::fopen(FileName, "w");
+    if(!File)
+        return false;
+
+    std::lock_guard<std::mutex> Guard(Lock);
+
+    std::fprintf(File, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    std::fprintf(File, "{\"ph\":\"M\",\"pid\":%d,\"name\":\"process_name\",\"args\":{\"name\":\"Host time\"}},\n", ProcessHost);
+    std::fprintf(File, "{\"ph\":\"M\",\"pid\":%d,\"name\":\"process_name\",\"args\":{\"name\":\"Emulated time\"}},\n", ProcessEmulated);
+    for(int Pid=ProcessHost; Pid<=ProcessEmulated; Pid++) {
+        std::fprintf(File, "{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"CPU\"}},\n", Pid, ThreadCPU);
+        std::fprintf(File, "{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"Synthesis\"}},\n", Pid, ThreadSynth);
+    }
+
+    // Timestamps are in microseconds
+    const double CycleTime = 1e6 / Frequency;
+    for(const Event& E : Events) {
+        const EventInfo& Info = EventInfos[E.Type];
+        const char* Name = (E.Type == EventInterrupt && E.Arg < 5) ? InterruptNames[E.Arg] : Info.Name;
+
+        const U32 Value = (E.Type == EventInterrupt) ? E.Arg2 : E.Arg;
+
+        char Args[128];
+        std::snprintf(Args, sizeof(Args), "\"cycle\":%llu,\"host_ns\":%llu,\"%s\":%u",
+                      (unsigned long long)E.Cycle, (unsigned long long)E.HostTime, ArgNames[E.Type], Value);
+
+        for(int Pid=ProcessHost; Pid<=ProcessEmulated; Pid++) {
+            const double Time     = (Pid == ProcessHost) ? E.HostTime / 1e3 : E.Cycle * CycleTime;
+            const double Duration = (Pid == ProcessHost) ? E.HostDuration / 1e3 : E.CycleDuration * CycleTime;
+
+            std::fprintf(File, "{\"name\":\"%s\",\"cat\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,", Name, Info.Category, Pid, E.Thread, Time);
+            if(Info.Duration)
+                std::fprintf(File, "\"ph\":\"X\",\"dur\":%.3f,\"args\":{%s}},\n", Duration, Args);
+            else
+                std::fprintf(File, "\"ph\":\"i\",\"s\":\"t\",\"args\":{%s}},\n", Args);
+
+            if(E.Type == EventAudioBlock) {
+                std::fprintf(File, "{\"name\":\"Audio buffer\",\"cat\":\"audio\",\"ph\":\"C\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"args\":{\"fill\":%.3f}},\n",
+                             Pid, E.Thread, Time + Duration, E.Value);
+            }
+        }
+    }
+
+    // Trailing metadata keeps the array free of a dangling comma
+    std::fprintf(File, "{\"ph\":\"M\",\"pid\":%d,\"name\":\"process_sort_index\",\"args\":{\"sort_index\":%d}}\n]}\n", ProcessHost, 0);
+    const bool Result = !std::ferror(File);
+    std::fclose(File);
+
+    std::printf("Timeline of %lu events written to %s\n", (unsigned long)Events.size(), FileName);
+    if(Dropped > 0)
+        std::printf("Timeline was full, %llu later events were dropped\n", (unsigned long long)Dropped);
+    return Result;
+}
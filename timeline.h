@@ -0,0 +1,86 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include "common.h"
+
+// Timestamped events of emulated and host time: interrupts, frames, audio
+// blocks and real time pacing. Events may be recorded from any emulator thread
+// and are exported as Chrome trace JSON (chrome://tracing, Perfetto).
+class Timeline
+{
+public:
+    Timeline();
+
+    enum EventType {
+        EventInterrupt = 0, // Arg: CPU::InterruptType, Arg2: return address
+        EventKeyboardIRQ,   // Arg: key code
+        EventFrame,         // Arg: frame number
+        EventPresent,       // Arg: frame number
+        EventSleep,         // Arg: requested milliseconds
+        EventAudioBlock,    // Arg: samples, Value: output buffer fill
+        EventUnderrun,      // Arg: underruns so far
+    };
+
+    enum ThreadId {
+        ThreadCPU = 1,
+        ThreadSynth,
+    };
+
+    // Host time in nanoseconds since emulator start
+    U64 Now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Origin).count();
+    }
+
+    // Event at the current instant
+    void Instant(const EventType Type, const ThreadId Thread, const U64 Cycle, const U32 Arg, const U32 Arg2=0)
+    {
+        Add(Type, Thread, Now(), 0, Cycle, 0, Arg, Arg2, 0.0f);
+    }
+    // Event lasting from given host time & cycle until now
+    void Complete(const EventType Type, const ThreadId Thread, const U64 HostStart, const U64 CycleStart, const U64 CycleEnd,
+                  const U32 Arg, const float Value=0.0f)
+    {
+        Add(Type, Thread, HostStart, Now() - HostStart, CycleStart, U32(CycleEnd - CycleStart), Arg, 0, Value);
+    }
+
+    // Writes events on host and emulated time axes, Frequency converts cycles to time
+    bool Save(const char* FileName, const U32 Frequency) const;
+
+    bool Enabled;
+
+    // Events kept, later ones are dropped
+    static const size_t MaxEvents = 1 << 20;
+
+private:
+    struct Event {
+        U64   HostTime;
+        U64   HostDuration;
+        U64   Cycle;
+        U32   CycleDuration;
+        U8    Type;
+        U8    Thread;
+        U32   Arg;
+        U32   Arg2;
+        float Value;
+    };
+
+    void Add(const U8 Type, const U8 Thread, const U64 HostTime, const U64 HostDuration, const U64 Cycle, const U32 CycleDuration,
+             const U32 Arg, const U32 Arg2, const float Value);
+
+    std::chrono::steady_clock::time_point Origin;
+
+    mutable std::mutex Lock;
+    std::vector<Event> Events;
+    U64 Dropped;
+};
+
+#endif // TIMELINE_H
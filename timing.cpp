@@ -0,0 +1,143 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include "cpu.h"
+#include "timing.h"
+
+namespace {
+    // Base cycle counts of NMOS 6502 opcodes. Undefined opcodes execute as
+    // two cycle NOPs, WAI ($CB) is available in both modes. BRK is charged
+    // when the interrupt is serviced.
+    const U8 CyclesNMOS[256] = {
+    //  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF
+         0, 6, 2, 2, 2, 3, 5, 2, 3, 2, 2, 2, 2, 4, 6, 2, // 0x
+         2, 5, 2, 2, 2, 4, 6, 2, 2, 4, 2, 2, 2, 4, 7, 2, // 1x
+         6, 6, 2, 2, 3, 3, 5, 2, 4, 2, 2, 2, 4, 4, 6, 2, // 2x
+         2, 5, 2, 2, 2, 4, 6, 2, 2, 4, 2, 2, 2, 4, 7, 2, // 3x
+         6, 6, 2, 2, 2, 3, 5, 2, 3, 2, 2, 2, 3, 4, 6, 2, // 4x
+         2, 5, 2, 2, 2, 4, 6, 2, 2, 4, 2, 2, 2, 4, 7, 2, // 5x
+         6, 6, 2, 2, 2, 3, 5, 2, 4, 2, 2, 2, 5, 4, 6, 2, // 6x
+         2, 5, 2, 2, 2, 4, 6, 2, 2, 4, 2, 2, 2, 4, 7, 2, // 7x
+         2, 6, 2, 2, 3, 3, 3, 2, 2, 2, 2, 2, 4, 4, 4, 2, // 8x
+         2, 6, 2, 2, 4, 4, 4, 2, 2, 5, 2, 2, 2, 5, 2, 2, // 9x
+         2, 6, 2, 2, 3, 3, 3, 2, 2, 2, 2, 2, 4, 4, 4, 2, // Ax
+         2, 5, 2, 2, 4, 4, 4, 2, 2, 4, 2, 2, 4, 4, 4, 2, // Bx
+         2, 6, 2, 2, 3, 3, 5, 2, 2, 2, 2, 3, 4, 4, 6, 2, // Cx
+         2, 5, 2, 2, 2, 4, 6, 2, 2, 4, 2, 2, 2, 4, 7, 2, // Dx
+         2, 6, 2, 2, 3, 3, 5, 2, 2, 2, 2, 2, 4, 4, 6, 2, // Ex
+         2, 5, 2, 2, 2, 4, 6, 2, 2, 4, 2, 2, 2, 4, 7, 2, // Fx
+    };
+
+    // Base cycle counts of WDC 65C02 opcodes, including bit instructions
+    // RMB, SMB, BBR & BBS ($x7 & $xF). Undefined opcodes are NOPs.
+    const U8 CyclesCMOS[256] = {
+    //  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF
+         0, 6, 2, 1, 5, 3, 5, 5, 3, 2, 2, 1, 6, 4, 6, 5, // 0x
+         2, 5, 5, 1, 5, 4, 6, 5, 2, 4, 2, 1, 6, 4, 6, 5, // 1x
+         6, 6, 2, 1, 3, 3, 5, 5, 4, 2, 2, 1, 4, 4, 6, 5, // 2x
+         2, 5, 5, 1, 4, 4, 6, 5, 2, 4, 2, 1, 4, 4, 6, 5, // 3x
+         6, 6, 2, 1, 3, 3, 5, 5, 3, 2, 2, 1, 3, 4, 6, 5, // 4x
+         2, 5, 5, 1, 4, 4, 6, 5, 2, 4, 3, 1, 8, 4, 6, 5, // 5x
+         6, 6, 2, 1, 3, 3, 5, 5, 4, 2, 2, 1, 6, 4, 6, 5, // 6x
+         2, 5, 5, 1, 4, 4, 6, 5, 2, 4, 4, 1, 6, 4, 6, 5, // 7x
+         2, 6, 2, 1, 3, 3, 3, 5, 2, 2, 2, 1, 4, 4, 4, 5, // 8x
+         2, 6, 5, 1, 4, 4, 4, 5, 2, 5, 2, 1, 4, 5, 5, 5, // 9x
+         2, 6, 2, 1, 3, 3, 3, 5, 2, 2, 2, 1, 4, 4, 4, 5, // Ax
+         2, 5, 5, 1, 4, 4, 4, 5, 2, 4, 2, 1, 4, 4, 4, 5, // Bx
+         2, 6, 2, 1, 3, 3, 5, 5, 2, 2, 2, 3, 4, 4, 6, 5, // Cx
+         2, 5, 5, 1, 4, 4, 6, 5, 2, 4, 3, 3, 4, 4, 7, 5, // Dx
+         2, 6, 2, 1, 3, 3, 5, 5, 2, 2, 2, 1, 4, 4, 6, 5, // Ex
+         2, 5, 5, 1, 4, 4, 6, 5, 2, 4, 4, 1, 4, 4, 7, 5, // Fx
+    };
+
+    inline bool PageCrossed(const U16 Base, const U16 Addr)
+    {
+        return (Base ^ Addr) & 0xFF00;
+    }
+
+    // Branches don't change flags, so condition can be evaluated afterwards.
+    // Bits 6-7 of opcode select the flag, bit 5 the value taking the branch.
+    inline bool BranchTaken(const CPU& TheCPU, const U8 OpCode)
+    {
+        if(OpCode == 0x80)
+            return true;
+        bool Flag = false;
+        switch(OpCode >> 6) {
+        case 0: Flag = TheCPU.Flags.S; break;
+        case 1: Flag = TheCPU.Flags.V; break;
+        case 2: Flag = TheCPU.Flags.C; break;
+        case 3: Flag = TheCPU.Flags.Z; break;
+        }
+        return Flag == bool(OpCode & 0x20);
+    }
+}
+
+void ExactTiming::Account(CPU& TheCPU, const U8 OpCode, const U16 OpAddr, const U32 StartCycles)
+{
+    const bool CMOS = TheCPU.Settings.CMOS;
+    const MCC& RAM  = TheCPU.RAM;
+    U32 Cycles = StartCycles + (CMOS ? CyclesCMOS : CyclesNMOS)[OpCode];
+
+    // Operands are read back from memory, instruction has already executed
+    const U16 Absolute = RAM.Peek(U16(OpAddr+1)) | RAM.Peek(U16(OpAddr+2)) << 8;
+    const U8  ZeroPage = RAM.Peek(U16(OpAddr+1));
+
+    switch(OpCode) {
+    // Branches: +1 if taken, +1 more if target is on another page
+    case 0x80:
+        if(!CMOS) break;
+        // fall through
+    case 0x10: case 0x30: case 0x50: case 0x70:
+    case 0x90: case 0xB0: case 0xD0: case 0xF0: {
+        // Taken branch with zero offset ends up at next instruction too
+        const U16 Next = OpAddr + 2;
+        if(BranchTaken(TheCPU, OpCode))
+            Cycles += 1 + PageCrossed(Next, TheCPU.PC);
+    } break;
+
+    // BBR & BBS: +1 if taken, +1 more if target is on another page
+    case 0x0F: case 0x1F: case 0x2F: case 0x3F: case 0x4F: case 0x5F: case 0x6F: case 0x7F:
+    case 0x8F: case 0x9F: case 0xAF: case 0xBF: case 0xCF: case 0xDF: case 0xEF: case 0xFF: {
+        if(!CMOS) break;
+        const U16 Next  = OpAddr + 3;
+        const bool Set  = (RAM.Peek(ZeroPage) >> ((OpCode >> 4) & 7)) & 1;
+        if(Set == bool(OpCode & 0x80))
+            Cycles += 1 + PageCrossed(Next, TheCPU.PC);
+    } break;
+
+    // Reads indexed by X
+    case 0x1E: case 0x3E: case 0x5E: case 0x7E: case 0x3C:
+        if(!CMOS) break;
+        // fall through
+    case 0x1D: case 0x3D: case 0x5D: case 0x7D:
+    case 0xBC: case 0xBD: case 0xDD: case 0xFD:
+        Cycles += PageCrossed(Absolute, Absolute + TheCPU.X);
+        break;
+
+    // Reads indexed by Y
+    case 0x19: case 0x39: case 0x59: case 0x79:
+    case 0xB9: case 0xBE: case 0xD9: case 0xF9:
+        Cycles += PageCrossed(Absolute, Absolute + TheCPU.Y);
+        break;
+
+    // Reads indexed by Y through zero page pointer
+    case 0x11: case 0x31: case 0x51: case 0x71:
+    case 0xB1: case 0xD1: case 0xF1: {
+        const U16 Pointer = RAM.Peek(ZeroPage) | RAM.Peek(U8(ZeroPage+1)) << 8;
+        Cycles += PageCrossed(Pointer, Pointer + TheCPU.Y);
+    } break;
+    }
+
+    // 65C02 takes an extra cycle for decimal mode ADC & SBC
+    if(CMOS && TheCPU.Flags.D && (OpCode & 0x60) == 0x60) {
+        switch(OpCode & 0x1F) {
+        case 0x01: case 0x05: case 0x09: case 0x0D:
+        case 0x11: case 0x12: case 0x15: case 0x19: case 0x1D:
+            Cycles += 1;
+        }
+    }
+
+    TheCPU.Cycles = Cycles;
+}
@@ -0,0 +1,39 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "common.h"
+
+class CPU;
+
+// CPU timing policies, selected at compile time by CPU::Step<Timing>.
+// Account() is called after each instruction with cycle counter value from
+// before the instruction and address of its opcode.
+
+// Approximate timing: cycles charged by addressing mode helpers as they go,
+// interrupt entry adds InterruptCycles on top of its stack pushes.
+struct FastTiming
+{
+    enum { InterruptCycles = 3 };
+
+    static void Account(CPU& TheCPU, const U8 OpCode, const U16 OpAddr, const U32 StartCycles)
+    {
+        UNUSED(TheCPU); UNUSED(OpCode); UNUSED(OpAddr); UNUSED(StartCycles);
+    }
+};
+
+// Exact timing: documented per-opcode cycle counts, including penalties
+// for taken branches and indexed reads crossing a page boundary.
+// Interrupt entry takes InterruptCycles in total.
+struct ExactTiming
+{
+    enum { InterruptCycles = 7 };
+
+    static void Account(CPU& TheCPU, const U8 OpCode, const U16 OpAddr, const U32 StartCycles);
+};
+
+#endif // TIMING_H
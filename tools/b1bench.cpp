@@ -0,0 +1,551 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include "cpu.h"
+
+namespace {
+    // Guest code of synthetic workloads is placed here and entered from JMON prompt
+    const U16 CodeAddr = 0x0300;
+
+    // Emulated time from power on to JMON prompt
+    const double BootSeconds   = 0.5;
+    // Emulated time given to typed commands to start running
+    const double SettleSeconds = 0.2;
+
+    // Tiny BASIC keeps variable X at 2*'X'
+    const U16 BasicVariableR = 2*'R';
+
+    struct Workload {
+        const char* Name;
+        const char* Description;
+        // Typed at JMON prompt, {CR} escapes allowed
+        const char* Keys;
+        // Copied to CodeAddr and jumped to instead of typing
+        std::vector<U8> Code;
+        // Typed again whenever previous keys have been consumed, each time is a round
+        const char* Repeat;
+        // Address of 16-bit guest counter of rounds, if not zero
+        U16 Counter;
+    };
+
+    const char* QuickFox = "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789\r";
+
+    std::vector<Workload> StandardWorkloads()
+    {
+        std::vector<Workload> Workloads;
+
+        Workloads.push_back({"memtest", "JMON memory test of $1000-$8FFF", "T1000 8FFF", {}, nullptr, 0});
+        Workloads.push_back({"demo", "Raster bar demo at $B000", "GB000", {}, nullptr, 0});
+
+        Workloads.push_back({"basic-arith", "Tiny BASIC integer arithmetic loop",
+            "I"
+            "10 LET S=0{CR}"
+            "20 LET I=1{CR}"
+            "30 LET S=S+I*I/3-I/7*2{CR}"
+            "40 LET T=-I*13/(I+1){CR}"
+            "50 LET I=I+1{CR}"
+            "60 IF I<300 GOTO 30{CR}"
+            "70 GOTO 10{CR}"
+            "RUN{CR}", {}, nullptr, 0});
+        Workloads.push_back({"basic-print", "Tiny BASIC printing and scrolling",
+            "I"
+            "10 LET I=0{CR}"
+            "20 PRINT I,I*2,I*3,\"B1 BENCH\"{CR}"
+            "30 LET I=I+1{CR}"
+            "40 GOTO 20{CR}"
+            "RUN{CR}", {}, nullptr, 0});
+        Workloads.push_back({"basic-gosub", "Tiny BASIC subroutine calls and comparisons",
+            "I"
+            "10 LET A=0{CR}"
+            "20 GOSUB 100{CR}"
+            "30 IF A<1000 GOTO 20{CR}"
+            "40 GOTO 10{CR}"
+            "100 IF A/2*2=A GOSUB 200{CR}"
+            "110 LET A=A+1{CR}"
+            "120 RETURN{CR}"
+            "200 LET B=A*3{CR}"
+            "210 RETURN{CR}"
+            "RUN{CR}", {}, nullptr, 0});
+
+        // Arithmetic, logic & shifts on zero page
+        Workloads.push_back({"mix-alu", "Synthetic ALU opcode mix", nullptr, {
+            0xA2, 0x00,             //      LDX #$00
+            0xA0, 0x00,             //      LDY #$00
+            0x18,                   // loop CLC
+            0xA5, 0x10,             //      LDA $10
+            0x65, 0x11,             //      ADC $11
+            0x85, 0x10,             //      STA $10
+            0x45, 0x12,             //      EOR $12
+            0x29, 0x7F,             //      AND #$7F
+            0x09, 0x01,             //      ORA #$01
+            0x0A, 0x4A, 0x2A, 0x6A, //      ASL A, LSR A, ROL A, ROR A
+            0x38,                   //      SEC
+            0xE5, 0x13,             //      SBC $13
+            0x85, 0x12,             //      STA $12
+            0xE6, 0x11,             //      INC $11
+            0xC8, 0x88, 0xE8,       //      INY, DEY, INX
+            0xD0, 0xE3,             //      BNE loop
+            0xE6, 0x13,             //      INC $13
+            0x4C, 0x04, 0x03,       //      JMP loop
+        }, nullptr, 0});
+        // Indexed & indirect indexed loads and stores
+        Workloads.push_back({"mix-memory", "Synthetic memory access opcode mix", nullptr, {
+            0xA9, 0x00, 0x85, 0x20, //       LDA #$00, STA $20
+            0xA9, 0x40, 0x85, 0x21, //       LDA #$40, STA $21
+            0xA9, 0x00, 0x85, 0x22, //       LDA #$00, STA $22
+            0xA9, 0x50, 0x85, 0x23, //       LDA #$50, STA $23
+            0xA0, 0x00,             // loop  LDY #$00
+            0xB1, 0x20,             // inner LDA ($20),Y
+            0x91, 0x22,             //       STA ($22),Y
+            0xB9, 0x00, 0x40,       //       LDA $4000,Y
+            0x99, 0x00, 0x51,       //       STA $5100,Y
+            0xBD, 0x00, 0x52,       //       LDA $5200,X
+            0x9D, 0x00, 0x53,       //       STA $5300,X
+            0xE8, 0xC8,             //       INX, INY
+            0xD0, 0xEC,             //       BNE inner
+            0xE6, 0x21,             //       INC $21
+            0xA5, 0x21,             //       LDA $21
+            0xC9, 0x48,             //       CMP #$48
+            0xD0, 0xE2,             //       BNE loop
+            0xA9, 0x40, 0x85, 0x21, //       LDA #$40, STA $21
+            0x4C, 0x10, 0x03,       //       JMP loop
+        }, nullptr, 0});
+        // Compare & branch chains, taken and not taken
+        Workloads.push_back({"mix-branch", "Synthetic branch opcode mix", nullptr, {
+            0xA2, 0x00,             //      LDX #$00
+            0x8A,                   // loop TXA
+            0x29, 0x03,             //      AND #$03
+            0xF0, 0x0A,             //      BEQ l0
+            0xC9, 0x01,             //      CMP #$01
+            0xF0, 0x08,             //      BEQ l1
+            0xC9, 0x02,             //      CMP #$02
+            0xF0, 0x06,             //      BEQ l2
+            0xD0, 0x06,             //      BNE l3
+            0xE6, 0x30,             // l0   INC $30
+            0xE6, 0x31,             // l1   INC $31
+            0xE6, 0x32,             // l2   INC $32
+            0xE6, 0x33,             // l3   INC $33
+            0xE8,                   //      INX
+            0x30, 0x02,             //      BMI skip
+            0x10, 0xE4,             //      BPL loop
+            0x4C, 0x02, 0x03,       // skip JMP loop
+        }, nullptr, 0});
+        // Subroutine calls & stack operations
+        Workloads.push_back({"mix-stack", "Synthetic stack opcode mix", nullptr, {
+            0xA2, 0x00,             //      LDX #$00
+            0x20, 0x10, 0x03,       // loop JSR sub
+            0xE8,                   //      INX
+            0x48, 0x8A, 0x48,       //      PHA, TXA, PHA
+            0x68, 0x68,             //      PLA, PLA
+            0x08, 0x28,             //      PHP, PLP
+            0x4C, 0x02, 0x03,       //      JMP loop
+            0xEA, 0xEA,             //      NOP, NOP
+            0x48,                   // sub  PHA
+            0x20, 0x17, 0x03,       //      JSR sub2
+            0x68,                   //      PLA
+            0x60,                   //      RTS
+            0xEA,                   //      NOP
+            0xA5, 0x40,             // sub2 LDA $40
+            0x69, 0x01,             //      ADC #$01
+            0x85, 0x40,             //      STA $40
+            0x60,                   //      RTS
+        }, nullptr, 0});
+
+        // Text output through BIOS jump table
+        Workload PutChr = {"bios-putchr", "BIOS PUTCHR of wrapping lines", nullptr, {
+            0xA2, 0x00,             // start LDX #$00
+            0xBD, 0x10, 0x03,       // loop  LDA text,X
+            0xF0, 0xF9,             //       BEQ start
+            0x20, 0x06, 0xFF,       //       JSR PUTCHR
+            0xE8,                   //       INX
+            0x4C, 0x02, 0x03,       //       JMP loop
+            0xEA, 0xEA,             //       NOP, NOP
+        }, nullptr, 0};
+        PutChr.Code.insert(PutChr.Code.end(), QuickFox, QuickFox + std::strlen(QuickFox) + 1);
+        Workloads.push_back(PutChr);
+
+        Workloads.push_back({"bios-scroll", "BIOS SCROLL in a loop", nullptr, {
+            0x20, 0x09, 0xFF,       // loop JSR SCROLL
+            0x4C, 0x00, 0x03,       //      JMP loop
+        }, nullptr, 0});
+
+        // Text output of guest programs, bound by BIOS PUTCHR & SCROLL
+        Workloads.push_back({"jmon-dump", "JMON memory dump, a page per round", "D0000", {}, " ", 0});
+        // LIST polls keyboard for break, so rounds are counted in variable R
+        Workloads.push_back({"basic-list", "Tiny BASIC LIST of 21 lines, a listing per round",
+            "I"
+            "1 LIST{CR}"
+            "2 LET R=R+1{CR}"
+            "3 GOTO 1{CR}"
+            "10 REM THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG{CR}"
+            "20 LET A=1{CR}"
+            "30 LET B=A*2+1{CR}"
+            "40 PRINT \"A=\",A,\" B=\",B{CR}"
+            "50 IF A<100 GOTO 70{CR}"
+            "60 LET A=0{CR}"
+            "70 LET A=A+1{CR}"
+            "80 GOSUB 200{CR}"
+            "90 GOTO 30{CR}"
+            "100 REM 0123456789 0123456789 0123456789{CR}"
+            "110 REM 0123456789 0123456789 0123456789{CR}"
+            "120 REM 0123456789 0123456789 0123456789{CR}"
+            "130 REM 0123456789 0123456789 0123456789{CR}"
+            "140 REM 0123456789 0123456789 0123456789{CR}"
+            "150 REM 0123456789 0123456789 0123456789{CR}"
+            "160 REM 0123456789 0123456789 0123456789{CR}"
+            "200 LET C=A/3{CR}"
+            "210 RETURN{CR}"
+            "RUN{CR}", {}, nullptr, BasicVariableR});
+        return Workloads;
+    }
+
+    // Host sinks, frames are rendered & audio synthesized but thrown away
+    class NullVideo : public VideoOutput
+    {
+    public:
+        void Present(const U8*, const U16, const U16, const int) override {}
+    };
+
+    class NullAudio : public AudioOutput
+    {
+    public:
+        void Write(const float*, const size_t) override {}
+    };
+
+    struct Result {
+        U64    Instructions;
+        U64    Cycles;
+        U32    Frames;
+        U64    Rounds;
+        double HostSeconds;
+
+        double MIPS() const            { return Instructions / HostSeconds / 1e6; }
+        double CyclesPerSecond() const { return Cycles / HostSeconds; }
+        double FramesPerSecond() const { return Frames / HostSeconds; }
+        double RoundsPerSecond() const { return Rounds / HostSeconds; }
+    };
+
+    // Returns number of rounds of repeated keys typed
+    U64 RunFor(CPU& TheCPU, const double Seconds, const char* Repeat = nullptr)
+    {
+        U64 Rounds = 0;
+        const U64 End = TheCPU.TotalCycles + U64(Seconds * TheCPU.Frequency);
+        while(TheCPU.TotalCycles < End) {
+            if(Repeat && !TheCPU.Kbd.IsInjecting()) {
+                TheCPU.Kbd.InjectScript(Repeat);
+                Rounds++;
+            }
+            TheCPU.Tick();
+        }
+        return Rounds;
+    }
+
+    U16 ReadCounter(const CPU& TheCPU, const U16 Addr)
+    {
+        return TheCPU.RAM.Peek(Addr) | TheCPU.RAM.Peek(Addr+1) << 8;
+    }
+
+    struct Options {
+        Config Settings;
+        double Seconds;
+        bool   Headless;
+        bool   ShowScreen;
+    };
+
+    Result Run(const Workload& Load, const Options& Opts, const std::vector<char>& Rom)
+    {
+        NullVideo Video;
+        NullAudio Audio;
+        Host Backends;
+        if(!Opts.Headless) {
+            Backends.Video = &Video;
+            Backends.Audio = &Audio;
+        }
+
+        CPU TheCPU(CPUFREQ, VIDEOHZ, Opts.Settings, Backends, Rom.data(), 0, Rom.size());
+        RunFor(TheCPU, BootSeconds);
+
+        if(Load.Keys) {
+            TheCPU.Kbd.InjectScript(Load.Keys);
+            while(TheCPU.Kbd.IsInjecting()) {
+                TheCPU.Tick();
+            }
+        }
+        else {
+            std::memcpy(&TheCPU.RAM.Memory[CodeAddr], Load.Code.data(), Load.Code.size());
+            TheCPU.PC = CodeAddr;
+        }
+        RunFor(TheCPU, SettleSeconds, Load.Repeat);
+
+        const U64 StartInstructions = TheCPU.TotalInstructions;
+        const U64 StartCycles       = TheCPU.TotalCycles;
+        const U32 StartFrame        = TheCPU.Video.Frame;
+        const U16 StartCount        = ReadCounter(TheCPU, Load.Counter);
+        const auto StartTime = std::chrono::steady_clock::now();
+
+        U64 Rounds = RunFor(TheCPU, Opts.Seconds, Load.Repeat);
+        if(Load.Counter)
+            Rounds = U16(ReadCounter(TheCPU, Load.Counter) - StartCount);
+
+        const std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - StartTime;
+        if(Opts.ShowScreen) {
+            std::printf("%s", TheCPU.Video.ReadScreenText().c_str());
+        }
+        return { TheCPU.TotalInstructions - StartInstructions, TheCPU.TotalCycles - StartCycles,
+                 TheCPU.Video.Frame - StartFrame, Rounds, Elapsed.count() };
+    }
+
+    // Finds start of value of a key in JSON text, whitespace around colon allowed
+    size_t FindValue(const std::string& Text, const char* Key)
+    {
+        const std::string Pattern = std::string("\"") + Key + "\"";
+        size_t Pos = Text.find(Pattern);
+        if(Pos == std::string::npos)
+            return Pos;
+        Pos = Text.find_first_not_of(" \t\r\n", Pos + Pattern.size());
+        if(Pos == std::string::npos || Text[Pos] != ':')
+            return std::string::npos;
+        return Text.find_first_not_of(" \t\r\n", Pos + 1);
+    }
+
+    bool FindNumber(const std::string& Text, const char* Key, double& Value)
+    {
+        const size_t Pos = FindValue(Text, Key);
+        if(Pos == std::string::npos)
+            return false;
+        char* End;
+        Value = std::strtod(Text.c_str() + Pos, &End);
+        return End != Text.c_str() + Pos;
+    }
+
+    bool FindString(const std::string& Text, const char* Key, std::string& Value)
+    {
+        const size_t Pos = FindValue(Text, Key);
+        if(Pos == std::string::npos || Text[Pos] != '"')
+            return false;
+        const size_t End = Text.find('"', Pos + 1);
+        if(End == std::string::npos)
+            return false;
+        Value = Text.substr(Pos + 1, End - Pos - 1);
+        return true;
+    }
+
+    // Reads MIPS of each workload from previous output of this tool. Workloads are
+    // the innermost objects, so layout of the file does not matter.
+    bool ReadBaseline(const char* FileName, std::map<std::string, double>& Baseline)
+    {
+        std::ifstream File(FileName);
+        if(!File)
+            return false;
+        const std::string Text((std::istreambuf_iterator<char>(File)), std::istreambuf_iterator<char>());
+
+        std::string Name;
+        double MIPS;
+        for(size_t End = Text.find('}'); End != std::string::npos; End = Text.find('}', End + 1)) {
+            const size_t Begin = Text.rfind('{', End);
+            if(Begin == std::string::npos || Text.find('}', Begin) != End)
+                continue;
+            const std::string Object = Text.substr(Begin, End - Begin);
+            if(FindString(Object, "name", Name) && FindNumber(Object, "mips", MIPS))
+                Baseline[Name] = MIPS;
+        }
+        return !Baseline.empty();
+    }
+}
+
+// Runs standard guest workloads on the ROM and reports emulator throughput
+int main(int argc, char** argv)
+{
+    Options Opts;
+    Opts.Settings.Turbo = true;
+    Opts.Seconds    = 60.0;
+    Opts.Headless   = false;
+    Opts.ShowScreen = false;
+
+    const char* RomFileName  = "rom.bin";
+    const char* OutputName   = nullptr;
+    const char* BaselineName = nullptr;
+    int    Repeats   = 3;
+    double Tolerance = 5.0;
+    std::vector<std::string> Selected;
+    bool ListOnly = false;
+
+    for(int i=1; i<argc; i++) {
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+            std::printf("Usage: %s [options] [romfile]\n\n", argv[0]);
+            std::printf("Options:\n");
+            std::printf("  -o <file>              Write results as JSON\n");
+            std::printf("  -b <file>              Compare against JSON results of a previous run\n");
+            std::printf("  -t <percent>           Slowdown against baseline reported as regression (default: 5)\n");
+            std::printf("  -w <name>              Run only given workload, may be repeated\n");
+            std::printf("  -s <seconds>           Emulated time measured per workload (default: 60)\n");
+            std::printf("  -n <count>             Runs per workload, the fastest is reported (default: 3)\n");
+            std::printf("  -l                     List workloads\n");
+            std::printf("  -v                     Show screen contents at the end of each run\n");
+            std::printf("  --headless             Run without video & audio output, frames are not rendered\n");
+            std::printf("  --cmos                 Emulate 65C02 instruction set\n");
+            std::printf("  --exact-timing         Charge documented per-instruction cycle counts\n");
+            std::printf("  --threads              Render video & synthesize audio on separate threads\n");
+            std::printf("  --hle                  Execute BIOS text output routines natively\n");
+            std::printf("  --hle-basic            Execute Tiny BASIC interpreter hot paths natively\n");
+            return 0;
+        }
+        else if(std::strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+            OutputName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "-b") == 0 && i+1 < argc) {
+            BaselineName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "-t") == 0 && i+1 < argc) {
+            Tolerance = std::atof(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "-w") == 0 && i+1 < argc) {
+            Selected.push_back(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "-s") == 0 && i+1 < argc) {
+            Opts.Seconds = std::max(std::atof(argv[++i]), 0.1);
+        }
+        else if(std::strcmp(argv[i], "-n") == 0 && i+1 < argc) {
+            Repeats = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if(std::strcmp(argv[i], "-l") == 0) {
+            ListOnly = true;
+        }
+        else if(std::strcmp(argv[i], "-v") == 0) {
+            Opts.ShowScreen = true;
+        }
+        else if(std::strcmp(argv[i], "--headless") == 0) {
+            Opts.Headless = true;
+        }
+        else if(std::strcmp(argv[i], "--cmos") == 0) {
+            Opts.Settings.CMOS = true;
+        }
+        else if(std::strcmp(argv[i], "--exact-timing") == 0) {
+            Opts.Settings.ExactTiming = true;
+        }
+        else if(std::strcmp(argv[i], "--threads") == 0) {
+            Opts.Settings.Threads = true;
+        }
+        else if(std::strcmp(argv[i], "--hle") == 0) {
+            Opts.Settings.HLE = true;
+        }
+        else if(std::strcmp(argv[i], "--hle-basic") == 0) {
+            Opts.Settings.HLEBasic = true;
+        }
+        else {
+            RomFileName = argv[i];
+        }
+    }
+
+    std::vector<Workload> Workloads = StandardWorkloads();
+    if(ListOnly) {
+        for(const Workload& Load : Workloads) {
+            std::printf("%-12s %s\n", Load.Name, Load.Description);
+        }
+        return 0;
+    }
+    if(!Selected.empty()) {
+        std::vector<Workload> Chosen;
+        for(const std::string& Name : Selected) {
+            auto It = std::find_if(Workloads.begin(), Workloads.end(), [&Name](const Workload& Load) { return Name == Load.Name; });
+            if(It == Workloads.end()) {
+                std::fprintf(stderr, "Unknown workload: %s\n", Name.c_str());
+                return 1;
+            }
+            Chosen.push_back(*It);
+        }
+        Workloads.swap(Chosen);
+    }
+
+    std::ifstream RomFile(RomFileName, std::ios::binary);
+    if(!RomFile) {
+        std::fprintf(stderr, "Could not open ROM file: %s\n", RomFileName);
+        return 1;
+    }
+    const std::vector<char> Rom((std::istreambuf_iterator<char>(RomFile)), std::istreambuf_iterator<char>());
+
+    std::map<std::string, double> Baseline;
+    if(BaselineName && !ReadBaseline(BaselineName, Baseline)) {
+        std::fprintf(stderr, "Could not read baseline file: %s\n", BaselineName);
+        return 1;
+    }
+
+    std::vector<Result> Results;
+    for(const Workload& Load : Workloads) {
+        Result Best = Run(Load, Opts, Rom);
+        for(int i=1; i<Repeats; i++) {
+            const Result Next = Run(Load, Opts, Rom);
+            if(Next.HostSeconds < Best.HostSeconds)
+                Best = Next;
+        }
+        Results.push_back(Best);
+    }
+
+    // Emulator constructors are chatty, results are printed at the end
+    std::printf("\n%-12s %10s %14s %10s %10s %10s %9s\n", "Workload", "MIPS", "Cycles/s", "Frames/s", "Rounds/s", "Host s", "Baseline");
+
+    int Regressions = 0;
+    double LogSum   = 0.0;
+    for(size_t i=0; i<Workloads.size(); i++) {
+        const Result& R = Results[i];
+        LogSum += std::log(R.MIPS());
+
+        char Change[16] = "";
+        auto It = Baseline.find(Workloads[i].Name);
+        if(It != Baseline.end()) {
+            const double Percent = (R.MIPS() / It->second - 1.0) * 100.0;
+            std::snprintf(Change, sizeof(Change), "%+.1f%%", Percent);
+            if(Percent < -Tolerance)
+                Regressions++;
+        }
+        char Rounds[16] = "";
+        if(Workloads[i].Repeat || Workloads[i].Counter)
+            std::snprintf(Rounds, sizeof(Rounds), "%.1f", R.RoundsPerSecond());
+        std::printf("%-12s %10.2f %14.0f %10.1f %10s %10.3f %9s\n", Workloads[i].Name, R.MIPS(), R.CyclesPerSecond(), R.FramesPerSecond(), Rounds, R.HostSeconds, Change);
+    }
+    const double GeoMean = std::exp(LogSum / Workloads.size());
+    std::printf("%-12s %10.2f\n", "geomean", GeoMean);
+
+    if(OutputName) {
+        std::FILE* File = std::fopen(OutputName, "w");
+        if(!File) {
+            std::fprintf(stderr, "Could not write results file: %s\n", OutputName);
+            return 2;
+        }
+        const Config& Settings = Opts.Settings;
+        std::fprintf(File, "{\n  \"emulated_seconds\": %.3f,\n  \"repeats\": %d,\n", Opts.Seconds, Repeats);
+        std::fprintf(File, "  \"headless\": %s, \"cmos\": %s, \"exact_timing\": %s, \"threads\": %s, \"hle\": %s, \"hle_basic\": %s,\n",
+                     Opts.Headless ? "true" : "false", Settings.CMOS ? "true" : "false", Settings.ExactTiming ? "true" : "false",
+                     Settings.Threads ? "true" : "false", Settings.HLE ? "true" : "false", Settings.HLEBasic ? "true" : "false");
+        std::fprintf(File, "  \"geomean_mips\": %.3f,\n  \"workloads\": [\n", GeoMean);
+        for(size_t i=0; i<Workloads.size(); i++) {
+            const Result& R = Results[i];
+            std::fprintf(File, "    {\"name\": \"%s\", \"mips\": %.3f, \"cycles_per_second\": %.0f, \"frames_per_second\": %.2f, "
+                               "\"rounds_per_second\": %.2f, \"host_seconds\": %.6f, \"instructions\": %llu, \"cycles\": %llu, "
+                               "\"frames\": %u, \"rounds\": %llu}%s\n",
+                         Workloads[i].Name, R.MIPS(), R.CyclesPerSecond(), R.FramesPerSecond(), R.RoundsPerSecond(), R.HostSeconds,
+                         (unsigned long long)R.Instructions, (unsigned long long)R.Cycles, R.Frames, (unsigned long long)R.Rounds,
+                         i+1 < Workloads.size() ? "," : "");
+        }
+        std::fprintf(File, "  ]\n}\n");
+        std::fclose(File);
+    }
+
+    if(Regressions > 0) {
+        std::printf("%d workloads slower than baseline by more than %.1f%%\n", Regressions, Tolerance);
+        return 3;
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cstring>
+#include <vector>
+#include "coverage.h"
+
+// Merges coverage files of many emulator runs and maps them to ROM sources
+int main(int argc, char** argv)
+{
+    const char* MergedName = nullptr;
+    const char* DebugName  = nullptr;
+    const char* LcovName   = nullptr;
+    std::vector<const char*> InputNames;
+
+    for(int i=1; i<argc; i++) {
+        if(std::strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+            MergedName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "-l") == 0 && i+2 < argc) {
+            DebugName = argv[++i];
+            LcovName  = argv[++i];
+        }
+        else if(argv[i][0] == '-') {
+            InputNames.clear();
+            break;
+        }
+        else {
+            InputNames.push_back(argv[i]);
+        }
+    }
+
+    if(InputNames.empty()) {
+        std::printf("Usage: %s [options] <coverage file>...\n\n", argv[0]);
+        std::printf("Options:\n");
+        std::printf("  -o <file>              Write merged coverage file\n");
+        std::printf("  -l <dbgfile> <file>    Write lcov tracefile of ROM sources described by ld65 debug file\n");
+        return 1;
+    }
+
+    Coverage Merged;
+    for(const char* Name : InputNames) {
+        if(!Merged.Load(Name)) {
+            std::fprintf(stderr, "Invalid coverage file: %s\n", Name);
+            return 2;
+        }
+    }
+
+    U32 Executed = 0;
+    for(U32 Addr=0; Addr<MEMSIZE; Addr++) {
+        Executed += Merged.IsExecuted(U16(Addr));
+    }
+    std::printf("%u files merged, %u distinct instruction addresses executed\n", U32(InputNames.size()), Executed);
+
+    if(MergedName && !Merged.Save(MergedName)) {
+        std::fprintf(stderr, "Could not write coverage file: %s\n", MergedName);
+        return 2;
+    }
+    if(DebugName && !Merged.WriteLcov(DebugName, LcovName)) {
+        return 2;
+    }
+    return 0;
+}
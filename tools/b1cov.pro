@@ -0,0 +1,15 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+TARGET = b1cov
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += b1cov.cpp \
+    $$PWD/../coverage.cpp \
+    $$PWD/../loader.cpp
+
+HEADERS += \
+    $$PWD/../coverage.h \
+    $$PWD/../loader.h
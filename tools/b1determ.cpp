@@ -0,0 +1,284 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "cpu.h"
+
+namespace {
+    // Guest code of synthetic workloads is placed here and entered from JMON prompt
+    const U16 CodeAddr = 0x0300;
+
+    // Emulated time from power on to JMON prompt
+    const double BootSeconds = 0.5;
+
+    // Synthesis thread may not have been posted the last blocks of elapsed cycles yet
+    const size_t MaxSampleLag = 4 * 256;
+
+    struct Workload {
+        const char* Name;
+        const char* Description;
+        // Typed at JMON prompt, {CR} escapes allowed
+        const char* Keys;
+        // Copied to CodeAddr and jumped to instead of typing
+        std::vector<U8> Code;
+    };
+
+    std::vector<Workload> StandardWorkloads()
+    {
+        std::vector<Workload> Workloads;
+
+        Workloads.push_back({"demo", "Raster bar demo at $B000", "GB000", {}});
+        Workloads.push_back({"basic-print", "Tiny BASIC printing and scrolling",
+            "I"
+            "10 LET I=0{CR}"
+            "20 PRINT I,I*2,I*3,\"B1 DETERM\"{CR}"
+            "30 LET I=I+1{CR}"
+            "40 GOTO 20{CR}"
+            "RUN{CR}", {}});
+
+        // Text output interleaved with beeps of changing frequency
+        Workloads.push_back({"bios-beep", "BIOS PUTCHR and BEEP in a loop", nullptr, {
+            0xE6, 0x10,             // loop INC $10
+            0xA5, 0x10,             //      LDA $10
+            0x29, 0x3F,             //      AND #$3F
+            0xAA,                   //      TAX
+            0x09, 0x40,             //      ORA #$40
+            0x20, 0x06, 0xFF,       //      JSR PUTCHR
+            0xA9, 0x01,             //      LDA #$01
+            0x20, 0x1B, 0xFF,       //      JSR BEEP
+            0x4C, 0x00, 0x03,       //      JMP loop
+        }});
+        return Workloads;
+    }
+
+    // FNV-1a, good enough to tell outputs apart
+    U64 Hash(const void* Data, const size_t Size, U64 Value = 14695981039346656037ull)
+    {
+        const U8* Bytes = static_cast<const U8*>(Data);
+        for(size_t i=0; i<Size; i++) {
+            Value = (Value ^ Bytes[i]) * 1099511628211ull;
+        }
+        return Value;
+    }
+
+    // Host sinks recording hashes of every presented frame & all samples
+    class HashVideo : public VideoOutput
+    {
+    public:
+        void Present(const U8* Pixels, const U16 Width, const U16 Height, const int Pitch) override
+        {
+            U64 Value = Hash(nullptr, 0);
+            for(U16 Y=0; Y<Height; Y++) {
+                Value = Hash(Pixels + Y*Pitch, Width*4, Value);
+            }
+            Frames.push_back(Value);
+        }
+        std::vector<U64> Frames;
+    };
+
+    class RecordAudio : public AudioOutput
+    {
+    public:
+        void Write(const float* Data, const size_t Count) override
+        {
+            Samples.insert(Samples.end(), Data, Data + Count);
+        }
+        std::vector<float> Samples;
+    };
+
+    struct Result {
+        U64 TotalCycles;
+        U64 MemoryHash;
+        std::vector<U64>   Frames;
+        std::vector<float> Samples;
+    };
+
+    void RunFor(CPU& TheCPU, const double Seconds)
+    {
+        const U64 End = TheCPU.TotalCycles + U64(Seconds * TheCPU.Frequency);
+        while(TheCPU.TotalCycles < End) {
+            TheCPU.Tick();
+        }
+    }
+
+    Result Run(const Workload& Load, Config Settings, const bool Threads, const double Seconds, const std::vector<char>& Rom)
+    {
+        HashVideo   Video;
+        RecordAudio Audio;
+        Host Backends;
+        Backends.Video = &Video;
+        Backends.Audio = &Audio;
+        Settings.Threads = Threads;
+
+        Result R;
+        {
+            CPU TheCPU(CPUFREQ, VIDEOHZ, Settings, Backends, Rom.data(), 0, Rom.size());
+            RunFor(TheCPU, BootSeconds);
+
+            if(Load.Keys) {
+                TheCPU.Kbd.InjectScript(Load.Keys);
+                while(TheCPU.Kbd.IsInjecting()) {
+                    TheCPU.Tick();
+                }
+            }
+            else {
+                std::memcpy(&TheCPU.RAM.Memory[CodeAddr], Load.Code.data(), Load.Code.size());
+                TheCPU.PC = CodeAddr;
+            }
+            RunFor(TheCPU, Seconds);
+
+            R.TotalCycles = TheCPU.TotalCycles;
+            R.MemoryHash  = Hash(TheCPU.RAM.Memory, 0x10000);
+            // Device threads are joined here, all their output is recorded
+        }
+        R.Frames.swap(Video.Frames);
+        R.Samples.swap(Audio.Samples);
+        return R;
+    }
+
+    // Threaded mode presents latest complete frame, so it may skip some
+    bool IsSubsequence(const std::vector<U64>& Part, const std::vector<U64>& Whole)
+    {
+        size_t Next = 0;
+        for(const U64 Value : Part) {
+            while(Next < Whole.size() && Whole[Next] != Value)
+                Next++;
+            if(Next == Whole.size())
+                return false;
+            Next++;
+        }
+        return true;
+    }
+
+    // Compares threaded run against single-threaded one, prints differences
+    bool Compare(const Result& Single, const Result& Threaded)
+    {
+        bool Same = true;
+        if(Single.TotalCycles != Threaded.TotalCycles || Single.MemoryHash != Threaded.MemoryHash) {
+            std::printf("  machine state differs: %llu cycles, memory %016llx vs %llu cycles, memory %016llx\n",
+                        (unsigned long long)Single.TotalCycles, (unsigned long long)Single.MemoryHash,
+                        (unsigned long long)Threaded.TotalCycles, (unsigned long long)Threaded.MemoryHash);
+            Same = false;
+        }
+        if(Threaded.Frames.empty() || !IsSubsequence(Threaded.Frames, Single.Frames)) {
+            std::printf("  frames differ: %zu threaded frames are not a sequence of %zu single-threaded ones\n",
+                        Threaded.Frames.size(), Single.Frames.size());
+            Same = false;
+        }
+
+        const size_t Common = std::min(Single.Samples.size(), Threaded.Samples.size());
+        const size_t Lag    = std::max(Single.Samples.size(), Threaded.Samples.size()) - Common;
+        const U64 SingleHash   = Hash(Single.Samples.data(), Common * sizeof(float));
+        const U64 ThreadedHash = Hash(Threaded.Samples.data(), Common * sizeof(float));
+        if(Common == 0 || Lag > MaxSampleLag || SingleHash != ThreadedHash) {
+            std::printf("  samples differ: %zu single-threaded, %zu threaded, hashes of first %zu: %016llx vs %016llx\n",
+                        Single.Samples.size(), Threaded.Samples.size(), Common,
+                        (unsigned long long)SingleHash, (unsigned long long)ThreadedHash);
+            Same = false;
+        }
+        return Same;
+    }
+}
+
+// Runs guest workloads with and without device threads and checks that
+// machine state, presented frames and synthesized audio are identical
+int main(int argc, char** argv)
+{
+    Config Settings;
+    Settings.Turbo = true;
+
+    const char* RomFileName = "rom.bin";
+    double Seconds = 10.0;
+    int Repeats    = 1;
+    std::vector<std::string> Selected;
+
+    for(int i=1; i<argc; i++) {
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+            std::printf("Usage: %s [options] [romfile]\n\n", argv[0]);
+            std::printf("Options:\n");
+            std::printf("  -w <name>              Run only given workload, may be repeated\n");
+            std::printf("  -s <seconds>           Emulated time per workload (default: 10)\n");
+            std::printf("  -n <count>             Threaded runs compared per workload (default: 1)\n");
+            std::printf("  --cmos                 Emulate 65C02 instruction set\n");
+            std::printf("  --exact-timing         Charge documented per-instruction cycle counts\n");
+            std::printf("  --hle                  Execute BIOS text output routines natively\n");
+            std::printf("  --hle-basic            Execute Tiny BASIC interpreter hot paths natively\n");
+            return 0;
+        }
+        else if(std::strcmp(argv[i], "-w") == 0 && i+1 < argc) {
+            Selected.push_back(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "-s") == 0 && i+1 < argc) {
+            Seconds = std::max(std::atof(argv[++i]), 0.1);
+        }
+        else if(std::strcmp(argv[i], "-n") == 0 && i+1 < argc) {
+            Repeats = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if(std::strcmp(argv[i], "--cmos") == 0) {
+            Settings.CMOS = true;
+        }
+        else if(std::strcmp(argv[i], "--exact-timing") == 0) {
+            Settings.ExactTiming = true;
+        }
+        else if(std::strcmp(argv[i], "--hle") == 0) {
+            Settings.HLE = true;
+        }
+        else if(std::strcmp(argv[i], "--hle-basic") == 0) {
+            Settings.HLEBasic = true;
+        }
+        else {
+            RomFileName = argv[i];
+        }
+    }
+
+    std::vector<Workload> Workloads = StandardWorkloads();
+    if(!Selected.empty()) {
+        std::vector<Workload> Chosen;
+        for(const std::string& Name : Selected) {
+            auto It = std::find_if(Workloads.begin(), Workloads.end(), [&Name](const Workload& Load) { return Name == Load.Name; });
+            if(It == Workloads.end()) {
+                std::fprintf(stderr, "Unknown workload: %s\n", Name.c_str());
+                return 1;
+            }
+            Chosen.push_back(*It);
+        }
+        Workloads.swap(Chosen);
+    }
+
+    std::ifstream RomFile(RomFileName, std::ios::binary);
+    if(!RomFile) {
+        std::fprintf(stderr, "Could not open ROM file: %s\n", RomFileName);
+        return 1;
+    }
+    const std::vector<char> Rom((std::istreambuf_iterator<char>(RomFile)), std::istreambuf_iterator<char>());
+
+    int Failures = 0;
+    for(const Workload& Load : Workloads) {
+        const Result Single = Run(Load, Settings, false, Seconds, Rom);
+        std::printf("%-12s %zu frames, %zu samples, memory %016llx\n", Load.Name,
+                    Single.Frames.size(), Single.Samples.size(), (unsigned long long)Single.MemoryHash);
+
+        for(int i=0; i<Repeats; i++) {
+            const Result Threaded = Run(Load, Settings, true, Seconds, Rom);
+            const bool Same = Compare(Single, Threaded);
+            std::printf("%-12s threaded run %d: %zu frames, %zu samples, %s\n", Load.Name, i+1,
+                        Threaded.Frames.size(), Threaded.Samples.size(), Same ? "identical" : "DIFFERENT");
+            if(!Same)
+                Failures++;
+        }
+    }
+
+    if(Failures > 0) {
+        std::printf("%d threaded runs differ from single-threaded ones\n", Failures);
+        return 3;
+    }
+    return 0;
+}
@@ -0,0 +1,447 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "cpu.h"
+
+namespace {
+    const U16 KBDCTL = 0xFD00;
+    const U16 KBDDAT = 0xFD01;
+    const U16 STBLKL = 0xFD20;
+    const U16 STBLKH = 0xFD21;
+    const U16 STCTL  = 0xFD22;
+    const U16 STERR  = 0xFD23;
+
+    // Created in current directory by storage tests
+    const char* StorageFile = "b1devtest.tmp";
+
+    // Guest code addresses of tests running the CPU
+    const U16 ResetAddr  = 0x0200;
+    const U16 ISRAddr    = 0x0300;
+    const U16 BufferAddr = 0x0400;
+
+    int Failures = 0;
+
+    void Check(const bool Condition, const char* Test, const char* What)
+    {
+        if(!Condition) {
+            std::printf("  %s: %s\n", Test, What);
+            Failures++;
+        }
+    }
+
+    // Machine without ROM, guest code is poked into memory by tests
+    std::unique_ptr<CPU> NewMachine(const std::vector<U8>& Code = {}, const std::vector<U8>& ISR = {},
+                                    const Config& Settings = Config(), const Host& Backends = Host())
+    {
+        std::unique_ptr<CPU> TheCPU(new CPU(CPUFREQ, VIDEOHZ, Settings, Backends, nullptr, 0, 0));
+        MCC& RAM = TheCPU->RAM;
+        std::memcpy(&RAM.Memory[ResetAddr], Code.data(), Code.size());
+        std::memcpy(&RAM.Memory[ISRAddr], ISR.data(), ISR.size());
+        RAM.Memory[0xFFFC] = ResetAddr & 0xFF;
+        RAM.Memory[0xFFFD] = ResetAddr >> 8;
+        RAM.Memory[0xFFFE] = ISRAddr & 0xFF;
+        RAM.Memory[0xFFFF] = ISRAddr >> 8;
+        return TheCPU;
+    }
+
+    void RunTicks(CPU& TheCPU, const int Count)
+    {
+        for(int i=0; i<Count; i++) {
+            TheCPU.Tick();
+        }
+    }
+
+    void KeyboardOrder()
+    {
+        const char* Test = "keyboard-order";
+        auto TheCPU = NewMachine();
+        MCC& RAM = TheCPU->RAM;
+
+        TheCPU->Kbd.KeyEvent('a', true, 0);
+        TheCPU->Kbd.KeyEvent('a', false, 0);
+        TheCPU->Kbd.KeyEvent('b', true, 0);
+        TheCPU->Kbd.KeyEvent('b', false, 0);
+
+        Check(RAM.Read(KBDCTL) == 0x40, Test, "first event is not a key press");
+        Check(RAM.Read(KBDDAT) == 'a',  Test, "first key is not 'a'");
+        Check(RAM.Read(KBDCTL) == 0x80, Test, "release of 'a' is not reported");
+        Check(RAM.Read(KBDDAT) == 'a',  Test, "released key is not 'a'");
+        // Release not followed by KBDDAT read must not block next press
+        Check(RAM.Read(KBDCTL) == 0x40, Test, "second event is not a key press");
+        Check(RAM.Read(KBDDAT) == 'b',  Test, "second key is not 'b'");
+        Check(RAM.Read(KBDCTL) == 0x80, Test, "release of 'b' is not reported");
+        Check(RAM.Read(KBDCTL) == 0x00, Test, "buffer is not empty");
+        Check(RAM.Read(KBDDAT) == 0x00, Test, "empty buffer returns data");
+    }
+
+    void KeyboardOverflow()
+    {
+        const char* Test = "keyboard-overflow";
+        auto TheCPU = NewMachine();
+        MCC& RAM = TheCPU->RAM;
+
+        for(size_t Key=0; Key<2*Keyboard::MaxEvents; Key++) {
+            TheCPU->Kbd.PressKey(U8('0' + Key));
+        }
+        for(size_t Key=0; Key+1<Keyboard::MaxEvents; Key++) {
+            Check(RAM.Read(KBDCTL) == 0x40,      Test, "buffered event is not a key press");
+            Check(RAM.Read(KBDDAT) == '0' + Key, Test, "buffered keys are out of order");
+        }
+        Check(RAM.Read(KBDCTL) == 0x80, Test, "overflow is not reported as release");
+        Check(RAM.Read(KBDDAT) == 0x00, Test, "overflow key code is not zero");
+        Check(RAM.Read(KBDCTL) == 0x00, Test, "events past overflow are buffered");
+    }
+
+    void KeyboardInjection()
+    {
+        const char* Test = "keyboard-injection";
+        auto TheCPU = NewMachine();
+        MCC& RAM = TheCPU->RAM;
+
+        TheCPU->Kbd.InjectText("AB\n");
+        Check(TheCPU->Kbd.IsInjecting(), Test, "text is not queued");
+        Check(RAM.Read(KBDCTL) == 0x40, Test, "poll does not press first key");
+        // Next key waits until the previous one has been read
+        Check(RAM.Read(KBDCTL) == 0x40, Test, "second poll changes status");
+        Check(RAM.Read(KBDDAT) == 'A',  Test, "first key is not 'A'");
+        Check(RAM.Read(KBDCTL) == 0x40, Test, "poll does not press second key");
+        Check(RAM.Read(KBDDAT) == 'B',  Test, "second key is not 'B'");
+        Check(RAM.Read(KBDCTL) == 0x40, Test, "poll does not press line end");
+        Check(RAM.Read(KBDDAT) == 0x0D, Test, "line feed is not typed as CR");
+        Check(!TheCPU->Kbd.IsInjecting(), Test, "text is still queued");
+        Check(RAM.Read(KBDCTL) == 0x00, Test, "buffer is not empty");
+    }
+
+    // Events arrive while IRQ is masked and are counted by ISR once it is enabled
+    int KeyboardMaskedIRQ(const U8 Control, U8* Received)
+    {
+        auto TheCPU = NewMachine({
+            0xA2, 0x00,             //      LDX #$00
+            0xA9, Control,          //      LDA #Control
+            0x8D, 0x00, 0xFD,       //      STA KBDCTL
+            0xA5, 0x10,             // wait LDA $10
+            0xF0, 0xFC,             //      BEQ wait
+            0x58,                   //      CLI
+            0x4C, 0x0C, 0x02,       // loop JMP loop
+        }, {
+            0x48,                   //      PHA
+            0xAD, 0x01, 0xFD,       //      LDA KBDDAT
+            0x9D, 0x00, 0x04,       //      STA $0400,X
+            0xE8,                   //      INX
+            0x68,                   //      PLA
+            0x40,                   //      RTI
+        });
+        RunTicks(*TheCPU, 100);
+        TheCPU->Kbd.PressKey('x');
+        TheCPU->Kbd.PressKey('y');
+        TheCPU->Kbd.PressKey('z');
+        RunTicks(*TheCPU, 100);
+        TheCPU->RAM.Memory[0x10] = 1;
+        RunTicks(*TheCPU, 1000);
+
+        std::memcpy(Received, &TheCPU->RAM.Memory[BufferAddr], 3);
+        return TheCPU->X;
+    }
+
+    void KeyboardLevelIRQ()
+    {
+        const char* Test = "keyboard-level-irq";
+        U8 Received[3];
+
+        Check(KeyboardMaskedIRQ(0x04, Received) == 3, Test, "ISR is not called once per event");
+        Check(std::memcmp(Received, "xyz", 3) == 0,   Test, "ISR received keys out of order");
+        // Edge-triggered requests made while masked are lost
+        Check(KeyboardMaskedIRQ(0x00, Received) == 0, Test, "masked edge-triggered IRQ is serviced");
+    }
+
+    // One-shot timer expires while IRQ is masked, ISR reads TMRCTL once enabled
+    int TimerMaskedIRQ(const std::vector<U8>& BeforeCLI, U8& Control)
+    {
+        std::vector<U8> Code = {
+            0xA2, 0x00,             //      LDX #$00
+            0xA9, 0x10,             //      LDA #$10
+            0x8D, 0x18, 0xFD,       //      STA TMRL
+            0xA9, 0x00,             //      LDA #$00
+            0x8D, 0x19, 0xFD,       //      STA TMRH
+            0x8D, 0x1A, 0xFD,       //      STA TMRPRE
+            0xA9, 0x41,             //      LDA #$41 (one-shot with IRQ)
+            0x8D, 0x1B, 0xFD,       //      STA TMRCTL
+            0xA5, 0x10,             // wait LDA $10
+            0xF0, 0xFC,             //      BEQ wait
+        };
+        Code.insert(Code.end(), BeforeCLI.begin(), BeforeCLI.end());
+        const U16 Loop = ResetAddr + Code.size() + 1;
+        Code.insert(Code.end(), {
+            0x58,                   //      CLI
+            0x4C, U8(Loop), U8(Loop >> 8), // loop JMP loop
+        });
+
+        auto TheCPU = NewMachine(Code, {
+            0x48,                   //      PHA
+            0xAD, 0x1B, 0xFD,       //      LDA TMRCTL
+            0x9D, 0x00, 0x04,       //      STA $0400,X
+            0xE8,                   //      INX
+            0x68,                   //      PLA
+            0x40,                   //      RTI
+        });
+        RunTicks(*TheCPU, 200);
+        TheCPU->RAM.Memory[0x10] = 1;
+        RunTicks(*TheCPU, 1000);
+
+        Control = TheCPU->RAM.Memory[BufferAddr];
+        return TheCPU->X;
+    }
+
+    void TimerLevelIRQ()
+    {
+        const char* Test = "timer-level-irq";
+        U8 Control;
+
+        Check(TimerMaskedIRQ({}, Control) == 1, Test, "ISR is not called once after masked expiry");
+        Check(Control == 0x60, Test, "ISR does not see expiry flag");
+    }
+
+    void TimerStoreAck()
+    {
+        const char* Test = "timer-store-ack";
+        U8 Control;
+
+        // Store reads TMRCTL first, acknowledging expiry before IRQ is enabled again
+        Check(TimerMaskedIRQ({
+            0xA9, 0x40,             //      LDA #$40
+            0x8D, 0x1B, 0xFD,       //      STA TMRCTL
+        }, Control) == 0, Test, "store to TMRCTL does not acknowledge expiry");
+    }
+
+    void CPUStopIgnoresInterrupts()
+    {
+        const char* Test = "cpu-stop";
+        Config Settings;
+        Settings.CMOS = true;
+        auto TheCPU = NewMachine({
+            0x58,                   //      CLI
+            0xDB,                   //      STP
+        }, {
+            0x40,                   //      RTI
+        }, Settings);
+        RunTicks(*TheCPU, 10);
+        const U16 StopPC = TheCPU->PC;
+        const U8  StopSP = TheCPU->SP;
+
+        TheCPU->SignalInterrupt(CPU::INT_NMI);
+        TheCPU->Kbd.PressKey('x');
+        RunTicks(*TheCPU, 100);
+        Check(TheCPU->PC == StopPC && TheCPU->SP == StopSP, Test, "stopped CPU serviced interrupt");
+
+        TheCPU->Reset();
+        RunTicks(*TheCPU, 1);
+        Check(TheCPU->PC != StopPC && !TheCPU->Stopped, Test, "reset did not restart CPU");
+    }
+
+    // Serial link receiving queued bytes
+    class QueueLink : public SerialLink
+    {
+    public:
+        void Send(const U8) override {}
+        bool Receive(U8& Byte) override
+        {
+            if(Bytes.empty())
+                return false;
+            Byte = Bytes.front();
+            Bytes.erase(Bytes.begin());
+            return true;
+        }
+        std::vector<U8> Bytes;
+    };
+
+    // Bytes arrive while IRQ is masked, ISR reads one byte per call once enabled
+    void SerialLevelIRQ()
+    {
+        const char* Test = "serial-level-irq";
+        QueueLink Link;
+        Host Backends;
+        Backends.Serial = &Link;
+        auto TheCPU = NewMachine({
+            0xA2, 0x00,             //      LDX #$00
+            0xA9, 0x40,             //      LDA #$40
+            0x8D, 0x2B, 0xFD,       //      STA SERCTL
+            0xA5, 0x10,             // wait LDA $10
+            0xF0, 0xFC,             //      BEQ wait
+            0x58,                   //      CLI
+            0x4C, 0x0C, 0x02,       // loop JMP loop
+        }, {
+            0x48,                   //      PHA
+            0xAD, 0x28, 0xFD,       //      LDA SERRX
+            0x9D, 0x00, 0x04,       //      STA $0400,X
+            0xE8,                   //      INX
+            0x68,                   //      PLA
+            0x40,                   //      RTI
+        }, Config(), Backends);
+        RunTicks(*TheCPU, 100);
+        Link.Bytes = { 'x', 'y', 'z' };
+        RunTicks(*TheCPU, 1000);
+        TheCPU->RAM.Memory[0x10] = 1;
+        RunTicks(*TheCPU, 1000);
+
+        Check(TheCPU->X == 3, Test, "ISR is not called once per received byte");
+        Check(std::memcmp(&TheCPU->RAM.Memory[BufferAddr], "xyz", 3) == 0, Test, "ISR received bytes out of order");
+    }
+
+    // Frames are rendered only with video output attached
+    class NullVideo : public VideoOutput
+    {
+    public:
+        void Present(const U8*, const U16, const U16, const int) override {}
+    };
+
+    void WatchVideoFetch()
+    {
+        const char* Test = "watch-video-fetch";
+        NullVideo Video;
+        Host Backends;
+        Backends.Video = &Video;
+        auto TheCPU = NewMachine({
+            0xEA,                   // loop NOP
+            0x4C, 0x00, 0x02,       //      JMP loop
+        }, {}, Config(), Backends);
+        TheCPU->Debug.SetWatchpoint(0xF000, 1, Debugger::WatchRead);
+        // Two frames, screen memory is fetched by video unit only
+        RunTicks(*TheCPU, 30000);
+        Check(TheCPU->Debug.Reason() != Debugger::StopWatchpoint, Test, "video fetch hit read watchpoint");
+    }
+
+    void WatchDMAWrite()
+    {
+        const char* Test = "watch-dma-write";
+        auto TheCPU = NewMachine({
+            0xA9, 0x00, 0x8D, 0x12, 0xFD, //      LDA #$00, STA DMADSTL
+            0xA9, 0x05, 0x8D, 0x13, 0xFD, //      LDA #$05, STA DMADSTH
+            0xA9, 0x04, 0x8D, 0x14, 0xFD, //      LDA #$04, STA DMALENL
+            0xA9, 0x00, 0x8D, 0x15, 0xFD, //      LDA #$00, STA DMALENH
+            0xA9, 0xAA, 0x8D, 0x16, 0xFD, //      LDA #$AA, STA DMAFIL
+            0xA9, 0x81, 0x8D, 0x17, 0xFD, //      LDA #$81, STA DMACTL
+            0x4C, 0x1E, 0x02,             // loop JMP loop
+        });
+        TheCPU->Debug.SetWatchpoint(0x0502, 1, Debugger::WatchWrite);
+        RunTicks(*TheCPU, 100);
+        Check(TheCPU->Debug.Reason() == Debugger::StopWatchpoint, Test, "DMA fill did not hit write watchpoint");
+        Check(TheCPU->Debug.WatchAddr() == 0x0502,                Test, "watchpoint hit at wrong address");
+    }
+
+    // Transfers into DMA registers must neither restart nor redirect themselves
+    void DMASelfWrite()
+    {
+        const char* Test = "dma-self-write";
+        auto TheCPU = NewMachine();
+        MCC& RAM = TheCPU->RAM;
+
+        // Fill writes start command to DMACTL
+        RAM.Write(0xFD12, 0x17);
+        RAM.Write(0xFD13, 0xFD);
+        RAM.Write(0xFD14, 0x01);
+        RAM.Write(0xFD15, 0x00);
+        RAM.Write(0xFD16, 0x81);
+        RAM.Write(0xFD17, 0x81);
+        Check(TheCPU->Dma.Dest == 0xFD18 && TheCPU->Dma.Length == 0, Test, "fill of DMACTL did not complete once");
+
+        // Fill overwrites its own destination address on first byte
+        RAM.Write(0xFD12, 0x12);
+        RAM.Write(0xFD13, 0xFD);
+        RAM.Write(0xFD14, 0x02);
+        RAM.Write(0xFD16, 0x55);
+        RAM.Write(0xFD17, 0x81);
+        Check(TheCPU->Dma.Dest == 0xFD14, Test, "fill of DMADST moved its destination");
+        Check(TheCPU->Dma.Length == 0,    Test, "fill of DMADST did not complete");
+    }
+
+    // File control block at $0600 for given address and length, name at $0610
+    void WriteBlock(MCC& RAM, const U16 Addr, const U16 Length)
+    {
+        const U8 Block[] = { 0x10, 0x06, U8(Addr), U8(Addr >> 8), U8(Length), U8(Length >> 8) };
+        std::memcpy(&RAM.Memory[0x0600], Block, sizeof(Block));
+        std::strcpy(reinterpret_cast<char*>(&RAM.Memory[0x0610]), StorageFile);
+        RAM.Write(STBLKL, 0x00);
+        RAM.Write(STBLKH, 0x06);
+    }
+
+    void StorageSelfWrite()
+    {
+        const char* Test = "storage-self-write";
+        Config Settings;
+        Settings.StorageDir = ".";
+        auto TheCPU = NewMachine({}, {}, Settings);
+        MCC& RAM = TheCPU->RAM;
+
+        // Saved byte is a load command, loading it into STCTL must not restart load
+        RAM.Memory[0x0500] = 0x01;
+        WriteBlock(RAM, 0x0500, 1);
+        RAM.Write(STCTL, 0x02);
+        Check(RAM.Read(STERR) == Storage::OK, Test, "save failed");
+        WriteBlock(RAM, STCTL, 0);
+        RAM.Write(STCTL, 0x01);
+        Check(RAM.Read(STERR) == Storage::OK, Test, "load into STCTL failed");
+        Check(RAM.Memory[0x0604] == 1,        Test, "load into STCTL did not transfer one byte");
+
+        // Zero length load of whole address space can't report its length
+        std::FILE* File = std::fopen(StorageFile, "wb");
+        const std::vector<U8> Data(MEMSIZE);
+        std::fwrite(Data.data(), 1, Data.size(), File);
+        std::fclose(File);
+        WriteBlock(RAM, 0x0000, 0);
+        RAM.Write(STCTL, 0x01);
+        Check(RAM.Read(STERR) == Storage::TooLarge, Test, "load of 64kB file is not too large");
+
+        std::remove(StorageFile);
+    }
+
+    struct Test {
+        const char* Name;
+        std::function<void()> Run;
+    };
+}
+
+// Checks device models through their registers
+int main(int argc, char** argv)
+{
+    const std::vector<Test> Tests = {
+        {"keyboard-order",     KeyboardOrder},
+        {"keyboard-overflow",  KeyboardOverflow},
+        {"keyboard-injection", KeyboardInjection},
+        {"keyboard-level-irq", KeyboardLevelIRQ},
+        {"timer-level-irq",    TimerLevelIRQ},
+        {"timer-store-ack",    TimerStoreAck},
+        {"serial-level-irq",   SerialLevelIRQ},
+        {"cpu-stop",           CPUStopIgnoresInterrupts},
+        {"watch-video-fetch",  WatchVideoFetch},
+        {"watch-dma-write",    WatchDMAWrite},
+        {"dma-self-write",     DMASelfWrite},
+        {"storage-self-write", StorageSelfWrite},
+    };
+
+    for(const Test& T : Tests) {
+        bool Selected = (argc < 2);
+        for(int i=1; i<argc; i++) {
+            Selected |= (std::strcmp(argv[i], T.Name) == 0);
+        }
+        if(!Selected)
+            continue;
+
+        const int Before = Failures;
+        T.Run();
+        std::printf("%-24s %s\n", T.Name, Failures == Before ? "ok" : "FAILED");
+    }
+
+    if(Failures > 0) {
+        std::printf("%d checks failed\n", Failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,9 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+TARGET = b1devtest
+
+include(../core.pri)
+
+SOURCES += b1devtest.cpp
@@ -0,0 +1,719 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "cpu.h"
+#include "opcodes.h"
+
+namespace {
+    // Instruction execution engine checked against the reference
+    struct Engine {
+        const char* Name;
+        const char* Description;
+        void (*Step)(CPU& TheCPU);
+        // Charges documented cycle counts, only those are compared
+        bool ExactCycles;
+    };
+
+    // First engine is the reference, new engines are added here
+    const Engine Engines[] = {
+        { "exact", "Switch interpreter, exact timing (reference)", [](CPU& TheCPU) { TheCPU.Step<ExactTiming>(); }, true  },
+        { "fast",  "Switch interpreter, approximate timing",       [](CPU& TheCPU) { TheCPU.Step<FastTiming>(); },  false },
+    };
+    const size_t NumEngines = sizeof(Engines) / sizeof(Engines[0]);
+
+    // Flags register bits that do not exist in hardware: B and bit 5
+    const U8 FlagsMask = 0xCF;
+
+    struct Random {
+        U64 Seed;
+
+        U64 Next()
+        {
+            // xorshift64*
+            Seed ^= Seed >> 12;
+            Seed ^= Seed << 25;
+            Seed ^= Seed >> 27;
+            return Seed * 0x2545F4914F6CDD1DULL;
+        }
+        U8 Byte() { return U8(Next() >> 32); }
+    };
+
+    struct State {
+        U8  A, X, Y, SP, P;
+        U16 PC;
+        std::array<U8, MEMSIZE> Memory;
+    };
+
+    // Engines charging documented cycles also enter interrupts with exact timing
+    Config EngineSettings(const Engine& E, Config Settings)
+    {
+        Settings.ExactTiming = E.ExactCycles;
+        return Settings;
+    }
+
+    // CPU with flat memory, recording addresses of its memory accesses
+    class Machine
+    {
+    public:
+        Machine(const Engine& InEngine, const Config& Settings)
+            : TheEngine(InEngine)
+            , TheCPU(CPUFREQ, VIDEOHZ, EngineSettings(InEngine, Settings), Host(), nullptr, 0, 0)
+        {
+            TheCPU.RAM.MapRegisters(false);
+            for(U32 Page=0; Page<256; Page++) {
+                TheCPU.RAM.WatchPage(U8(Page), true);
+            }
+            TheCPU.RAM.WatchCallback = [this](const U16 Addr, const bool Write) {
+                Accesses.push_back(Addr);
+                UNUSED(Write);
+            };
+        }
+
+        void Load(const State& S)
+        {
+            std::memcpy(TheCPU.RAM.Memory, S.Memory.data(), MEMSIZE);
+            TheCPU.A  = S.A;
+            TheCPU.X  = S.X;
+            TheCPU.Y  = S.Y;
+            TheCPU.SP = S.SP;
+            TheCPU.PC = S.PC;
+            *reinterpret_cast<U8*>(&TheCPU.Flags) = S.P;
+            TheCPU.Interrupt = CPU::INT_None;
+            TheCPU.Waiting   = false;
+            TheCPU.Stopped   = false;
+        }
+
+        void Save(State& S) const
+        {
+            std::memcpy(S.Memory.data(), TheCPU.RAM.Memory, MEMSIZE);
+            S.A  = TheCPU.A;
+            S.X  = TheCPU.X;
+            S.Y  = TheCPU.Y;
+            S.SP = TheCPU.SP;
+            S.PC = TheCPU.PC;
+            S.P  = P();
+        }
+
+        // Executes one instruction, BRK enters its handler right away
+        U32 Step()
+        {
+            Accesses.clear();
+            TheCPU.Cycles = 0;
+            TheEngine.Step(TheCPU);
+            if(TheCPU.Interrupt == CPU::INT_BRK)
+                TheCPU.ServiceInterrupt();
+            return TheCPU.Cycles;
+        }
+
+        U8 P() const { return *reinterpret_cast<const U8*>(&TheCPU.Flags); }
+        U8 NextOpCode() const { return TheCPU.RAM.Memory[TheCPU.PC]; }
+
+        const Engine&    TheEngine;
+        CPU              TheCPU;
+        std::vector<U16> Accesses;
+    };
+
+    std::string FormatRegisters(const U8 A, const U8 X, const U8 Y, const U8 SP, const U8 P, const U16 PC)
+    {
+        char Text[64];
+        std::snprintf(Text, sizeof(Text), "PC=%04X A=%02X X=%02X Y=%02X SP=%02X P=%02X", PC, A, X, Y, SP, P);
+        return Text;
+    }
+
+    std::string FormatState(const Machine& M, const U32 Cycles)
+    {
+        const CPU& C = M.TheCPU;
+        char Text[32];
+        std::snprintf(Text, sizeof(Text), " cycles=%u", Cycles);
+        return FormatRegisters(C.A, C.X, C.Y, C.SP, M.P(), C.PC) + Text;
+    }
+
+    // Describes differences between machines after an instruction, empty if none
+    std::string Compare(const Machine& Ref, const Machine& Alt, const U32 RefCycles, const U32 AltCycles, const bool CompareCycles)
+    {
+        const CPU& R = Ref.TheCPU;
+        const CPU& T = Alt.TheCPU;
+
+        std::string Diff;
+        if(R.A != T.A || R.X != T.X || R.Y != T.Y || R.SP != T.SP || R.PC != T.PC || ((Ref.P() ^ Alt.P()) & FlagsMask))
+            Diff += "registers differ\n";
+        if(R.Interrupt != T.Interrupt || R.Waiting != T.Waiting || R.Stopped != T.Stopped)
+            Diff += "interrupt or halt state differs\n";
+        if(CompareCycles && RefCycles != AltCycles)
+            Diff += "cycle counts differ\n";
+        if(std::memcmp(R.RAM.Memory, T.RAM.Memory, MEMSIZE) == 0)
+            return Diff;
+        for(U32 Addr=0; Addr<MEMSIZE; Addr++) {
+            if(R.RAM.Memory[Addr] != T.RAM.Memory[Addr]) {
+                char Text[64];
+                std::snprintf(Text, sizeof(Text), "memory $%04X: %02X vs %02X\n", Addr, R.RAM.Memory[Addr], T.RAM.Memory[Addr]);
+                Diff += Text;
+            }
+        }
+        return Diff;
+    }
+
+    struct Case {
+        State Initial;
+        int   Length;
+    };
+
+    struct Outcome {
+        // Instruction index of first difference, negative if none
+        int Diverged;
+        std::string Diff;
+        std::vector<bool> Touched;
+    };
+
+    // Runs case on both machines until they differ or an undefined opcode is reached
+    Outcome Run(const Case& C, Machine& Ref, Machine& Alt, const bool CMOS, const bool CompareCycles)
+    {
+        Outcome Result;
+        Result.Diverged = -1;
+        Result.Touched.assign(MEMSIZE, false);
+
+        Ref.Load(C.Initial);
+        Alt.Load(C.Initial);
+        for(int i=0; i<C.Length; i++) {
+            if(!DecodeOpcode(Ref.NextOpCode(), CMOS).Defined)
+                break;
+
+            const U32 RefCycles = Ref.Step();
+            const U32 AltCycles = Alt.Step();
+            for(const U16 Addr : Ref.Accesses) Result.Touched[Addr] = true;
+            for(const U16 Addr : Alt.Accesses) Result.Touched[Addr] = true;
+
+            Result.Diff = Compare(Ref, Alt, RefCycles, AltCycles, CompareCycles);
+            if(!Result.Diff.empty()) {
+                Result.Diff = Ref.TheEngine.Name + std::string(": ") + FormatState(Ref, RefCycles) + "\n"
+                            + Alt.TheEngine.Name + std::string(": ") + FormatState(Alt, AltCycles) + "\n" + Result.Diff;
+                Result.Diverged = i;
+                break;
+            }
+        }
+        return Result;
+    }
+
+    // Random machine state with random instructions along the path the reference takes
+    Case Generate(Random& Rng, const int Length, Machine& Ref, const bool CMOS)
+    {
+        Case C;
+        for(U32 Addr=0; Addr<MEMSIZE; Addr+=8) {
+            const U64 Bytes = Rng.Next();
+            std::memcpy(&C.Initial.Memory[Addr], &Bytes, 8);
+        }
+        C.Initial.A  = Rng.Byte();
+        C.Initial.X  = Rng.Byte();
+        C.Initial.Y  = Rng.Byte();
+        C.Initial.SP = Rng.Byte();
+        C.Initial.P  = Rng.Byte() | 0x30;
+        C.Initial.PC = U16(Rng.Next());
+        C.Length = Length;
+
+        // Undefined opcodes on the path are replaced by defined ones
+        Ref.Load(C.Initial);
+        for(int i=0; i<Length; i++) {
+            const U16 PC = Ref.TheCPU.PC;
+            while(!DecodeOpcode(Ref.NextOpCode(), CMOS).Defined) {
+                const U8 OpCode = Rng.Byte();
+                Ref.TheCPU.RAM.Memory[PC] = OpCode;
+                C.Initial.Memory[PC] = OpCode;
+            }
+            Ref.Step();
+        }
+        return C;
+    }
+
+    // Shrinks failing case to the last instruction that still fails on its own,
+    // memory it does not touch cleared, and as many bytes & registers zeroed as possible
+    Case Minimize(Case C, Machine& Ref, Machine& Alt, const bool CMOS, const bool CompareCycles)
+    {
+        auto Fails = [&](const Case& Candidate) { return Run(Candidate, Ref, Alt, CMOS, CompareCycles).Diverged >= 0; };
+
+        C.Length = Run(C, Ref, Alt, CMOS, CompareCycles).Diverged + 1;
+        for(int Skip=C.Length-1; Skip>0; Skip--) {
+            Case Later;
+            Ref.Load(C.Initial);
+            for(int i=0; i<Skip; i++) {
+                Ref.Step();
+            }
+            Ref.Save(Later.Initial);
+            Later.Length = C.Length - Skip;
+            if(Fails(Later)) {
+                C = Later;
+                break;
+            }
+        }
+
+        const std::vector<bool> Touched = Run(C, Ref, Alt, CMOS, CompareCycles).Touched;
+        Case Cleared = C;
+        for(U32 Addr=0; Addr<MEMSIZE; Addr++) {
+            if(!Touched[Addr])
+                Cleared.Initial.Memory[Addr] = 0;
+        }
+        if(Fails(Cleared))
+            C = Cleared;
+
+        for(U32 Addr=0; Addr<MEMSIZE; Addr++) {
+            if(!Touched[Addr] || C.Initial.Memory[Addr] == 0)
+                continue;
+            Case Candidate = C;
+            Candidate.Initial.Memory[Addr] = 0;
+            if(Fails(Candidate))
+                C = Candidate;
+        }
+
+        U8* Registers[] = { &C.Initial.A, &C.Initial.X, &C.Initial.Y };
+        for(U8* Reg : Registers) {
+            const U8 Value = *Reg;
+            *Reg = 0;
+            if(!Fails(C))
+                *Reg = Value;
+        }
+        for(int Bit=0; Bit<8; Bit++) {
+            const U8 Value = C.Initial.P;
+            C.Initial.P &= ~(1 << Bit);
+            if(C.Initial.P == Value || !Fails(C))
+                C.Initial.P = Value;
+        }
+        return C;
+    }
+
+    void PrintCase(const Case& C, const Outcome& Result, const bool CMOS)
+    {
+        const State& S = C.Initial;
+        std::printf("  %s\n", FormatRegisters(S.A, S.X, S.Y, S.SP, S.P, S.PC).c_str());
+        const OpcodeInfo& Op = DecodeOpcode(S.Memory[S.PC], CMOS);
+        std::printf("  %04X  %s%s\n", S.PC, Disassemble(S.PC, S.Memory[S.PC], S.Memory[U16(S.PC+1)], S.Memory[U16(S.PC+2)], CMOS).c_str(),
+                    C.Length > 1 ? " ..." : "");
+        UNUSED(Op);
+
+        std::printf("  Memory:");
+        int Count = 0;
+        for(U32 Addr=0; Addr<MEMSIZE; Addr++) {
+            if(Result.Touched[Addr] && S.Memory[Addr] != 0)
+                std::printf("%s$%04X=%02X", (Count++ % 8) ? " " : "\n    ", Addr, S.Memory[Addr]);
+        }
+        std::printf("\n");
+
+        std::istringstream Lines(Result.Diff);
+        std::string Line;
+        while(std::getline(Lines, Line)) {
+            std::printf("  %s\n", Line.c_str());
+        }
+    }
+
+    // Writes case as single instruction test vector with reference results
+    void WriteVector(std::FILE* File, const std::string& Name, const Case& C, const Outcome& Result, Machine& Ref, const bool First)
+    {
+        Ref.Load(C.Initial);
+        for(int i=0; i<C.Length; i++) {
+            Ref.Step();
+        }
+        State Final;
+        Ref.Save(Final);
+
+        auto WriteState = [&](const State& S) {
+            std::fprintf(File, "{\"pc\": %u, \"s\": %u, \"a\": %u, \"x\": %u, \"y\": %u, \"p\": %u, \"ram\": [", S.PC, S.SP, S.A, S.X, S.Y, S.P);
+            bool FirstByte = true;
+            for(U32 Addr=0; Addr<MEMSIZE; Addr++) {
+                if(!Result.Touched[Addr])
+                    continue;
+                std::fprintf(File, "%s[%u, %u]", FirstByte ? "" : ", ", Addr, S.Memory[Addr]);
+                FirstByte = false;
+            }
+            std::fprintf(File, "]}");
+        };
+
+        std::fprintf(File, "%s\n{\"name\": \"%s\", \"initial\": ", First ? "" : ",", Name.c_str());
+        WriteState(C.Initial);
+        std::fprintf(File, ", \"final\": ");
+        WriteState(Final);
+        std::fprintf(File, "}");
+    }
+
+    // JSON value, just enough for test vector files
+    struct Json {
+        enum Kind { Null, Number, String, Array, Object } Type;
+        double Value;
+        std::string Text;
+        std::vector<Json> Items;
+        std::vector<std::string> Keys;
+
+        Json() : Type(Null), Value(0.0) {}
+
+        const Json* Find(const char* Key) const
+        {
+            for(size_t i=0; i<Keys.size(); i++) {
+                if(Keys[i] == Key)
+                    return &Items[i];
+            }
+            return nullptr;
+        }
+        U32 Get(const char* Key) const
+        {
+            const Json* Member = Find(Key);
+            return Member ? U32(Member->Value) : 0;
+        }
+    };
+
+    class JsonParser
+    {
+    public:
+        JsonParser(const std::string& InText) : Text(InText), Pos(0) {}
+
+        bool Parse(Json& Value)
+        {
+            SkipSpace();
+            if(Pos >= Text.size())
+                return false;
+
+            const char C = Text[Pos];
+            if(C == '{' || C == '[') {
+                const char Close = (C == '{') ? '}' : ']';
+                Value.Type = (C == '{') ? Json::Object : Json::Array;
+                Pos++;
+                SkipSpace();
+                if(Pos < Text.size() && Text[Pos] == Close) {
+                    Pos++;
+                    return true;
+                }
+                for(;;) {
+                    if(Value.Type == Json::Object) {
+                        Json Key;
+                        SkipSpace();
+                        if(!ParseString(Key.Text))
+                            return false;
+                        SkipSpace();
+                        if(Pos >= Text.size() || Text[Pos++] != ':')
+                            return false;
+                        Value.Keys.push_back(Key.Text);
+                    }
+                    Value.Items.push_back(Json());
+                    if(!Parse(Value.Items.back()))
+                        return false;
+                    SkipSpace();
+                    if(Pos >= Text.size())
+                        return false;
+                    const char Next = Text[Pos++];
+                    if(Next == Close)
+                        return true;
+                    if(Next != ',')
+                        return false;
+                }
+            }
+            if(C == '"') {
+                Value.Type = Json::String;
+                return ParseString(Value.Text);
+            }
+            if(C == 'n' || C == 't' || C == 'f') {
+                // Literals are not used by test vectors, they are skipped as null
+                while(Pos < Text.size() && std::isalpha(U8(Text[Pos])))
+                    Pos++;
+                return true;
+            }
+
+            char* End;
+            Value.Type  = Json::Number;
+            Value.Value = std::strtod(Text.c_str() + Pos, &End);
+            if(End == Text.c_str() + Pos)
+                return false;
+            Pos = End - Text.c_str();
+            return true;
+        }
+
+    private:
+        void SkipSpace()
+        {
+            while(Pos < Text.size() && std::isspace(U8(Text[Pos])))
+                Pos++;
+        }
+
+        bool ParseString(std::string& Value)
+        {
+            if(Pos >= Text.size() || Text[Pos] != '"')
+                return false;
+            const size_t End = Text.find('"', ++Pos);
+            if(End == std::string::npos)
+                return false;
+            Value = Text.substr(Pos, End - Pos);
+            Pos = End + 1;
+            return true;
+        }
+
+        const std::string& Text;
+        size_t Pos;
+    };
+
+    bool LoadVectorState(const Json& Object, State& S)
+    {
+        if(Object.Type != Json::Object)
+            return false;
+
+        S.PC = U16(Object.Get("pc"));
+        S.SP = U8(Object.Get("s"));
+        S.A  = U8(Object.Get("a"));
+        S.X  = U8(Object.Get("x"));
+        S.Y  = U8(Object.Get("y"));
+        S.P  = U8(Object.Get("p"));
+        S.Memory.fill(0);
+
+        const Json* Ram = Object.Find("ram");
+        if(!Ram)
+            return false;
+        for(const Json& Entry : Ram->Items) {
+            if(Entry.Items.size() < 2)
+                return false;
+            S.Memory[U16(Entry.Items[0].Value)] = U8(Entry.Items[1].Value);
+        }
+        return true;
+    }
+
+    struct Totals {
+        U32 Passed;
+        U32 Failed;
+        U32 Skipped;
+    };
+
+    // Runs single instruction test vectors in SingleStepTests (ProcessorTests) format
+    bool RunVectors(const char* FileName, Machine& M, const bool CMOS, const bool CompareCycles, const U32 MaxReports, Totals& Total)
+    {
+        std::ifstream File(FileName, std::ios::binary);
+        if(!File) {
+            std::fprintf(stderr, "Could not open test vector file: %s\n", FileName);
+            return false;
+        }
+        std::stringstream Stream;
+        Stream << File.rdbuf();
+        const std::string Text = Stream.str();
+
+        Json Tests;
+        if(!JsonParser(Text).Parse(Tests) || Tests.Type != Json::Array) {
+            std::fprintf(stderr, "Invalid test vector file: %s\n", FileName);
+            return false;
+        }
+
+        Totals FileTotal = { 0, 0, 0 };
+        State Initial, Expected;
+        for(const Json& Test : Tests.Items) {
+            const Json* Name   = Test.Find("name");
+            const Json* Before = Test.Find("initial");
+            const Json* After  = Test.Find("final");
+            if(!Before || !After || !LoadVectorState(*Before, Initial) || !LoadVectorState(*After, Expected)) {
+                std::fprintf(stderr, "Invalid test vector in %s\n", FileName);
+                return false;
+            }
+            if(!DecodeOpcode(Initial.Memory[Initial.PC], CMOS).Defined) {
+                FileTotal.Skipped++;
+                continue;
+            }
+
+            M.Load(Initial);
+            const U32 Cycles = M.Step();
+            const CPU& C = M.TheCPU;
+
+            std::string Diff;
+            if(C.A != Expected.A || C.X != Expected.X || C.Y != Expected.Y || C.SP != Expected.SP || C.PC != Expected.PC
+               || ((M.P() ^ Expected.P) & FlagsMask)) {
+                Diff += "  got      " + FormatRegisters(C.A, C.X, C.Y, C.SP, M.P(), C.PC) + "\n";
+                Diff += "  expected " + FormatRegisters(Expected.A, Expected.X, Expected.Y, Expected.SP, Expected.P, Expected.PC) + "\n";
+            }
+            for(const Json& Entry : After->Find("ram")->Items) {
+                const U16 Addr = U16(Entry.Items[0].Value);
+                if(C.RAM.Memory[Addr] != Expected.Memory[Addr]) {
+                    char Line[64];
+                    std::snprintf(Line, sizeof(Line), "  memory $%04X: got %02X, expected %02X\n", Addr, C.RAM.Memory[Addr], Expected.Memory[Addr]);
+                    Diff += Line;
+                }
+            }
+            // Either a list of bus cycles or just their number
+            const Json* BusCycles = Test.Find("cycles");
+            const U32 ExpectedCycles = BusCycles ? (BusCycles->Type == Json::Number ? U32(BusCycles->Value) : U32(BusCycles->Items.size())) : 0;
+            if(CompareCycles && BusCycles && ExpectedCycles != Cycles) {
+                char Line[64];
+                std::snprintf(Line, sizeof(Line), "  cycles: got %u, expected %u\n", Cycles, ExpectedCycles);
+                Diff += Line;
+            }
+
+            if(Diff.empty()) {
+                FileTotal.Passed++;
+                continue;
+            }
+            if(Total.Failed + FileTotal.Failed < MaxReports) {
+                const OpcodeInfo& Op = DecodeOpcode(Initial.Memory[Initial.PC], CMOS);
+                std::printf("FAIL %s: %s (%s)\n  initial  %s\n%s", FileName, Name ? Name->Text.c_str() : "?", Op.Mnemonic,
+                            FormatRegisters(Initial.A, Initial.X, Initial.Y, Initial.SP, Initial.P, Initial.PC).c_str(), Diff.c_str());
+            }
+            FileTotal.Failed++;
+        }
+
+        std::printf("%s: %u passed, %u failed, %u skipped\n", FileName, FileTotal.Passed, FileTotal.Failed, FileTotal.Skipped);
+        Total.Passed  += FileTotal.Passed;
+        Total.Failed  += FileTotal.Failed;
+        Total.Skipped += FileTotal.Skipped;
+        return true;
+    }
+
+    const Engine* FindEngine(const char* Name)
+    {
+        for(const Engine& E : Engines) {
+            if(std::strcmp(E.Name, Name) == 0)
+                return &E;
+        }
+        return nullptr;
+    }
+}
+
+// Checks CPU engines against the reference interpreter with random instruction
+// streams, and any engine against single instruction test vectors
+int main(int argc, char** argv)
+{
+    Config Settings;
+    Settings.Turbo = true;
+    Settings.DMA   = false;
+    Settings.Timer = false;
+
+    U32 NumCases   = 100000;
+    int Length     = 16;
+    U64 Seed       = 1;
+    U32 MaxReports = 10;
+    bool CompareCycles = true;
+    const char* EngineName = nullptr;
+    const char* OutputName = nullptr;
+    std::vector<const char*> VectorNames;
+
+    for(int i=1; i<argc; i++) {
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+            std::printf("Usage: %s [options] [test vector files]\n\n", argv[0]);
+            std::printf("Without test vector files, random instruction streams are run on the reference\n");
+            std::printf("engine and on each other engine, and failing cases are minimized.\n\n");
+            std::printf("Options:\n");
+            std::printf("  -e <engine>            Engine to check (default: all against reference, reference for vectors)\n");
+            std::printf("  -n <count>             Number of random cases (default: 100000)\n");
+            std::printf("  -l <length>            Instructions per random case (default: 16)\n");
+            std::printf("  -s <seed>              Random seed (default: 1)\n");
+            std::printf("  -m <count>             Failures reported in detail (default: 10)\n");
+            std::printf("  -o <file>              Write minimized failing cases as test vectors\n");
+            std::printf("  --cmos                 Emulate 65C02 instruction set\n");
+            std::printf("  --no-cycles            Do not compare cycle counts\n");
+            std::printf("  --list                 List engines\n");
+            return 0;
+        }
+        else if(std::strcmp(argv[i], "-e") == 0 && i+1 < argc) {
+            EngineName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "-n") == 0 && i+1 < argc) {
+            NumCases = U32(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if(std::strcmp(argv[i], "-l") == 0 && i+1 < argc) {
+            Length = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if(std::strcmp(argv[i], "-s") == 0 && i+1 < argc) {
+            Seed = std::max<U64>(std::strtoull(argv[++i], nullptr, 10), 1);
+        }
+        else if(std::strcmp(argv[i], "-m") == 0 && i+1 < argc) {
+            MaxReports = U32(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if(std::strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+            OutputName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--cmos") == 0) {
+            Settings.CMOS = true;
+        }
+        else if(std::strcmp(argv[i], "--no-cycles") == 0) {
+            CompareCycles = false;
+        }
+        else if(std::strcmp(argv[i], "--list") == 0) {
+            for(const Engine& E : Engines) {
+                std::printf("%-8s %s\n", E.Name, E.Description);
+            }
+            return 0;
+        }
+        else if(argv[i][0] == '-') {
+            std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        else {
+            VectorNames.push_back(argv[i]);
+        }
+    }
+
+    const Engine* Selected = EngineName ? FindEngine(EngineName) : nullptr;
+    if(EngineName && !Selected) {
+        std::fprintf(stderr, "Unknown engine: %s\n", EngineName);
+        return 1;
+    }
+
+    if(!VectorNames.empty()) {
+        const Engine& E = Selected ? *Selected : Engines[0];
+        Machine M(E, Settings);
+
+        Totals Total = { 0, 0, 0 };
+        for(const char* Name : VectorNames) {
+            if(!RunVectors(Name, M, Settings.CMOS, CompareCycles && E.ExactCycles, MaxReports, Total))
+                return 2;
+        }
+        std::printf("Engine %s: %u passed, %u failed, %u skipped\n", E.Name, Total.Passed, Total.Failed, Total.Skipped);
+        return Total.Failed > 0 ? 3 : 0;
+    }
+
+    std::FILE* Output = nullptr;
+    if(OutputName) {
+        Output = std::fopen(OutputName, "w");
+        if(!Output) {
+            std::fprintf(stderr, "Could not write test vector file: %s\n", OutputName);
+            return 2;
+        }
+        std::fprintf(Output, "[");
+    }
+
+    std::unique_ptr<Machine> Ref(new Machine(Engines[0], Settings));
+    U32 TotalFailed = 0;
+    for(size_t Index=1; Index<NumEngines; Index++) {
+        const Engine& E = Engines[Index];
+        if(Selected && Selected != &E)
+            continue;
+
+        Machine Alt(E, Settings);
+        const bool Cycles = CompareCycles && E.ExactCycles && Engines[0].ExactCycles;
+
+        U32 Failed = 0;
+        Random Rng = { Seed };
+        for(U32 CaseIndex=0; CaseIndex<NumCases; CaseIndex++) {
+            const Case C = Generate(Rng, Length, *Ref, Settings.CMOS);
+            if(Run(C, *Ref, Alt, Settings.CMOS, Cycles).Diverged < 0)
+                continue;
+
+            if(Failed < MaxReports) {
+                const Case Minimal = Minimize(C, *Ref, Alt, Settings.CMOS, Cycles);
+                const Outcome Result = Run(Minimal, *Ref, Alt, Settings.CMOS, Cycles);
+                std::printf("FAIL case %u of engine %s, minimized to %d instructions:\n", CaseIndex, E.Name, Minimal.Length);
+                PrintCase(Minimal, Result, Settings.CMOS);
+                if(Output && Minimal.Length == 1) {
+                    char Name[64];
+                    std::snprintf(Name, sizeof(Name), "%s seed %llu case %u", E.Name, (unsigned long long)Seed, CaseIndex);
+                    WriteVector(Output, Name, Minimal, Result, *Ref, TotalFailed + Failed == 0);
+                }
+            }
+            Failed++;
+        }
+        std::printf("Engine %s: %u of %u cases failed (%s cycles)\n", E.Name, Failed, NumCases, Cycles ? "with" : "without");
+        TotalFailed += Failed;
+    }
+
+    if(Output) {
+        std::fprintf(Output, "\n]\n");
+        std::fclose(Output);
+    }
+    return TotalFailed > 0 ? 3 : 0;
+}
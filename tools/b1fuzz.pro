@@ -0,0 +1,9 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+TARGET = b1fuzz
+
+include(../core.pri)
+
+SOURCES += b1fuzz.cpp
@@ -0,0 +1,186 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "tracer.h"
+#include "loader.h"
+
+namespace {
+    const char* InterruptNames[] = { "", "RESET", "NMI", "IRQ", "BRK" };
+    const char* AccessKinds = " rwm";
+
+    U16 GetWord(const U8* Bytes)
+    {
+        return U16(Bytes[0] | Bytes[1] << 8);
+    }
+
+    bool ReadU32(std::FILE* File, U32& Value)
+    {
+        U8 Bytes[4];
+        if(std::fread(Bytes, 1, sizeof(Bytes), File) != sizeof(Bytes))
+            return false;
+        Value = Bytes[0] | Bytes[1] << 8 | Bytes[2] << 16 | U32(Bytes[3]) << 24;
+        return true;
+    }
+
+    void PrintRecord(const U64 Index, const TraceRecord& R, const SymbolTable& Symbols)
+    {
+        const bool CMOS = (R.Flags & TraceRecord::CMOS) != 0;
+        const U8 Interrupt = (R.Flags & TraceRecord::InterruptMask) >> TraceRecord::InterruptShift;
+
+        char Flags[9] = "NV-BDIZC";
+        for(int i=0; i<8; i++) {
+            if(!(R.P & (0x80 >> i)))
+                Flags[i] = '.';
+        }
+
+        if(Interrupt) {
+            std::printf("%10llu  %04X  %-8s  %-16s  A=%02X X=%02X Y=%02X SP=%02X %s  from $%04X\n",
+                        (unsigned long long)Index, GetWord(R.PC), "", Interrupt < 5 ? InterruptNames[Interrupt] : "?",
+                        R.A, R.X, R.Y, R.SP, Flags, GetWord(R.Addr));
+            return;
+        }
+
+        if(const std::string* Label = Symbols.Name(GetWord(R.PC)))
+            std::printf("%10s  %s:\n", "", Label->c_str());
+
+        const OpcodeInfo& Op = DecodeOpcode(R.OpCode, CMOS);
+        char Bytes[12];
+        switch(Op.Length) {
+        case 3:  std::snprintf(Bytes, sizeof(Bytes), "%02X %02X %02X", R.OpCode, R.Operand[0], R.Operand[1]); break;
+        case 2:  std::snprintf(Bytes, sizeof(Bytes), "%02X %02X", R.OpCode, R.Operand[0]); break;
+        default: std::snprintf(Bytes, sizeof(Bytes), "%02X", R.OpCode); break;
+        }
+
+        char Effect[24] = "";
+        const U8 Access = R.Flags & TraceRecord::AccessMask;
+        if(Access != OpcodeInfo::NoAccess) {
+            if(R.Flags & TraceRecord::AccessIO)
+                std::snprintf(Effect, sizeof(Effect), "[%04X]=IO %c", GetWord(R.Addr), AccessKinds[Access]);
+            else
+                std::snprintf(Effect, sizeof(Effect), "[%04X]=%02X %c", GetWord(R.Addr), R.Value, AccessKinds[Access]);
+        }
+
+        const std::string Text = Disassemble(GetWord(R.PC), R.OpCode, R.Operand[0], R.Operand[1], CMOS);
+        std::printf("%10llu  %04X  %-8s  %-16s  A=%02X X=%02X Y=%02X SP=%02X %s  %-12s %3u\n",
+                    (unsigned long long)Index, GetWord(R.PC), Bytes, Text.c_str(),
+                    R.A, R.X, R.Y, R.SP, Flags, Effect, R.Cycles);
+    }
+
+    // Decodes ring buffer dump, returns records oldest first
+    bool ReadDump(std::FILE* File, U64& First, std::vector<TraceRecord>& Records)
+    {
+        U32 FirstLow, FirstHigh, Count, RecordSize;
+        if(!ReadU32(File, FirstLow) || !ReadU32(File, FirstHigh) || !ReadU32(File, Count) || !ReadU32(File, RecordSize))
+            return false;
+        if(RecordSize != sizeof(TraceRecord))
+            return false;
+
+        First = U64(FirstHigh) << 32 | FirstLow;
+        Records.resize(Count);
+        return std::fread(Records.data(), sizeof(TraceRecord), Count, File) == Count;
+    }
+
+    // Decodes delta compressed stream, see Tracer::WriteBlock()
+    bool ReadStream(std::FILE* File, std::vector<TraceRecord>& Records)
+    {
+        std::vector<U8> Encoded;
+        U32 Count, Size;
+        while(ReadU32(File, Count)) {
+            if(!ReadU32(File, Size))
+                return false;
+            Encoded.resize(Size);
+            if(std::fread(Encoded.data(), 1, Size, File) != Size)
+                return false;
+
+            U8 Previous[sizeof(TraceRecord)] = {};
+            size_t Pos = 0;
+            for(U32 i=0; i<Count; i++) {
+                if(Pos + 2 > Size)
+                    return false;
+                const U16 Changed = GetWord(&Encoded[Pos]);
+                Pos += 2;
+                for(size_t j=0; j<sizeof(TraceRecord); j++) {
+                    if(!(Changed & (1 << j)))
+                        continue;
+                    if(Pos >= Size)
+                        return false;
+                    Previous[j] = Encoded[Pos++];
+                }
+                TraceRecord R;
+                std::memcpy(&R, Previous, sizeof(R));
+                Records.push_back(R);
+            }
+        }
+        return true;
+    }
+}
+
+// Prints instruction trace dumped or streamed by the emulator
+int main(int argc, char** argv)
+{
+    const char* InputName = nullptr;
+    U64 Last = 0;
+    SymbolTable Symbols;
+
+    for(int i=1; i<argc; i++) {
+        if(std::strcmp(argv[i], "-n") == 0 && i+1 < argc) {
+            Last = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if(std::strcmp(argv[i], "-y") == 0 && i+1 < argc) {
+            if(!Symbols.Load(argv[++i]))
+                return 2;
+        }
+        else if(argv[i][0] == '-') {
+            InputName = nullptr;
+            break;
+        }
+        else {
+            InputName = argv[i];
+        }
+    }
+
+    if(!InputName) {
+        std::printf("Usage: %s [options] <trace file>\n\n", argv[0]);
+        std::printf("Options:\n");
+        std::printf("  -n <count>             Print only last <count> instructions\n");
+        std::printf("  -y <file>              Label instructions with symbols of ld65 label or debug file\n");
+        return 1;
+    }
+
+    std::FILE* File = std::fopen(InputName, "rb");
+    if(!File) {
+        std::fprintf(stderr, "Could not open trace file: %s\n", InputName);
+        return 2;
+    }
+
+    char Magic[8];
+    U64  First = 0;
+    std::vector<TraceRecord> Records;
+    bool Valid = false;
+    if(std::fread(Magic, 1, sizeof(Magic), File) == sizeof(Magic)) {
+        if(std::memcmp(Magic, "B1TRACE1", sizeof(Magic)) == 0)
+            Valid = ReadDump(File, First, Records);
+        else if(std::memcmp(Magic, "B1TRACZ1", sizeof(Magic)) == 0)
+            Valid = ReadStream(File, Records);
+    }
+    std::fclose(File);
+
+    if(!Valid) {
+        std::fprintf(stderr, "Invalid trace file: %s\n", InputName);
+        return 2;
+    }
+
+    size_t Start = 0;
+    if(Last > 0 && Last < Records.size())
+        Start = Records.size() - size_t(Last);
+    for(size_t i=Start; i<Records.size(); i++) {
+        PrintRecord(First + i, Records[i], Symbols);
+    }
+    return 0;
+}
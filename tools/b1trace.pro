@@ -0,0 +1,16 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+TARGET = b1trace
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += b1trace.cpp \
+    $$PWD/../opcodes.cpp \
+    $$PWD/../loader.cpp
+
+HEADERS += \
+    $$PWD/../opcodes.h \
+    $$PWD/../loader.h \
+    $$PWD/../tracer.h
@@ -0,0 +1,258 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include "cpu.h"
+#include "tracer.h"
+
+namespace {
+    const char DumpMagic[8]   = { 'B', '1', 'T', 'R', 'A', 'C', 'E', '1' };
+    const char StreamMagic[8] = { 'B', '1', 'T', 'R', 'A', 'C', 'Z', '1' };
+
+    // Stream blocks queued for background thread
+    const size_t StreamQueue = 64;
+
+    const char* TriggerNames[] = { "on request", "on illegal opcode", "on BRK", "on watchpoint", "at exit" };
+
+    void PutWord(U8* Bytes, const U16 Value)
+    {
+        Bytes[0] = U8(Value);
+        Bytes[1] = U8(Value >> 8);
+    }
+
+    void WriteU32(std::FILE* File, const U32 Value)
+    {
+        const U8 Bytes[4] = { U8(Value), U8(Value >> 8), U8(Value >> 16), U8(Value >> 24) };
+        std::fwrite(Bytes, 1, sizeof(Bytes), File);
+    }
+}
+
+Tracer::Tracer(CPU* InCPU)
+    : Device(InCPU)
+    , Enabled(false)
+    , Mask(0)
+    , Count(0)
+    , Opcodes(&DecodeOpcode(0, TheCPU.Settings.CMOS))
+    , ModeFlags(TheCPU.Settings.CMOS ? U8(TraceRecord::CMOS) : 0)
+    , DumpFile(TheCPU.Settings.TraceFile)
+    , Dumps(0)
+    , Triggered(0)
+    , DumpPending(false)
+    , PendingReason(TriggerRequest)
+    , Stream(nullptr)
+{
+    static_assert(sizeof(TraceRecord) == 16, "Trace record must be 16 bytes");
+
+    if(TheCPU.Settings.TraceSize == 0)
+        return;
+
+    size_t Capacity = BlockSize;
+    while(Capacity < TheCPU.Settings.TraceSize)
+        Capacity <<= 1;
+    Ring.resize(Capacity);
+    Mask = Capacity - 1;
+
+    if(!TheCPU.Settings.TraceStream.empty()) {
+        Stream = std::fopen(TheCPU.Settings.TraceStream.c_str(), "wb");
+        if(!Stream)
+            throw Error("Could not open trace stream file");
+        std::fwrite(StreamMagic, 1, sizeof(StreamMagic), Stream);
+        StreamWorker.Start(StreamQueue, std::bind(&Tracer::WriteBlock, this, std::placeholders::_1));
+    }
+
+    std::printf("Tracing last %lu instructions\n", (unsigned long)Capacity);
+    Enabled = true;
+}
+
+Tracer::~Tracer()
+{
+    if(!Enabled)
+        return;
+
+    if(Dumps == 0 && !DumpFile.empty())
+        Dump(TriggerExit);
+
+    if(Stream) {
+        PostBlock(size_t(Count % BlockSize));
+        StreamWorker.Stop();
+        std::fclose(Stream);
+    }
+}
+
+void Tracer::Commit()
+{
+    if((++Count % BlockSize) == 0 && Stream)
+        PostBlock(BlockSize);
+}
+
+void Tracer::Record(const U8 OpCode, const U16 OpAddr, const U32 InstructionCycles)
+{
+    const OpcodeInfo& Op = Opcodes[OpCode];
+    const U8  Operand1 = RAM.Peek(U16(OpAddr + 1));
+    const U8  Operand2 = RAM.Peek(U16(OpAddr + 2));
+    const U16 Word     = Operand1 | Operand2 << 8;
+
+    U16 Addr   = 0;
+    U8  Access = Op.Access;
+    switch(Op.Mode) {
+    case OpcodeInfo::Implied:
+        // Stack pushes & pulls, unless undefined in NMOS mode
+        if(!Op.Defined)
+            break;
+        switch(OpCode) {
+        case 0x08: case 0x48: case 0x5A: case 0xDA:
+            Addr = 0x100 + U8(TheCPU.SP + 1); Access = OpcodeInfo::Write; break;
+        case 0x28: case 0x68: case 0x7A: case 0xFA:
+            Addr = 0x100 + TheCPU.SP; Access = OpcodeInfo::Read; break;
+        }
+        break;
+    case OpcodeInfo::ZeroPage:
+    case OpcodeInfo::ZeroPageRelative: Addr = Operand1; break;
+    case OpcodeInfo::ZeroPageX:  Addr = U8(Operand1 + TheCPU.X); break;
+    case OpcodeInfo::ZeroPageY:  Addr = U8(Operand1 + TheCPU.Y); break;
+    case OpcodeInfo::Absolute:   Addr = Word; break;
+    case OpcodeInfo::AbsoluteX:  Addr = Word + TheCPU.X; break;
+    case OpcodeInfo::AbsoluteY:  Addr = Word + TheCPU.Y; break;
+    case OpcodeInfo::IndexedX: {
+        const U8 Pointer = Operand1 + TheCPU.X;
+        Addr = RAM.Peek(Pointer) | RAM.Peek(U8(Pointer + 1)) << 8;
+    } break;
+    case OpcodeInfo::IndexedY:
+        Addr = (RAM.Peek(Operand1) | RAM.Peek(U8(Operand1 + 1)) << 8) + TheCPU.Y;
+        break;
+    case OpcodeInfo::IndirectZP:
+        Addr = RAM.Peek(Operand1) | RAM.Peek(U8(Operand1 + 1)) << 8;
+        break;
+    default:
+        break;
+    }
+
+    TraceRecord& R = Ring[size_t(Count) & Mask];
+    PutWord(R.PC, OpAddr);
+    R.OpCode     = OpCode;
+    R.Operand[0] = Operand1;
+    R.Operand[1] = Operand2;
+    R.A  = TheCPU.A;
+    R.X  = TheCPU.X;
+    R.Y  = TheCPU.Y;
+    R.SP = TheCPU.SP;
+    R.P  = TheCPU.FlagRegister() | 0x20;
+    PutWord(R.Addr, Addr);
+    R.Flags    = ModeFlags | Access;
+    R.Value    = RAM.Peek(Addr);
+    R.Cycles   = U8(std::min<U32>(InstructionCycles, 0xFF));
+    R.Reserved = 0;
+    if(Access != OpcodeInfo::NoAccess && (Addr >> 8) == 0xFD) {
+        R.Flags |= TraceRecord::AccessIO;
+        R.Value  = 0;
+    }
+    Commit();
+
+    if(OpCode == 0x00 && !DumpPending)
+        DumpAfter(TriggerBreak);
+    if(DumpPending) {
+        DumpPending = false;
+        Dump(PendingReason);
+    }
+}
+
+void Tracer::RecordInterrupt(const U8 Type, const U16 ReturnAddr)
+{
+    TraceRecord& R = Ring[size_t(Count) & Mask];
+    std::memset(&R, 0, sizeof(R));
+    PutWord(R.PC, TheCPU.PC);
+    R.A  = TheCPU.A;
+    R.X  = TheCPU.X;
+    R.Y  = TheCPU.Y;
+    R.SP = TheCPU.SP;
+    R.P  = TheCPU.FlagRegister() | 0x20;
+    PutWord(R.Addr, ReturnAddr);
+    R.Flags = ModeFlags | U8(Type << TraceRecord::InterruptShift);
+    Commit();
+}
+
+void Tracer::DumpAfter(const Trigger Reason)
+{
+    // Keep the state of first failure instead of overwriting it in a loop
+    if(Triggered & (1 << Reason))
+        return;
+    Triggered |= 1 << Reason;
+
+    DumpPending   = true;
+    PendingReason = Reason;
+}
+
+void Tracer::Dump(const Trigger Reason)
+{
+    if(!Enabled || DumpFile.empty())
+        return;
+
+    std::FILE* File = std::fopen(DumpFile.c_str(), "wb");
+    if(!File) {
+        std::fprintf(stderr, "Could not open trace file: %s\n", DumpFile.c_str());
+        return;
+    }
+
+    // Oldest record first
+    const U64 Size  = std::min<U64>(Count, Ring.size());
+    const U64 First = Count - Size;
+    std::fwrite(DumpMagic, 1, sizeof(DumpMagic), File);
+    WriteU32(File, U32(First));
+    WriteU32(File, U32(First >> 32));
+    WriteU32(File, U32(Size));
+    WriteU32(File, sizeof(TraceRecord));
+
+    const size_t Start = size_t(First) & Mask;
+    const size_t Tail  = std::min<size_t>(size_t(Size), Ring.size() - Start);
+    std::fwrite(&Ring[Start], sizeof(TraceRecord), Tail, File);
+    std::fwrite(&Ring[0], sizeof(TraceRecord), size_t(Size) - Tail, File);
+    std::fclose(File);
+
+    Dumps++;
+    std::printf("Trace of %llu instructions dumped %s to %s\n", (unsigned long long)Size, TriggerNames[Reason], DumpFile.c_str());
+}
+
+void Tracer::PostBlock(const size_t Size)
+{
+    if(Size == 0)
+        return;
+
+    // Block ends at most recent record
+    Block Records = std::make_shared<std::vector<TraceRecord>>(Size);
+    for(size_t i=0; i<Size; i++) {
+        (*Records)[i] = Ring[size_t(Count - Size + i) & Mask];
+    }
+    StreamWorker.Post(Records);
+}
+
+void Tracer::WriteBlock(const Block& Records)
+{
+    // Bytes equal to previous record are skipped, a 16-bit mask tells which are stored.
+    // Every block starts from a zero record so blocks can be decoded independently.
+    U8 Previous[sizeof(TraceRecord)] = {};
+
+    Encoded.clear();
+    for(const TraceRecord& R : *Records) {
+        const U8* Bytes = reinterpret_cast<const U8*>(&R);
+        const size_t MaskPos = Encoded.size();
+        Encoded.resize(MaskPos + 2);
+
+        U16 Changed = 0;
+        for(size_t i=0; i<sizeof(TraceRecord); i++) {
+            if(Bytes[i] != Previous[i]) {
+                Changed |= 1 << i;
+                Encoded.push_back(Bytes[i]);
+                Previous[i] = Bytes[i];
+            }
+        }
+        PutWord(&Encoded[MaskPos], Changed);
+    }
+
+    WriteU32(Stream, U32(Records->size()));
+    WriteU32(Stream, U32(Encoded.size()));
+    std::fwrite(Encoded.data(), 1, Encoded.size(), Stream);
+}
@@ -0,0 +1,103 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "common.h"
+#include "device.h"
+#include "opcodes.h"
+#include "worker.h"
+
+// Binary trace record of one instruction or interrupt entry, 16 bytes.
+// Words are stored little endian regardless of host byte order.
+struct TraceRecord
+{
+    // Opcode address, or handler address of interrupt entry
+    U8 PC[2];
+    U8 OpCode;
+    U8 Operand[2];
+    // Registers after instruction
+    U8 A, X, Y, SP, P;
+    // Effective address of data access, or return address of interrupt entry
+    U8 Addr[2];
+    // Memory at effective address after instruction
+    U8 Value;
+    U8 Flags;
+    U8 Cycles;
+    U8 Reserved;
+
+    enum {
+        AccessMask    = 0x03, // OpcodeInfo::AccessType
+        AccessIO      = 0x04, // Device register, value is not recorded
+        InterruptMask = 0x70, // CPU::InterruptType of interrupt entry
+        InterruptShift = 4,
+        CMOS          = 0x80, // Executed in 65C02 mode
+    };
+};
+
+// Instruction tracer keeping the most recent instructions in a ring buffer.
+// Ring is dumped to a file on request, on illegal opcode, BRK and watchpoint hit,
+// and at exit if it was not dumped before. Optionally every record is also
+// streamed to a delta compressed file by a background thread.
+class Tracer : public Device
+{
+public:
+    Tracer(CPU* InCPU);
+    ~Tracer();
+
+    enum Trigger {
+        TriggerRequest = 0,
+        TriggerIllegal,
+        TriggerBreak,
+        TriggerWatch,
+        TriggerExit,
+    };
+
+    // Called after every executed instruction while enabled
+    void Record(const U8 OpCode, const U16 OpAddr, const U32 InstructionCycles);
+    // Called after interrupt handler was entered while enabled
+    void RecordInterrupt(const U8 Type, const U16 ReturnAddr);
+
+    // Dumps ring buffer right away
+    void Dump(const Trigger Reason);
+    // Dumps ring buffer after current instruction is recorded,
+    // only the first illegal opcode and BRK are dumped
+    void DumpAfter(const Trigger Reason);
+
+    bool Enabled;
+
+    // Records in a stream block, ring buffer is never smaller
+    static const size_t BlockSize = 4096;
+
+private:
+    typedef std::shared_ptr<std::vector<TraceRecord>> Block;
+
+    void Commit();
+    void PostBlock(const size_t Count);
+    void WriteBlock(const Block& Records);
+
+    std::vector<TraceRecord> Ring;
+    size_t Mask;
+    U64    Count;
+
+    const OpcodeInfo* Opcodes;
+    U8 ModeFlags;
+
+    std::string DumpFile;
+    U32  Dumps;
+    U32  Triggered;
+    bool DumpPending;
+    Trigger PendingReason;
+
+    std::FILE*    Stream;
+    Worker<Block> StreamWorker;
+    std::vector<U8> Encoded;
+};
+
+#endif // TRACER_H
@@ -0,0 +1,118 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include "cpu.h"
+#include "uart.h"
+
+namespace {
+    enum Registers {
+        RegReceive  = 0x28,
+        RegTransmit = 0x29,
+        RegStatus   = 0x2A,
+        RegControl  = 0x2B,
+    };
+
+    enum StatusBits {
+        StReceived = 0x01,
+        StReady    = 0x02,
+        StClosed   = 0x04,
+    };
+
+    enum ControlBits {
+        CtlIRQ = 0x40,
+    };
+}
+
+UART::UART(CPU* InCPU)
+    : Device(InCPU)
+    , Control(0)
+    , Link(InCPU->Backends.Serial)
+    , ClosedPolls(0)
+{
+    CyclesPerTick = PollCycles;
+
+    // Without serial link registers are plain memory, which BIOS detects
+    if(!Link)
+        return;
+
+    for(int Reg=RegReceive; Reg<=RegControl; Reg++) {
+        RAM.AllocRegister<UART>(Reg, this, &UART::ReadRegister, &UART::WriteRegister);
+    }
+}
+
+void UART::Tick(const U32 DeltaCycles)
+{
+    if(!Link || !ShouldTick(DeltaCycles))
+        return;
+
+    Receive();
+}
+
+void UART::Receive()
+{
+    U8 Byte;
+    while(Received.size() < MaxBytes && Link->Receive(Byte)) {
+        Received.push_back(Byte);
+    }
+    UpdateIRQ();
+}
+
+void UART::UpdateIRQ()
+{
+    // IRQ is held until FIFO is emptied, so bytes arriving while masked are not lost
+    if((Control & CtlIRQ) && !Received.empty())
+        TheCPU.AssertIRQ(CPU::IRQ_Serial);
+    else
+        TheCPU.ReleaseIRQ(CPU::IRQ_Serial);
+}
+
+U8 UART::Status()
+{
+    // Guest polling for input gets it without waiting for next tick
+    if(Received.empty()) {
+        Receive();
+    }
+
+    U8 Value = StReady;
+    if(!Received.empty()) {
+        Value |= StReceived;
+    }
+    else if(Link->Closed()) {
+        Value |= StClosed;
+        ClosedPolls++;
+    }
+    return Value;
+}
+
+U8 UART::ReadRegister(U8 Reg)
+{
+    switch(Reg) {
+    case RegReceive: {
+        if(Received.empty())
+            return 0;
+        const U8 Byte = Received.front();
+        Received.pop_front();
+        UpdateIRQ();
+        return Byte;
+    }
+    case RegStatus:  return Status();
+    case RegControl: return Control;
+    }
+    return 0;
+}
+
+void UART::WriteRegister(U8 Reg, U8 Data)
+{
+    switch(Reg) {
+    case RegTransmit:
+        Link->Send(Data);
+        ClosedPolls = 0;
+        break;
+    case RegControl:
+        Control = Data & CtlIRQ;
+        UpdateIRQ();
+        break;
+    }
+}
@@ -0,0 +1,53 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef UART_H
+#define UART_H
+
+#include <deque>
+#include "common.h"
+#include "device.h"
+
+class SerialLink;
+
+// Serial port connected to a host serial link.
+// Received bytes are polled from the link into a FIFO and hold IRQ while
+// enabled and the FIFO is not empty. Transmitted bytes are passed to the link as they are written,
+// so the transmitter is always ready. Receive and transmit registers are
+// separate because stores also read their target address.
+class UART : public Device
+{
+public:
+    UART(class CPU* InCPU);
+
+    void Tick(const U32 DeltaCycles) override;
+
+    // Guest keeps polling for input after host input was closed and consumed
+    bool Drained() const { return ClosedPolls >= DrainPolls; }
+
+    U8 Control;
+
+    // Maximum number of received bytes buffered by the port
+    static const size_t MaxBytes = 16;
+    // CPU cycles between polls of the host link
+    static const U32 PollCycles = 200;
+    // Status reads without transmitting that make closed input drained.
+    // Waiting for transmitter takes a single read per byte, a receive loop many.
+    static const U32 DrainPolls = 16;
+
+private:
+    U8   ReadRegister(U8 Reg);
+    void WriteRegister(U8 Reg, U8 Data);
+
+    void Receive();
+    U8   Status();
+    void UpdateIRQ();
+
+    SerialLink*    Link;
+    std::deque<U8> Received;
+    U32            ClosedPolls;
+};
+
+#endif // UART_H
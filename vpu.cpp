@@ -28,30 +28,55 @@ namespace {
     constexpr U16 FrameBegin[] = { 0 + (Overscan>>1), 0 + (Overscan>>1) };
     constexpr U16 FrameEnd[]   = { FrameBegin[0] + FrameW-1, FrameBegin[1] + FrameH-1 };
     constexpr U16 ScreenEnd[]  = { FrameEnd[0] + (Overscan>>1), FrameEnd[1] + (Overscan>>1) };
+
+    static_assert(VPU::ScreenWidth == FrameW + Overscan && VPU::ScreenHeight == FrameH + Overscan, "Screen size mismatch");
+
+    // ROM font is VGA CP437, code 0 is used by BIOS as blank
+    const char* const GlyphText[256] = {
+        " ", u8"\u263A", u8"\u263B", u8"\u2665", u8"\u2666", u8"\u2663", u8"\u2660", u8"\u2022",
+        u8"\u25D8", u8"\u25CB", u8"\u25D9", u8"\u2642", u8"\u2640", u8"\u266A", u8"\u266B", u8"\u263C",
+        u8"\u25BA", u8"\u25C4", u8"\u2195", u8"\u203C", u8"\u00B6", u8"\u00A7", u8"\u25AC", u8"\u21A8",
+        u8"\u2191", u8"\u2193", u8"\u2192", u8"\u2190", u8"\u221F", u8"\u2194", u8"\u25B2", u8"\u25BC",
+        " ", "!", "\"", "#", "$", "%", "&", "'",
+        "(", ")", "*", "+", ",", "-", ".", "/",
+        "0", "1", "2", "3", "4", "5", "6", "7",
+        "8", "9", ":", ";", "<", "=", ">", "?",
+        "@", "A", "B", "C", "D", "E", "F", "G",
+        "H", "I", "J", "K", "L", "M", "N", "O",
+        "P", "Q", "R", "S", "T", "U", "V", "W",
+        "X", "Y", "Z", "[", "\\", "]", "^", "_",
+        "`", "a", "b", "c", "d", "e", "f", "g",
+        "h", "i", "j", "k", "l", "m", "n", "o",
+        "p", "q", "r", "s", "t", "u", "v", "w",
+        "x", "y", "z", "{", "|", "}", "~", u8"\u2302",
+        u8"\u00C7", u8"\u00FC", u8"\u00E9", u8"\u00E2", u8"\u00E4", u8"\u00E0", u8"\u00E5", u8"\u00E7",
+        u8"\u00EA", u8"\u00EB", u8"\u00E8", u8"\u00EF", u8"\u00EE", u8"\u00EC", u8"\u00C4", u8"\u00C5",
+        u8"\u00C9", u8"\u00E6", u8"\u00C6", u8"\u00F4", u8"\u00F6", u8"\u00F2", u8"\u00FB", u8"\u00F9",
+        u8"\u00FF", u8"\u00D6", u8"\u00DC", u8"\u00A2", u8"\u00A3", u8"\u00A5", u8"\u20A7", u8"\u0192",
+        u8"\u00E1", u8"\u00ED", u8"\u00F3", u8"\u00FA", u8"\u00F1", u8"\u00D1", u8"\u00AA", u8"\u00BA",
+        u8"\u00BF", u8"\u2310", u8"\u00AC", u8"\u00BD", u8"\u00BC", u8"\u00A1", u8"\u00AB", u8"\u00BB",
+        u8"\u2591", u8"\u2592", u8"\u2593", u8"\u2502", u8"\u2524", u8"\u2561", u8"\u2562", u8"\u2556",
+        u8"\u2555", u8"\u2563", u8"\u2551", u8"\u2557", u8"\u255D", u8"\u255C", u8"\u255B", u8"\u2510",
+        u8"\u2514", u8"\u2534", u8"\u252C", u8"\u251C", u8"\u2500", u8"\u253C", u8"\u255E", u8"\u255F",
+        u8"\u255A", u8"\u2554", u8"\u2569", u8"\u2566", u8"\u2560", u8"\u2550", u8"\u256C", u8"\u2567",
+        u8"\u2568", u8"\u2564", u8"\u2565", u8"\u2559", u8"\u2558", u8"\u2552", u8"\u2553", u8"\u256B",
+        u8"\u256A", u8"\u2518", u8"\u250C", u8"\u2588", u8"\u2584", u8"\u258C", u8"\u2590", u8"\u2580",
+        u8"\u03B1", u8"\u00DF", u8"\u0393", u8"\u03C0", u8"\u03A3", u8"\u03C3", u8"\u00B5", u8"\u03C4",
+        u8"\u03A6", u8"\u0398", u8"\u03A9", u8"\u03B4", u8"\u221E", u8"\u03C6", u8"\u03B5", u8"\u2229",
+        u8"\u2261", u8"\u00B1", u8"\u2265", u8"\u2264", u8"\u2320", u8"\u2321", u8"\u00F7", u8"\u2248",
+        u8"\u00B0", u8"\u2219", u8"\u00B7", u8"\u221A", u8"\u207F", u8"\u00B2", u8"\u25A0", " ",
+    };
 }
 
 VPU::VPU(CPU* InCPU)
     : Device(InCPU)
     , Scanline(0)
     , RasterInt(0xFF)
+    , Frame(0)
+    , Output(InCPU->Backends.Video)
+    , FrameHostStart(0)
+    , FrameCycleStart(0)
 {
-    const U16 Width  = FrameW + Overscan;
-    const U16 Height = FrameH + Overscan;
-
-    if(SDL_InitSubSystem(SDL_INIT_VIDEO) < 0) {
-        throw Device::Error(SDL_GetError());
-    }
-
-    if(!(Window = SDL_CreateWindow("B1 Display", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, Width*2, Height*2, 0))) {
-        throw Device::Error(SDL_GetError());
-    }
-    if(!(Renderer = SDL_CreateRenderer(Window, -1, 0))) {
-        throw Device::Error(SDL_GetError());
-    }
-    if(!(Texture = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, Width, Height))) {
-        throw Device::Error(SDL_GetError());
-    }
-
     for(int Reg=RegScanline; Reg<=RegCharMapPage; Reg++) {
         RAM.AllocRegister<VPU>(Reg, this, &VPU::ReadRegister, &VPU::WriteRegister);
     }
@@ -59,6 +84,15 @@ VPU::VPU(CPU* InCPU)
     CyclesPerTick    = TheCPU.Frequency / (UpdateHz * MAXSCAN);
     CharsPerScanline = FrameW/8;
 
+    RenderedReady = false;
+    if(Output) {
+        RenderPixels.resize(ScreenWidth * ScreenHeight * 4);
+    }
+    if(Output && TheCPU.Settings.Threads) {
+        RenderedPixels.resize(ScreenWidth * ScreenHeight * 4);
+        RenderThread.Start(4*MAXSCAN, [this](const ScanlineFetch& Fetch) { Render(Fetch); });
+    }
+
     FrameAddr       = 0xF000;
     CharMapAddr     = 0xF400;
     BackgroundColor = 0x0000;
@@ -68,36 +102,73 @@ VPU::VPU(CPU* InCPU)
 
 VPU::~VPU()
 {
-    if(Texture)
-        SDL_DestroyTexture(Texture);
-    if(Renderer)
-        SDL_DestroyRenderer(Renderer);
-    if(Window)
-        SDL_DestroyWindow(Window);
+    RenderThread.Stop();
 }
 
 void VPU::Tick(const U32 DeltaCycles)
 {
-    while(ShouldTick(DeltaCycles)) {
-        if(Scanline == 0) {
-            SDL_LockTexture(Texture, nullptr, (void**)&LockedPixels, &LockedPitch);
+    // Delta is accounted once, long stalls (DMA) may span several scanlines
+    for(U32 Delta=DeltaCycles; ShouldTick(Delta); Delta=0) {
+        const bool Threaded = RenderThread.IsRunning();
+
+        if(Scanline == 0 && TheCPU.Events.Enabled) {
+            FrameHostStart  = TheCPU.Events.Now();
+            FrameCycleStart = TheCPU.TotalCycles;
         }
         if(Scanline <= ScreenEnd[1]) {
-            DrawScanline();
+            if(Output) {
+                // Pixels are expanded on render thread if there is one
+                ScanlineFetch Fetch;
+                FetchScanline(Fetch);
+                if(Threaded)
+                    RenderThread.Post(Fetch);
+                else
+                    DrawScanline(Fetch, RenderPixels.data() + Scanline * ScreenWidth*4);
+            }
             if(Scanline+1 == RasterInt) {
                 TheCPU.SignalInterrupt(CPU::INT_NMI);
             }
         }
         else if(Scanline == ScreenEnd[1]+1) {
-            SDL_UnlockTexture(Texture);
-            SDL_RenderCopy(Renderer, Texture, nullptr, nullptr);
-            SDL_RenderPresent(Renderer);
+            if(Output && Threaded) {
+                ScanlineFetch EndOfFrame;
+                EndOfFrame.Scanline = Scanline;
+                RenderThread.Post(EndOfFrame);
+                PresentRendered();
+            }
+            else if(Output) {
+                PresentFrame(RenderPixels.data());
+            }
+            if(TheCPU.Events.Enabled) {
+                TheCPU.Events.Complete(Timeline::EventFrame, Timeline::ThreadCPU, FrameHostStart, FrameCycleStart, TheCPU.TotalCycles, Frame);
+            }
+            Frame++;
         }
 
         Scanline = (Scanline+1) % MAXSCAN;
     }
 }
 
+std::string VPU::ReadScreenText() const
+{
+    std::string Text;
+    Text.reserve(TextRows * (TextColumns+1));
+
+    for(U16 Row=0; Row<TextRows; Row++) {
+        for(U16 Column=0; Column<TextColumns; Column++) {
+            const U16 CharAddr = FrameAddr + Row*TextColumns + Column;
+            Text.append(GlyphToText(RAM.Memory[CharAddr]));
+        }
+        Text.push_back('\n');
+    }
+    return Text;
+}
+
+const char* VPU::GlyphToText(const U8 Code)
+{
+    return GlyphText[Code];
+}
+
 U8 VPU::ReadRegister(U8 Reg)
 {
     switch(Reg) {
@@ -130,38 +201,86 @@ void VPU::WriteRegister(U8 Reg, U8 Data)
     }
 }
 
-void VPU::DrawScanline()
+void VPU::FetchScanline(ScanlineFetch& Fetch)
 {
-    U8* Addr = LockedPixels + Scanline * LockedPitch;
-    U16 X    = 0;
+    Fetch.Scanline        = Scanline;
+    Fetch.BorderColor     = BorderColor;
+    Fetch.BackgroundColor = BackgroundColor;
+    Fetch.ForegroundColor = ForegroundColor;
 
-    if(Scanline < FrameBegin[1] || Scanline > FrameEnd[1]) {
+    if(Scanline < FrameBegin[1] || Scanline > FrameEnd[1])
+        return;
+
+    // Glyph row of each character cell crossed by this scanline
+    const U16 FrameY = Scanline - FrameBegin[1];
+    for(U8 Column=0; Column<CharsPerScanline; Column++) {
+        const U16 CharAddr  = FrameAddr + (FrameY/8 * CharsPerScanline + Column);
+        // Video fetches are not CPU accesses, no watchpoints or register side effects
+        const U16 GlyphAddr = CharMapAddr + 8*RAM.Peek(CharAddr);
+        Fetch.Patterns[Column] = RAM.Peek(U16(GlyphAddr + (FrameY%8)));
+    }
+}
+
+void VPU::DrawScanline(const ScanlineFetch& Fetch, U8* Addr) const
+{
+    U16 X = 0;
+
+    if(Fetch.Scanline < FrameBegin[1] || Fetch.Scanline > FrameEnd[1]) {
         for(; X<=ScreenEnd[0]; X++) {
-            DrawPixel(Addr, BorderColor);
+            DrawPixel(Addr, Fetch.BorderColor);
         }
     }
     else {
-        const U16 FrameY = Scanline - FrameBegin[1];
-
         for(; X<FrameBegin[0]; X++) {
-            DrawPixel(Addr, BorderColor);
+            DrawPixel(Addr, Fetch.BorderColor);
         }
         for(; X<FrameEnd[0]; X+=8) {
-            const U16 FrameX    = X - FrameBegin[0];
-            const U16 CharAddr  = FrameAddr + (FrameY/8 * CharsPerScanline + FrameX/8);
-            const U16 GlyphAddr = CharMapAddr + 8*RAM[CharAddr];
-
+            const U8 Pattern = Fetch.Patterns[(X - FrameBegin[0])/8];
             for(U8 GX=0; GX<8; GX++) {
-                const U8 PixelValue = RAM[GlyphAddr + (FrameY%8)] & (0x80 >> GX);
-                DrawPixel(Addr, PixelValue ? ForegroundColor : BackgroundColor);
+                DrawPixel(Addr, (Pattern & (0x80 >> GX)) ? Fetch.ForegroundColor : Fetch.BackgroundColor);
             }
         }
         for(; X<=ScreenEnd[0]; X++) {
-            DrawPixel(Addr, BorderColor);
+            DrawPixel(Addr, Fetch.BorderColor);
         }
     }
 }
 
+void VPU::Render(const ScanlineFetch& Fetch)
+{
+    if(Fetch.Scanline <= ScreenEnd[1]) {
+        DrawScanline(Fetch, RenderPixels.data() + Fetch.Scanline * ScreenWidth*4);
+    }
+    else {
+        // Frame complete, hand it over to CPU thread for presentation
+        std::lock_guard<std::mutex> Lock(RenderedLock);
+        RenderPixels.swap(RenderedPixels);
+        RenderedReady = true;
+    }
+}
+
+void VPU::PresentRendered()
+{
+    // Video output is used from CPU thread only, it gets latest complete frame
+    if(!RenderedReady.exchange(false))
+        return;
+
+    std::lock_guard<std::mutex> Lock(RenderedLock);
+    PresentFrame(RenderedPixels.data());
+}
+
+void VPU::PresentFrame(const U8* Pixels)
+{
+    if(!TheCPU.Events.Enabled) {
+        Output->Present(Pixels, ScreenWidth, ScreenHeight, ScreenWidth*4);
+        return;
+    }
+
+    const U64 Start = TheCPU.Events.Now();
+    Output->Present(Pixels, ScreenWidth, ScreenHeight, ScreenWidth*4);
+    TheCPU.Events.Complete(Timeline::EventPresent, Timeline::ThreadCPU, Start, TheCPU.TotalCycles, TheCPU.TotalCycles, Frame);
+}
+
 void VPU::DrawPixel(U8*& Addr, const U16 Color)
 {
     *Addr++ = (Color & 0x0F00) >> 4;
@@ -6,8 +6,14 @@
 #ifndef VPU_H
 #define VPU_H
 
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
 #include "common.h"
 #include "device.h"
+#include "host.h"
+#include "worker.h"
 
 // Video Processing Unit
 class VPU : public Device
@@ -18,9 +24,17 @@ public:
 
     void Tick(const U32 DeltaCycles) override;
 
-    SDL_Window*   Window;
-    SDL_Renderer* Renderer;
-    SDL_Texture*  Texture;
+    // Text mode screen contents, one line per character row
+    std::string ReadScreenText() const;
+    // UTF-8 representation of a character map (CP437) code
+    static const char* GlyphToText(const U8 Code);
+
+    static const U8 TextColumns = 40;
+    static const U8 TextRows    = 25;
+
+    // Frame size including border, in pixels
+    static const U16 ScreenWidth  = 352;
+    static const U16 ScreenHeight = 232;
 
     U16 FrameAddr;
     U16	CharMapAddr;
@@ -29,17 +43,43 @@ public:
     U16 BorderColor;
     U8  Scanline;
     U8  RasterInt;
+    U32 Frame;
 
 private:
+    // Everything needed to draw a scanline, fetched from memory & registers
+    // on CPU thread at the time the scanline is displayed
+    struct ScanlineFetch {
+        U8  Scanline;
+        U16 BorderColor;
+        U16 BackgroundColor;
+        U16 ForegroundColor;
+        U8  Patterns[TextColumns];
+    };
+
     U8   ReadRegister(U8 Reg);
     void WriteRegister(U8 Reg, U8 Data);
 
-    inline void DrawScanline();
-    inline void DrawPixel(U8*& Addr, const U16 Color);
+    inline void FetchScanline(ScanlineFetch& Fetch);
+    void DrawScanline(const ScanlineFetch& Fetch, U8* Addr) const;
+    inline static void DrawPixel(U8*& Addr, const U16 Color);
+
+    // Render thread
+    void Render(const ScanlineFetch& Fetch);
+    void PresentRendered();
+    void PresentFrame(const U8* Pixels);
+
+    VideoOutput* Output;
+    U8           CharsPerScanline;
+
+    // Start of current frame on timeline
+    U64 FrameHostStart;
+    U64 FrameCycleStart;
 
-    U8  CharsPerScanline;
-    U8* LockedPixels;
-    int LockedPitch;
+    Worker<ScanlineFetch> RenderThread;
+    std::vector<U8>       RenderPixels;
+    std::vector<U8>       RenderedPixels;
+    std::mutex            RenderedLock;
+    std::atomic<bool>     RenderedReady;
 };
 
 #endif // VPU_H
@@ -0,0 +1,125 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#include <cstring>
+#include <algorithm>
+#include "wavefile.h"
+
+namespace {
+    const U16 FormatPCM   = 1;
+    const U16 FormatFloat = 3;
+
+    void Put16(U8*& Addr, const U16 Value)
+    {
+        *Addr++ = Value & 0xFF;
+        *Addr++ = Value >> 8;
+    }
+    void Put32(U8*& Addr, const U32 Value)
+    {
+        Put16(Addr, Value & 0xFFFF);
+        Put16(Addr, Value >> 16);
+    }
+}
+
+WaveFile::WaveFile()
+    : File(nullptr)
+    , Rate(0)
+    , Format(SampleFormat::S16)
+    , DataSize(0)
+{}
+
+WaveFile::~WaveFile()
+{
+    Close();
+}
+
+bool WaveFile::Open(const char* FileName, const U32 InRate, const SampleFormat InFormat)
+{
+    Close();
+
+    if(!(File = std::fopen(FileName, "wb")))
+        return false;
+
+    Rate     = InRate;
+    Format   = InFormat;
+    DataSize = 0;
+    WriteHeader();
+    return true;
+}
+
+void WaveFile::Write(const float* Samples, const size_t Count)
+{
+    if(!File)
+        return;
+
+    Buffer.resize(Count * SampleSize(Format));
+    ConvertSamples(Samples, Buffer.data(), Count, Format);
+    std::fwrite(Buffer.data(), 1, Buffer.size(), File);
+    DataSize += Buffer.size();
+}
+
+void WaveFile::Close()
+{
+    if(File) {
+        std::fseek(File, 0, SEEK_SET);
+        WriteHeader();
+        std::fclose(File);
+        File = nullptr;
+    }
+}
+
+void WaveFile::WriteHeader()
+{
+    const U16 BytesPerSample = SampleSize(Format);
+
+    U8  Header[44];
+    U8* Addr = Header;
+
+    std::memcpy(Addr, "RIFF", 4); Addr += 4;
+    Put32(Addr, 36 + DataSize);
+    std::memcpy(Addr, "WAVEfmt ", 8); Addr += 8;
+    Put32(Addr, 16);
+    Put16(Addr, Format == SampleFormat::F32 ? FormatFloat : FormatPCM);
+    Put16(Addr, 1);
+    Put32(Addr, Rate);
+    Put32(Addr, Rate * BytesPerSample);
+    Put16(Addr, BytesPerSample);
+    Put16(Addr, 8 * BytesPerSample);
+    std::memcpy(Addr, "data", 4); Addr += 4;
+    Put32(Addr, DataSize);
+
+    std::fwrite(Header, 1, sizeof(Header), File);
+}
+
+size_t WaveFile::SampleSize(const SampleFormat Format)
+{
+    switch(Format) {
+    case SampleFormat::U8:  return 1;
+    case SampleFormat::S16: return 2;
+    case SampleFormat::F32: return 4;
+    }
+    return 0;
+}
+
+void WaveFile::ConvertSamples(const float* Input, U8* Output, const size_t Count, const SampleFormat Format)
+{
+    switch(Format) {
+    case SampleFormat::U8:
+        for(size_t i=0; i<Count; i++) {
+            Output[i] = U8(std::max(-1.0f, std::min(1.0f, Input[i])) * 127.0f + 128.0f);
+        }
+        break;
+    case SampleFormat::S16:
+        for(size_t i=0; i<Count; i++) {
+            const S16 Value = S16(std::max(-1.0f, std::min(1.0f, Input[i])) * 32767.0f);
+            Output[2*i+0] = Value & 0xFF;
+            Output[2*i+1] = (Value >> 8) & 0xFF;
+        }
+        break;
+    case SampleFormat::F32:
+        std::memcpy(Output, Input, Count * sizeof(float));
+        break;
+    }
+}
@@ -0,0 +1,39 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef WAVEFILE_H
+#define WAVEFILE_H
+
+#include <vector>
+#include "common.h"
+#include "config.h"
+#include "host.h"
+
+// Mono RIFF WAVE file writer, usable as audio output
+class WaveFile : public AudioOutput
+{
+public:
+    WaveFile();
+    ~WaveFile();
+
+    bool Open(const char* FileName, const U32 InRate, const SampleFormat InFormat);
+    void Write(const float* Samples, const size_t Count) override;
+    void Close();
+
+    static size_t SampleSize(const SampleFormat Format);
+    static void   ConvertSamples(const float* Input, U8* Output, const size_t Count, const SampleFormat Format);
+
+private:
+    void WriteHeader();
+
+    std::FILE*   File;
+    U32          Rate;
+    SampleFormat Format;
+    U32          DataSize;
+
+    std::vector<U8> Buffer;
+};
+
+#endif // WAVEFILE_H
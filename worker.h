@@ -0,0 +1,72 @@
+/**
+ * B1 Computer Emulator
+ * (c) 2014-2015 Michał Siejak
+ */
+
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include "common.h"
+#include "ringbuffer.h"
+
+// Device thread consuming events posted by CPU thread in order.
+// Events are passed through a lock-free ring buffer; producer waits only
+// when the buffer is full, consumer sleeps briefly when it is empty.
+template<class Event>
+class Worker
+{
+public:
+    Worker() : Stopping(false) {}
+    ~Worker() { Stop(); }
+
+    void Start(const size_t Capacity, std::function<void(const Event&)> InHandler)
+    {
+        Queue.Reset(Capacity);
+        Handler  = InHandler;
+        Stopping = false;
+        Thread   = std::thread(&Worker::Run, this);
+    }
+
+    // Processes all posted events and joins the thread
+    void Stop()
+    {
+        if(!Thread.joinable())
+            return;
+        Stopping = true;
+        Thread.join();
+    }
+
+    bool IsRunning() const { return Thread.joinable(); }
+
+    void Post(const Event& E)
+    {
+        while(!Queue.Push(E)) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    void Run()
+    {
+        Event E;
+        for(;;) {
+            while(Queue.Pop(E)) {
+                Handler(E);
+            }
+            if(Stopping && Queue.Empty())
+                break;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+
+    RingBuffer<Event> Queue;
+    std::function<void(const Event&)> Handler;
+    std::thread       Thread;
+    std::atomic<bool> Stopping;
+};
+
+#endif // WORKER_H